@@ -0,0 +1,1266 @@
+/* Copyright (c) 2022 Mark Friedenbach
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/* for clock_gettime, and sched_setaffinity on Linux */
+#define _GNU_SOURCE
+
+#include <sha2/sha256.h>
+#include <sha2/sha512.h>
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h> /* for sysconf */
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sched.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+#if defined(__x86_64__) || defined(__amd64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+#if defined(HAVE_LIBCRYPTO)
+#include <openssl/evp.h>
+#include <openssl/sha.h>
+#endif
+
+/* Timing */
+
+#if defined(__x86_64__) || defined(__amd64__) || defined(__i386__)
+#define HAVE_TSC 1
+/** Read the time stamp counter.  On current processors this counts reference
+ * cycles at the nominal frequency, not core clock cycles. */
+static uint64_t read_tsc(void)
+{
+        uint32_t lo, hi;
+        __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+        return ((uint64_t)hi << 32) | lo;
+}
+#else
+#define HAVE_TSC 0
+static uint64_t read_tsc(void)
+{
+        return 0;
+}
+#endif
+
+/** Monotonic wall-clock time, in nanoseconds. */
+static double now_ns(void)
+{
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Hardware performance counters */
+
+#define MAX_COUNTERS 16
+
+/** A perf_event counter, measured around each benchmark in addition to the
+ * timers.  Counters that cannot be opened are left out of the report. */
+struct counter {
+        char name[24];
+        uint32_t type;
+        uint64_t config;
+        int fd;
+};
+
+static struct counter counters[MAX_COUNTERS];
+static size_t num_counters = 0;
+
+/* Indices of the counters used for derived metrics, or -1. */
+static int counter_instructions = -1;
+static int counter_cycles = -1;
+static int counter_aperf = -1;
+static int counter_mperf = -1;
+
+/** Queue a counter to be opened by open_counters(). */
+static void add_counter(const char* name, uint32_t type, uint64_t config)
+{
+        if (num_counters < MAX_COUNTERS) {
+                strncpy(counters[num_counters].name, name, sizeof(counters[0].name) - 1);
+                counters[num_counters].type = type;
+                counters[num_counters].config = config;
+                counters[num_counters].fd = -1;
+                ++num_counters;
+        }
+}
+
+#if defined(__linux__)
+/** Read the perf PMU type and event number of a sysfs-described event such as
+ * msr/aperf, returning zero if it does not exist. */
+static int sysfs_event(const char* pmu, const char* event, uint32_t* type, uint64_t* config)
+{
+        char path[128];
+        unsigned long value;
+        int ok;
+        FILE* f;
+        sprintf(path, "/sys/bus/event_source/devices/%s/type", pmu);
+        if (!(f = fopen(path, "r"))) {
+                return 0;
+        }
+        ok = fscanf(f, "%lu", &value) == 1;
+        fclose(f);
+        *type = (uint32_t)value;
+        sprintf(path, "/sys/bus/event_source/devices/%s/events/%s", pmu, event);
+        if (!ok || !(f = fopen(path, "r"))) {
+                return 0;
+        }
+        ok = fscanf(f, "event=%lx", &value) == 1;
+        fclose(f);
+        *config = value;
+        return ok;
+}
+#endif
+
+/** The default counter set: instructions and cycles, L1 data and L2 misses,
+ * APERF/MPERF, and on Intel the uops dispatched to the ALU ports.  Raw
+ * events are only used on the vendors whose encodings are known. */
+static void default_counters(void)
+{
+#if defined(__linux__)
+        uint32_t type;
+        uint64_t config;
+        add_counter("instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        add_counter("core_cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        add_counter("l1d_misses", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+#if defined(__x86_64__) || defined(__amd64__) || defined(__i386__)
+        {
+                unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0, family = 0;
+                char vendor[13];
+                __get_cpuid(0, &eax, &ebx, &ecx, &edx);
+                memcpy(vendor, &ebx, 4);
+                memcpy(vendor + 4, &edx, 4);
+                memcpy(vendor + 8, &ecx, 4);
+                vendor[12] = '\0';
+                if (__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+                        family = ((eax >> 8) & 0xf) + ((eax >> 20) & 0xff);
+                }
+                if (!strcmp(vendor, "GenuineIntel") && family == 6) {
+                        /* L2_RQSTS.MISS and UOPS_DISPATCHED.PORT_{0,1,5,6}
+                         * (Skylake and later) */
+                        add_counter("l2_misses", PERF_TYPE_RAW, 0x3f24);
+                        add_counter("uops_port0", PERF_TYPE_RAW, 0x01a1);
+                        add_counter("uops_port1", PERF_TYPE_RAW, 0x02a1);
+                        add_counter("uops_port5", PERF_TYPE_RAW, 0x20a1);
+                        add_counter("uops_port6", PERF_TYPE_RAW, 0x40a1);
+                } else if (!strcmp(vendor, "AuthenticAMD") && family >= 0x17) {
+                        /* L2CacheReqStat, data and instruction misses (Zen) */
+                        add_counter("l2_misses", PERF_TYPE_RAW, 0x0964);
+                }
+        }
+#endif
+        if (sysfs_event("msr", "aperf", &type, &config)) {
+                add_counter("aperf", type, config);
+        }
+        if (sysfs_event("msr", "mperf", &type, &config)) {
+                add_counter("mperf", type, config);
+        }
+#endif
+}
+
+/** Parse a list of extra raw events such as "uops_port7=r80a1,l2_hits=r1f24"
+ * in the style of perf(1), returning zero on a syntax error. */
+static int parse_counters(const char* list)
+{
+        while (*list) {
+                char name[24];
+                size_t len = strcspn(list, "=,");
+                char* end;
+                unsigned long config;
+                if (!len || len >= sizeof(name) || list[len] != '=' || list[len + 1] != 'r') {
+                        return 0;
+                }
+                memcpy(name, list, len);
+                name[len] = '\0';
+                config = strtoul(list + len + 2, &end, 16);
+                if (end == list + len + 2 || (*end && *end != ',')) {
+                        return 0;
+                }
+#if defined(__linux__)
+                add_counter(name, PERF_TYPE_RAW, config);
+#endif
+                list = end + (*end == ',');
+        }
+        return 1;
+}
+
+/** Open the queued counters for this thread, dropping any that are not
+ * supported or permitted.  Returns the number opened. */
+static size_t open_counters(void)
+{
+        size_t i, n = 0;
+#if defined(__linux__)
+        for (i = 0; i < num_counters; ++i) {
+                struct perf_event_attr attr;
+                memset(&attr, 0, sizeof(attr));
+                attr.size = sizeof(attr);
+                attr.type = counters[i].type;
+                attr.config = counters[i].config;
+                attr.disabled = 1;
+                attr.exclude_kernel = 1;
+                attr.exclude_hv = 1;
+                attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+                counters[i].fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+                if (counters[i].fd < 0) {
+                        /* Some PMUs, such as msr, cannot filter by mode. */
+                        attr.exclude_kernel = 0;
+                        attr.exclude_hv = 0;
+                        counters[i].fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+                }
+                if (counters[i].fd < 0) {
+                        fprintf(stderr, "bench_sha2: counter %s is not available\n", counters[i].name);
+                        continue;
+                }
+                counters[n++] = counters[i];
+        }
+#endif
+        num_counters = n;
+        for (i = 0; i < n; ++i) {
+                if (!strcmp(counters[i].name, "instructions")) {
+                        counter_instructions = (int)i;
+                } else if (!strcmp(counters[i].name, "core_cycles")) {
+                        counter_cycles = (int)i;
+                } else if (!strcmp(counters[i].name, "aperf")) {
+                        counter_aperf = (int)i;
+                } else if (!strcmp(counters[i].name, "mperf")) {
+                        counter_mperf = (int)i;
+                }
+        }
+        return n;
+}
+
+/** Run a workload with every counter enabled, storing the counts, scaled for
+ * multiplexing, in values. */
+static void count_events(void (*run)(size_t, unsigned long), size_t size, unsigned long iters, double values[MAX_COUNTERS])
+{
+        size_t i;
+#if defined(__linux__)
+        for (i = 0; i < num_counters; ++i) {
+                ioctl(counters[i].fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(counters[i].fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+        run(size, iters);
+        for (i = 0; i < num_counters; ++i) {
+                ioctl(counters[i].fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+        for (i = 0; i < num_counters; ++i) {
+                uint64_t buf[3]; /* value, time enabled, time running */
+                values[i] = 0;
+                if (read(counters[i].fd, buf, sizeof(buf)) == (ssize_t)sizeof(buf) && buf[2]) {
+                        values[i] = (double)buf[0] * buf[1] / buf[2];
+                }
+        }
+#else
+        (void)run;
+        (void)size;
+        (void)iters;
+        for (i = 0; i < num_counters; ++i) {
+                values[i] = 0;
+        }
+#endif
+}
+
+/* Workloads */
+
+#define MAX_STREAM (16u << 20)
+#define MAX_BATCH 1024
+
+static unsigned char* data;
+static struct sha256 hashes[2 * MAX_BATCH];
+static struct sha256 out[MAX_BATCH];
+static uint32_t midstate[8];
+static const void* messages[MAX_BATCH];
+static size_t lengths[MAX_BATCH];
+static struct sha512 hashes512[MAX_BATCH];
+static struct sha256_hmac_key hmac_key;
+static const struct sha256_hmac_key* hmac_keys[MAX_BATCH];
+static unsigned char* keys[MAX_BATCH];
+static struct sha256_tag tag;
+static struct sha256_ctx prefix;
+static size_t challenge_lengths[MAX_BATCH];
+static unsigned char* seeds[MAX_BATCH];
+static const void* bip39_salts[MAX_BATCH];
+static size_t bip39_salt_lengths[MAX_BATCH];
+
+static void run_stream(size_t size, unsigned long iters)
+{
+        while (iters--) {
+                struct sha256_ctx ctx = SHA256_INIT;
+                sha256_update(&ctx, data, size);
+                sha256_done(&out[0], &ctx);
+        }
+}
+
+static void run_oneshot(size_t size, unsigned long iters)
+{
+        while (iters--) {
+                sha256(&out[0], data, size);
+        }
+}
+
+static void run_double64(size_t size, unsigned long iters)
+{
+        while (iters--) {
+                sha256_double64(out, hashes, size);
+        }
+}
+
+static void run_midstate(size_t size, unsigned long iters)
+{
+        while (iters--) {
+                sha256_midstate(out, midstate, data, size);
+        }
+}
+
+static void run_hash64(size_t size, unsigned long iters)
+{
+        while (iters--) {
+                sha256_hash64(out, hashes, size);
+        }
+}
+
+static void run_hmac(size_t size, unsigned long iters)
+{
+        while (iters--) {
+                sha256_hmac(&out[0], &hmac_key, data, size);
+        }
+}
+
+static void run_hmac_batch(size_t size, unsigned long iters)
+{
+        while (iters--) {
+                sha256_hmac_batch(out, hmac_keys, messages, lengths, size);
+        }
+}
+
+/* Each password takes PBKDF2_ITERATIONS inner and outer compressions. */
+#define PBKDF2_ITERATIONS 1000
+
+static void run_pbkdf2(size_t size, unsigned long iters)
+{
+        while (iters--) {
+                sha256_pbkdf2_batch(keys, 32, messages, lengths, messages, lengths, size, PBKDF2_ITERATIONS);
+        }
+}
+
+static void run_suffixes(size_t size, unsigned long iters)
+{
+        while (iters--) {
+                sha256_finalize_suffixes(out, &prefix, messages, lengths, size);
+        }
+}
+
+static void run_tagged_batch(size_t size, unsigned long iters)
+{
+        while (iters--) {
+                sha256_tagged_batch(out, &tag, messages, challenge_lengths, size);
+        }
+}
+
+static void run_hkdf(size_t size, unsigned long iters)
+{
+        while (iters--) {
+                sha256_hkdf_expand((unsigned char*)out, size, &hmac_key, "key expansion", 13);
+        }
+}
+
+static void run_sha512(size_t size, unsigned long iters)
+{
+        while (iters--) {
+                struct sha512_ctx ctx = SHA512_INIT;
+                sha512_update(&ctx, data, size);
+                sha512_done(&hashes512[0], &ctx);
+        }
+}
+
+static void run_sha512_batch(size_t size, unsigned long iters)
+{
+        while (iters--) {
+                sha512_batch(hashes512, messages, lengths, size);
+        }
+}
+
+/* A BIP39 seed: PBKDF2-HMAC-SHA512 of a candidate mnemonic, with the salt
+ * "mnemonic" and an empty passphrase. */
+#define BIP39_ITERATIONS 2048
+
+static void run_bip39(size_t size, unsigned long iters)
+{
+        while (iters--) {
+                sha512_pbkdf2_batch(seeds, 64, messages, lengths, bip39_salts, bip39_salt_lengths, size, BIP39_ITERATIONS);
+        }
+}
+
+static const size_t stream_sizes[] = {
+        1, 4, 16, 64, 256, 1 << 10, 4 << 10, 16 << 10, 64 << 10, 256 << 10, 1 << 20, 4 << 20, 16 << 20, 0
+};
+
+/* Message lengths around the one- and two-block padding boundaries. */
+static const size_t oneshot_sizes[] = { 1, 32, 55, 56, 64, 119, 120, 0 };
+
+/* Powers of two, plus sizes that exercise the narrower lane remainders. */
+static const size_t batch_sizes[] = { 1, 2, 3, 4, 7, 8, 15, 16, 32, 64, 128, 256, 512, 1024, 0 };
+
+/* Output lengths of a few keys, up to a full key block. */
+static const size_t hkdf_sizes[] = { 16, 32, 48, 64, 128, 0 };
+
+/* Numbers of passwords, each far more work than a block. */
+static const size_t pbkdf2_sizes[] = { 1, 4, 8, 16, 64, 0 };
+
+/** The benchmarked operations.  Each size is a message length in bytes, or a
+ * number of 64-byte blocks, messages or passwords for the batched interfaces.
+ * Operations with an item name are also reported in items per second.  The
+ * SHA-512 operations do not use the SHA-256 kernels, so they run only once,
+ * with the kernels sha512_auto_detect() describes. */
+static const struct {
+        const char* name;
+        void (*run)(size_t size, unsigned long iters);
+        const size_t* sizes;
+        size_t unit;
+        const char* item;
+        int sha512;
+} ops[] = {
+        { "stream", run_stream, stream_sizes, 1, NULL, 0 },
+        { "oneshot", run_oneshot, oneshot_sizes, 1, NULL, 0 },
+        { "double64", run_double64, batch_sizes, 64, NULL, 0 },
+        { "midstate", run_midstate, batch_sizes, 64, NULL, 0 },
+        { "hash64", run_hash64, batch_sizes, 64, NULL, 0 },
+        { "hmac", run_hmac, oneshot_sizes, 1, NULL, 0 },
+        { "hmacbatch", run_hmac_batch, batch_sizes, 64, NULL, 0 },
+        { "suffixes", run_suffixes, batch_sizes, 64, NULL, 0 },
+        { "tagged", run_tagged_batch, batch_sizes, 96, NULL, 0 },
+        { "hkdf", run_hkdf, hkdf_sizes, 1, NULL, 0 },
+        { "pbkdf2", run_pbkdf2, pbkdf2_sizes, 128 * PBKDF2_ITERATIONS, NULL, 0 },
+        { "sha512", run_sha512, stream_sizes, 1, NULL, 1 },
+        { "sha512batch", run_sha512_batch, batch_sizes, 64, NULL, 1 },
+        { "bip39", run_bip39, pbkdf2_sizes, 256 * BIP39_ITERATIONS, "candidates", 1 },
+};
+
+#define OPS (sizeof(ops) / sizeof(ops[0]))
+
+#if defined(HAVE_LIBCRYPTO)
+/* The same workloads through OpenSSL */
+
+static EVP_MD_CTX* evp_ctx;
+static EVP_MD* evp_sha256;
+
+static void run_openssl_stream(size_t size, unsigned long iters)
+{
+        while (iters--) {
+                EVP_DigestInit_ex(evp_ctx, evp_sha256, NULL);
+                EVP_DigestUpdate(evp_ctx, data, size);
+                EVP_DigestFinal_ex(evp_ctx, out[0].u8, NULL);
+        }
+}
+
+static void run_openssl_oneshot(size_t size, unsigned long iters)
+{
+        while (iters--) {
+                SHA256(data, size, out[0].u8);
+        }
+}
+
+static void run_openssl_double64(size_t size, unsigned long iters)
+{
+        while (iters--) {
+                size_t i;
+                for (i = 0; i < size; ++i) {
+                        unsigned char tmp[32];
+                        SHA256(hashes[2 * i].u8, 64, tmp);
+                        SHA256(tmp, 32, out[i].u8);
+                }
+        }
+}
+
+/** The operations compared against OpenSSL, which has no midstate
+ * interface, named as in ops[]. */
+static const struct {
+        const char* name;
+        void (*run_openssl)(size_t size, unsigned long iters);
+} comparisons[] = {
+        { "stream", run_openssl_stream },
+        { "oneshot", run_openssl_oneshot },
+        { "double64", run_openssl_double64 },
+};
+
+static int openssl_init(void)
+{
+        evp_ctx = EVP_MD_CTX_new();
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+        /* Fetch once, rather than implicitly on every EVP_DigestInit_ex. */
+        evp_sha256 = EVP_MD_fetch(NULL, "SHA256", NULL);
+#else
+        evp_sha256 = (EVP_MD*)EVP_sha256();
+#endif
+        return evp_ctx && evp_sha256;
+}
+
+static void openssl_free(void)
+{
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+        EVP_MD_free(evp_sha256);
+#endif
+        EVP_MD_CTX_free(evp_ctx);
+}
+#endif /* HAVE_LIBCRYPTO */
+
+/* Measurement */
+
+struct result {
+        double ns;     /* per call */
+        double cycles; /* per call, or 0 if unavailable */
+        double events[MAX_COUNTERS]; /* per call, for each open counter */
+};
+
+/** Time one operation, running it for at least min_ns per trial and keeping
+ * the fastest of three trials. */
+static void measure(void (*run)(size_t, unsigned long), size_t size, double min_ns, struct result* r)
+{
+        unsigned long iters = 1;
+        int trial;
+
+        /* Warm up, and find an iteration count that takes long enough. */
+        for (;;) {
+                double start = now_ns();
+                run(size, iters);
+                if (now_ns() - start >= min_ns || iters >= 1ul << 30) {
+                        break;
+                }
+                iters *= 2;
+        }
+
+        for (trial = 0; trial < 3; ++trial) {
+                double start = now_ns(), ns;
+                uint64_t tsc = read_tsc();
+                run(size, iters);
+                tsc = read_tsc() - tsc;
+                ns = now_ns() - start;
+                if (!trial || ns / iters < r->ns) {
+                        r->ns = ns / iters;
+                        r->cycles = (double)tsc / iters;
+                }
+        }
+
+        if (num_counters) {
+                size_t i;
+                count_events(run, size, iters, r->events);
+                for (i = 0; i < num_counters; ++i) {
+                        r->events[i] /= iters;
+                }
+        }
+}
+
+/* Multi-core scaling */
+
+/* Each call hashes a batch this large, reading 64 KiB. */
+#define SCALE_BATCH 1024
+#define SCALE_CALL_BYTES (SCALE_BATCH * 64)
+
+/* Per-thread input size for the DRAM-resident runs, chosen to exceed any
+ * core's share of the last level cache. */
+#define SCALE_DRAM_BYTES (32u << 20)
+
+struct worker {
+        pthread_t thread;
+        int cpu;
+        size_t op;
+        size_t in_size;
+        unsigned char* in;
+        struct sha256* out;
+        unsigned long calls;
+};
+
+static volatile int workers_ready;
+static volatile int workers_go;
+static volatile int workers_stop;
+static pthread_mutex_t workers_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/** Pin the calling thread to a processor, where supported. */
+static void pin_thread(int cpu)
+{
+#if defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        sched_setaffinity(0, sizeof(set), &set);
+#else
+        (void)cpu;
+#endif
+}
+
+static void* worker_main(void* arg)
+{
+        struct worker* w = (struct worker*)arg;
+        int double64 = !strcmp(ops[w->op].name, "double64");
+        size_t offset = 0, i;
+
+        /* Touch the input from the pinned thread so it is allocated locally. */
+        pin_thread(w->cpu);
+        for (i = 0; i < w->in_size; ++i) {
+                w->in[i] = (unsigned char)(i * 131 + (i >> 8));
+        }
+        pthread_mutex_lock(&workers_lock);
+        ++workers_ready;
+        pthread_mutex_unlock(&workers_lock);
+
+        while (!workers_go) {
+        }
+        while (!workers_stop) {
+                if (double64) {
+                        sha256_double64(w->out, (const struct sha256*)(w->in + offset), SCALE_BATCH);
+                } else {
+                        sha256_midstate(w->out, midstate, w->in + offset, SCALE_BATCH);
+                }
+                offset += SCALE_CALL_BYTES;
+                if (offset + SCALE_CALL_BYTES > w->in_size) {
+                        offset = 0;
+                }
+                ++w->calls;
+        }
+        return NULL;
+}
+
+/** Run an operation on the given number of pinned threads at once for
+ * duration_ns, returning the aggregate throughput in bytes per second, or a
+ * negative value on failure. */
+static double run_threads(size_t op, int threads, int cpus, size_t in_size, double duration_ns)
+{
+        struct worker* workers = (struct worker*)calloc(threads, sizeof(struct worker));
+        struct timespec pause;
+        double start, elapsed, total = 0;
+        int i, started = 0;
+
+        if (!workers) {
+                return -1;
+        }
+        workers_ready = workers_go = workers_stop = 0;
+        for (i = 0; i < threads; ++i) {
+                workers[i].cpu = i % cpus;
+                workers[i].op = op;
+                workers[i].in_size = in_size;
+                workers[i].in = (unsigned char*)malloc(in_size);
+                workers[i].out = (struct sha256*)malloc(SCALE_BATCH * sizeof(struct sha256));
+                if (!workers[i].in || !workers[i].out || pthread_create(&workers[i].thread, NULL, worker_main, &workers[i])) {
+                        free(workers[i].in);
+                        free(workers[i].out);
+                        break;
+                }
+                ++started;
+        }
+        if (started == threads) {
+                for (;;) {
+                        int ready;
+                        pthread_mutex_lock(&workers_lock);
+                        ready = workers_ready;
+                        pthread_mutex_unlock(&workers_lock);
+                        if (ready == threads) {
+                                break;
+                        }
+                }
+        }
+
+        start = now_ns();
+        workers_go = 1;
+        pause.tv_sec = (time_t)(duration_ns / 1e9);
+        pause.tv_nsec = (long)(duration_ns - pause.tv_sec * 1e9);
+        if (started == threads) {
+                nanosleep(&pause, NULL);
+        }
+        workers_stop = 1;
+        elapsed = now_ns() - start;
+
+        for (i = 0; i < started; ++i) {
+                pthread_join(workers[i].thread, NULL);
+                total += workers[i].calls;
+                free(workers[i].in);
+                free(workers[i].out);
+        }
+        free(workers);
+        return started == threads ? total * SCALE_CALL_BYTES * 1e9 / elapsed : -1;
+}
+
+/* Reporting */
+
+enum format { FORMAT_TEXT, FORMAT_CSV, FORMAT_JSON };
+
+static enum format format = FORMAT_TEXT;
+static int scaling = 0;
+static int compare = 0;
+static int rows = 0;
+
+/** Print the column headings for the open counters: derived IPC, clock
+ * frequency and APERF/MPERF ratio when their inputs are available, followed
+ * by each counter per call. */
+static void report_counters_header(void)
+{
+        size_t i;
+        if (!num_counters) {
+                return;
+        }
+        if (format == FORMAT_TEXT) {
+                printf(" %6s %6s %6s", "ipc", "GHz", "a/m");
+                for (i = 0; i < num_counters; ++i) {
+                        printf(" %12.12s", counters[i].name);
+                }
+        } else if (format == FORMAT_CSV) {
+                printf(",ipc,ghz,aperf_mperf");
+                for (i = 0; i < num_counters; ++i) {
+                        printf(",%s_per_call", counters[i].name);
+                }
+        }
+}
+
+/** Print a derived metric, or a placeholder if its inputs are missing. */
+static void report_metric(const char* name, double value)
+{
+        switch (format) {
+        case FORMAT_TEXT:
+                if (value) {
+                        printf(" %6.3g", value);
+                } else {
+                        printf(" %6s", "-");
+                }
+                break;
+        case FORMAT_CSV:
+                if (value) {
+                        printf(",%.4f", value);
+                } else {
+                        printf(",");
+                }
+                break;
+        case FORMAT_JSON:
+                if (value) {
+                        printf(", \"%s\": %.4f", name, value);
+                } else {
+                        printf(", \"%s\": null", name);
+                }
+                break;
+        }
+}
+
+static void report_counters(const struct result* r)
+{
+        double ipc = 0, ghz = 0, am = 0;
+        size_t i;
+        if (!num_counters) {
+                return;
+        }
+        if (counter_instructions >= 0 && counter_cycles >= 0 && r->events[counter_cycles] > 0) {
+                ipc = r->events[counter_instructions] / r->events[counter_cycles];
+        }
+        if (counter_cycles >= 0 && r->ns > 0) {
+                ghz = r->events[counter_cycles] / r->ns;
+        }
+        if (counter_aperf >= 0 && counter_mperf >= 0 && r->events[counter_mperf] > 0) {
+                am = r->events[counter_aperf] / r->events[counter_mperf];
+        }
+        report_metric("ipc", ipc);
+        report_metric("ghz", ghz);
+        report_metric("aperf_mperf", am);
+        switch (format) {
+        case FORMAT_TEXT:
+                for (i = 0; i < num_counters; ++i) {
+                        printf(" %12.5g", r->events[i]);
+                }
+                break;
+        case FORMAT_CSV:
+                for (i = 0; i < num_counters; ++i) {
+                        printf(",%.4f", r->events[i]);
+                }
+                break;
+        case FORMAT_JSON:
+                printf(", \"counters\": {");
+                for (i = 0; i < num_counters; ++i) {
+                        printf("%s\"%s\": %.4f", i ? ", " : "", counters[i].name, r->events[i]);
+                }
+                printf("}");
+                break;
+        }
+}
+
+static void report_begin(void)
+{
+        if (compare) {
+                switch (format) {
+                case FORMAT_TEXT:
+                        printf("%-8s %-9s %9s %9s %13s %13s %8s\n", "backend", "op", "size", "bytes", "libsha2 ns", "openssl ns", "speedup");
+                        break;
+                case FORMAT_CSV:
+                        printf("backend,description,op,size,bytes,libsha2_ns_per_call,openssl_ns_per_call,speedup\n");
+                        break;
+                case FORMAT_JSON:
+                        printf("{\n  \"comparison\": [");
+                        break;
+                }
+                return;
+        }
+        if (scaling) {
+                switch (format) {
+                case FORMAT_TEXT:
+                        printf("%-8s %-9s %-6s %7s %12s %12s %10s\n", "backend", "op", "set", "threads", "total MB/s", "MB/s/thread", "efficiency");
+                        break;
+                case FORMAT_CSV:
+                        printf("backend,description,op,working_set,threads,total_mb_per_s,mb_per_s_per_thread,efficiency\n");
+                        break;
+                case FORMAT_JSON:
+                        printf("{\n  \"scaling\": [");
+                        break;
+                }
+                return;
+        }
+        switch (format) {
+        case FORMAT_TEXT:
+                printf("%-8s %-9s %9s %9s %13s %13s %9s %10s", "backend", "op", "size", "bytes", "ns/call", "cycles/call", "cpb", "MB/s");
+                report_counters_header();
+                printf("\n");
+                break;
+        case FORMAT_CSV:
+                printf("backend,description,op,size,bytes,ns_per_call,cycles_per_call,cycles_per_byte,mb_per_s");
+                report_counters_header();
+                printf("\n");
+                break;
+        case FORMAT_JSON:
+                printf("{\n  \"tsc\": %s,\n  \"results\": [", HAVE_TSC ? "true" : "false");
+                break;
+        }
+}
+
+static void report(const char* backend, const char* description, size_t op, size_t size, const struct result* r)
+{
+        size_t bytes = size * ops[op].unit;
+        double cpb = bytes ? r->cycles / bytes : 0;
+        double mbps = r->ns > 0 ? bytes * 1e3 / r->ns : 0;
+        switch (format) {
+        case FORMAT_TEXT:
+                printf("%-8s %-9s %9lu %9lu %13.1f ", backend, ops[op].name, (unsigned long)size, (unsigned long)bytes, r->ns);
+                if (HAVE_TSC) {
+                        printf("%13.1f %9.3f", r->cycles, cpb);
+                } else {
+                        printf("%13s %9s", "-", "-");
+                }
+                printf(" %10.1f", mbps);
+                report_counters(r);
+                if (ops[op].item) {
+                        printf("  %.1f %s/s", r->ns > 0 ? size * 1e9 / r->ns : 0, ops[op].item);
+                }
+                printf("\n");
+                break;
+        case FORMAT_CSV:
+                printf("%s,\"%s\",%s,%lu,%lu,%.3f,", backend, description, ops[op].name, (unsigned long)size, (unsigned long)bytes, r->ns);
+                if (HAVE_TSC) {
+                        printf("%.3f,%.5f", r->cycles, cpb);
+                } else {
+                        printf(",");
+                }
+                printf(",%.3f", mbps);
+                report_counters(r);
+                printf("\n");
+                break;
+        case FORMAT_JSON:
+                printf("%s\n    {\"backend\": \"%s\", \"description\": \"%s\", \"op\": \"%s\", \"size\": %lu, \"bytes\": %lu, \"ns_per_call\": %.3f, ",
+                       rows ? "," : "", backend, description, ops[op].name, (unsigned long)size, (unsigned long)bytes, r->ns);
+                if (HAVE_TSC) {
+                        printf("\"cycles_per_call\": %.3f, \"cycles_per_byte\": %.5f, ", r->cycles, cpb);
+                } else {
+                        printf("\"cycles_per_call\": null, \"cycles_per_byte\": null, ");
+                }
+                printf("\"mb_per_s\": %.3f", mbps);
+                if (ops[op].item) {
+                        printf(", \"%s_per_s\": %.3f", ops[op].item, r->ns > 0 ? size * 1e9 / r->ns : 0);
+                }
+                report_counters(r);
+                printf("}");
+                break;
+        }
+        ++rows;
+        fflush(stdout);
+}
+
+/** Report a comparison.  The speedup is OpenSSL's time divided by libsha2's,
+ * so values above 1 favour libsha2. */
+static void report_compare(const char* backend, const char* description, size_t op, size_t size, const struct result* ours, const struct result* theirs)
+{
+        size_t bytes = size * ops[op].unit;
+        double speedup = ours->ns > 0 ? theirs->ns / ours->ns : 0;
+        switch (format) {
+        case FORMAT_TEXT:
+                printf("%-8s %-9s %9lu %9lu %13.1f %13.1f %8.3f\n", backend, ops[op].name, (unsigned long)size, (unsigned long)bytes, ours->ns, theirs->ns, speedup);
+                break;
+        case FORMAT_CSV:
+                printf("%s,\"%s\",%s,%lu,%lu,%.3f,%.3f,%.4f\n", backend, description, ops[op].name, (unsigned long)size, (unsigned long)bytes, ours->ns, theirs->ns, speedup);
+                break;
+        case FORMAT_JSON:
+                printf("%s\n    {\"backend\": \"%s\", \"description\": \"%s\", \"op\": \"%s\", \"size\": %lu, \"bytes\": %lu, \"libsha2_ns_per_call\": %.3f, \"openssl_ns_per_call\": %.3f, \"speedup\": %.4f}",
+                       rows ? "," : "", backend, description, ops[op].name, (unsigned long)size, (unsigned long)bytes, ours->ns, theirs->ns, speedup);
+                break;
+        }
+        ++rows;
+        fflush(stdout);
+}
+
+/** Report a scaling run.  Efficiency is the per-thread throughput relative to
+ * a single thread on the same working set. */
+static void report_scaling(const char* backend, const char* description, size_t op, const char* set, int threads, double bytes_per_s, double single)
+{
+        double mbps = bytes_per_s / 1e6;
+        double efficiency = single > 0 ? bytes_per_s / threads / single : 0;
+        switch (format) {
+        case FORMAT_TEXT:
+                printf("%-8s %-9s %-6s %7d %12.1f %12.1f %10.3f\n", backend, ops[op].name, set, threads, mbps, mbps / threads, efficiency);
+                break;
+        case FORMAT_CSV:
+                printf("%s,\"%s\",%s,%s,%d,%.3f,%.3f,%.4f\n", backend, description, ops[op].name, set, threads, mbps, mbps / threads, efficiency);
+                break;
+        case FORMAT_JSON:
+                printf("%s\n    {\"backend\": \"%s\", \"description\": \"%s\", \"op\": \"%s\", \"working_set\": \"%s\", \"threads\": %d, \"total_mb_per_s\": %.3f, \"mb_per_s_per_thread\": %.3f, \"efficiency\": %.4f}",
+                       rows ? "," : "", backend, description, ops[op].name, set, threads, mbps, mbps / threads, efficiency);
+                break;
+        }
+        ++rows;
+        fflush(stdout);
+}
+
+static void report_end(void)
+{
+        if (format == FORMAT_JSON) {
+                printf("\n  ]\n}\n");
+        }
+}
+
+/* Driver */
+
+/** Look up a kernel by name, returning 0 for "auto" and -1 if unknown. */
+static long parse_kernel(const char* name, size_t len)
+{
+        unsigned kernel;
+        if (len == 4 && !strncmp(name, "auto", 4)) {
+                return 0;
+        }
+        for (kernel = 1; kernel; kernel <<= 1) {
+                const char* k = sha256_kernel_name(kernel);
+                if (k && strlen(k) == len && !strncmp(name, k, len)) {
+                        return (long)kernel;
+                }
+        }
+        return -1;
+}
+
+/** Measure the batched operations on 1, 2, 4, ... up to max_threads threads,
+ * on both a cache-resident and a DRAM-resident working set. */
+static void bench_scaling(const char* backend, const char* description, double duration_ns, int max_threads, const char* only_op)
+{
+        static const struct {
+                const char* name;
+                size_t bytes;
+        } sets[] = {
+                { "cache", SCALE_CALL_BYTES },
+                { "dram", SCALE_DRAM_BYTES },
+        };
+        int cpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+        size_t op, set;
+        if (cpus < 1) {
+                cpus = 1;
+        }
+        for (op = 0; op < OPS; ++op) {
+                /* The workers only know how to run these two. */
+                if ((strcmp(ops[op].name, "double64") && strcmp(ops[op].name, "midstate")) || (only_op && strcmp(only_op, ops[op].name))) {
+                        continue;
+                }
+                for (set = 0; set < sizeof(sets) / sizeof(sets[0]); ++set) {
+                        double single = 0;
+                        int threads = 1;
+                        for (;;) {
+                                double rate = run_threads(op, threads, cpus, sets[set].bytes, duration_ns);
+                                if (rate < 0) {
+                                        fprintf(stderr, "bench_sha2: could not start %d threads\n", threads);
+                                        break;
+                                }
+                                if (threads == 1) {
+                                        single = rate;
+                                }
+                                report_scaling(backend, description, op, sets[set].name, threads, rate, single);
+                                if (threads == max_threads) {
+                                        break;
+                                }
+                                threads = threads * 2 < max_threads ? threads * 2 : max_threads;
+                        }
+                }
+        }
+}
+
+#if defined(HAVE_LIBCRYPTO)
+/** Run each workload through libsha2 and OpenSSL, checking that the results
+ * are identical before timing them.  Returns zero on a mismatch. */
+static int bench_compare(const char* backend, const char* description, double min_ns, const char* only_op)
+{
+        static struct sha256 expected[MAX_BATCH];
+        size_t c, i, op;
+        for (c = 0; c < sizeof(comparisons) / sizeof(comparisons[0]); ++c) {
+                if (only_op && strcmp(only_op, comparisons[c].name)) {
+                        continue;
+                }
+                op = 0;
+                while (op < OPS && strcmp(ops[op].name, comparisons[c].name)) {
+                        ++op;
+                }
+                if (op == OPS) {
+                        fprintf(stderr, "bench_sha2: no operation named %s\n", comparisons[c].name);
+                        return 0;
+                }
+                for (i = 0; ops[op].sizes[i]; ++i) {
+                        size_t size = ops[op].sizes[i];
+                        size_t outputs = ops[op].unit == 64 ? size : 1;
+                        struct result ours, theirs;
+                        ops[op].run(size, 1);
+                        memcpy(expected, out, outputs * sizeof(struct sha256));
+                        comparisons[c].run_openssl(size, 1);
+                        if (memcmp(expected, out, outputs * sizeof(struct sha256))) {
+                                fprintf(stderr, "bench_sha2: %s %s results differ from OpenSSL for size %lu\n", backend, ops[op].name, (unsigned long)size);
+                                return 0;
+                        }
+                        measure(ops[op].run, size, min_ns, &ours);
+                        measure(comparisons[c].run_openssl, size, min_ns, &theirs);
+                        report_compare(backend, description, op, size, &ours, &theirs);
+                }
+        }
+        return 1;
+}
+#endif
+
+/** Measure each operation of one family at every size. */
+static void bench_ops(const char* backend, const char* description, int sha512, double min_ns, const char* only_op)
+{
+        size_t op, i;
+        for (op = 0; op < OPS; ++op) {
+                if (ops[op].sha512 != sha512 || (only_op && strcmp(only_op, ops[op].name))) {
+                        continue;
+                }
+                for (i = 0; ops[op].sizes[i]; ++i) {
+                        struct result r;
+                        measure(ops[op].run, ops[op].sizes[i], min_ns, &r);
+                        report(backend, description, op, ops[op].sizes[i], &r);
+                }
+        }
+}
+
+/** Benchmark every SHA-256 operation with the given kernel, or with the
+ * default selection if kernel is 0.  Returns zero on failure. */
+static int bench_backend(unsigned kernel, double min_ns, int max_threads, const char* only_op)
+{
+        const char* backend = kernel ? sha256_kernel_name(kernel) : "auto";
+        const char* description;
+        if (sha256_select_backend(kernel)) {
+                fprintf(stderr, "bench_sha2: backend %s is not available\n", backend);
+                return 1;
+        }
+        description = sha256_auto_detect();
+#if defined(HAVE_LIBCRYPTO)
+        if (compare) {
+                return bench_compare(backend, description, min_ns, only_op);
+        }
+#endif
+        if (scaling) {
+                bench_scaling(backend, description, 10 * min_ns, max_threads, only_op);
+                return 1;
+        }
+        bench_ops(backend, description, 0, min_ns, only_op);
+        return 1;
+}
+
+static void usage(const char* argv0)
+{
+        fprintf(stderr, "Usage: %s [-f text|csv|json] [-t msec] [-b backend,...] [-o op] [-p] [-e name=rXXXX,...] [-j threads | -c]\n", argv0);
+        fprintf(stderr, "  -f  output format (default text)\n");
+        fprintf(stderr, "  -t  minimum time per measurement in milliseconds (default 20)\n");
+        fprintf(stderr, "  -b  backends to run: auto, or kernel names (default auto and every available kernel)\n");
+        fprintf(stderr, "  -o  run only one of stream, oneshot, double64, midstate, hash64, hmac, hmacbatch, suffixes, tagged, hkdf, pbkdf2, sha512, sha512batch, bip39\n");
+        fprintf(stderr, "  -p  report hardware performance counters (Linux perf_event) for each measurement\n");
+        fprintf(stderr, "  -e  add raw perf events, e.g. uops_port7=r80a1 (implies -p)\n");
+        fprintf(stderr, "  -j  measure double64 and midstate scaling on 1 up to this many pinned threads,\n");
+        fprintf(stderr, "      each run lasting ten times -t; 0 means one per processor\n");
+#if defined(HAVE_LIBCRYPTO)
+        fprintf(stderr, "  -c  compare stream, oneshot and double64 against OpenSSL, verifying identical output\n");
+#endif
+        fprintf(stderr, "Cycles are time stamp counter ticks, which may differ from core clock cycles.\n");
+}
+
+int main(int argc, char *argv[])
+{
+        const char* backends = NULL;
+        const char* only_op = NULL;
+        const char* extra_counters = NULL;
+        int counting = 0;
+        double min_ns = 20e6;
+        int max_threads = 0;
+        unsigned kernel;
+        size_t i;
+        int arg, ok = 1;
+
+        for (arg = 1; arg < argc; ++arg) {
+                const char* opt = argv[arg];
+                const char* val = arg + 1 < argc ? argv[arg + 1] : NULL;
+                if (!strcmp(opt, "-h") || !strcmp(opt, "--help")) {
+                        usage(argv[0]);
+                        return 0;
+                }
+                if (!strcmp(opt, "-p")) {
+                        counting = 1;
+                        continue;
+                }
+                if (!strcmp(opt, "-c")) {
+#if defined(HAVE_LIBCRYPTO)
+                        compare = 1;
+                        continue;
+#else
+                        fprintf(stderr, "bench_sha2: built without libcrypto\n");
+                        return 1;
+#endif
+                }
+                if (!val || opt[0] != '-' || !opt[1] || opt[2]) {
+                        usage(argv[0]);
+                        return 1;
+                }
+                ++arg;
+                switch (opt[1]) {
+                case 'f':
+                        if (!strcmp(val, "text")) {
+                                format = FORMAT_TEXT;
+                        } else if (!strcmp(val, "csv")) {
+                                format = FORMAT_CSV;
+                        } else if (!strcmp(val, "json")) {
+                                format = FORMAT_JSON;
+                        } else {
+                                usage(argv[0]);
+                                return 1;
+                        }
+                        break;
+                case 't':
+                        min_ns = atof(val) * 1e6;
+                        break;
+                case 'b':
+                        backends = val;
+                        break;
+                case 'o':
+                        only_op = val;
+                        break;
+                case 'e':
+                        counting = 1;
+                        extra_counters = val;
+                        break;
+                case 'j':
+                        scaling = 1;
+                        max_threads = atoi(val);
+                        if (max_threads <= 0) {
+                                max_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+                        }
+                        if (max_threads <= 0) {
+                                max_threads = 1;
+                        }
+                        break;
+                default:
+                        usage(argv[0]);
+                        return 1;
+                }
+        }
+
+        data = (unsigned char*)malloc(MAX_STREAM);
+        if (!data) {
+                fprintf(stderr, "bench_sha2: out of memory\n");
+                return 1;
+        }
+        for (i = 0; i < MAX_STREAM; ++i) {
+                data[i] = (unsigned char)(i * 131 + (i >> 8));
+        }
+        for (i = 0; i < 2 * MAX_BATCH; ++i) {
+                sha256(&hashes[i], &data[i], 32);
+        }
+        {
+                struct sha256_ctx ctx = SHA256_INIT;
+                sha256_update(&ctx, data, 64);
+                memcpy(midstate, ctx.s, sizeof(midstate));
+        }
+        sha256_hmac_key_init(&hmac_key, data, 32);
+        sha256_tag_init(&tag, "BIP0340/challenge", 17);
+        /* A prefix that leaves a partial block buffered. */
+        sha256_init(&prefix);
+        sha256_update(&prefix, data, 1000);
+        for (i = 0; i < MAX_BATCH; ++i) {
+                messages[i] = &data[64 * i];
+                lengths[i] = 64;
+                hmac_keys[i] = &hmac_key;
+                keys[i] = out[i].u8;
+                challenge_lengths[i] = 96;
+                seeds[i] = hashes512[i].u8;
+                bip39_salts[i] = "mnemonic";
+                bip39_salt_lengths[i] = 8;
+        }
+
+        if (counting && !scaling && !compare) {
+                default_counters();
+                if (extra_counters && !parse_counters(extra_counters)) {
+                        usage(argv[0]);
+                        return 1;
+                }
+                if (!open_counters()) {
+                        fprintf(stderr, "bench_sha2: no performance counters are available; see perf_event_paranoid\n");
+                }
+        }
+
+#if defined(HAVE_LIBCRYPTO)
+        if (compare && !openssl_init()) {
+                fprintf(stderr, "bench_sha2: could not initialize OpenSSL\n");
+                return 1;
+        }
+#endif
+
+        report_begin();
+        if (backends) {
+                const char* p = backends;
+                while (*p) {
+                        size_t len = strcspn(p, ",");
+                        long k = parse_kernel(p, len);
+                        if (k < 0) {
+                                fprintf(stderr, "bench_sha2: unknown backend %.*s\n", (int)len, p);
+                        } else {
+                                ok &= bench_backend((unsigned)k, min_ns, max_threads, only_op);
+                        }
+                        p += len;
+                        p += *p == ',';
+                }
+        } else {
+                unsigned available = sha256_available_kernels();
+                /* Kernels can only be run individually when not pinned. */
+                int pinned = sha256_select_backend(SHA256_KERNEL_GENERIC) != 0;
+                ok &= bench_backend(0, min_ns, max_threads, only_op);
+                for (kernel = 1; kernel && !pinned; kernel <<= 1) {
+                        if (available & kernel) {
+                                ok &= bench_backend(kernel, min_ns, max_threads, only_op);
+                        }
+                }
+        }
+        if (!scaling && !compare) {
+                /* sha256_select_backend() does not reach the SHA-512 kernels. */
+                bench_ops("auto", sha512_auto_detect(), 1, min_ns, only_op);
+        }
+        report_end();
+
+        sha256_select_backend(0);
+#if defined(HAVE_LIBCRYPTO)
+        if (compare) {
+                openssl_free();
+        }
+#endif
+        free(data);
+        return ok ? 0 : 1;
+}
+
+/* End of File
+ */
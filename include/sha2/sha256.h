@@ -28,13 +28,140 @@ extern "C" {
  * implementation to use.  A pointer to an internal buffer is returned to the
  * caller, containing a string naming the algorithms selected.
  *
- * This API is automatically called the first time a hash update is performed,
- * however it is not thread safe.  To query capabilities in a thread-safe way,
- * and to report the selected algorithm to the user, please call this function
- * during program initialization.
+ * Detection runs exactly once and is thread safe.  With GCC-compatible
+ * compilers it happens in a library constructor; every hashing function (and
+ * this function) also checks a once-guard, pthread_once() where available,
+ * so calls made before the constructor runs detect first.  The hashing
+ * functions then call the selected kernels through function pointers, which
+ * sha256_select_backend() and sha256_calibrate() rebind.  Calling this
+ * function is therefore only necessary to report the selected algorithm to
+ * the user.
+ *
+ * If the library was configured with --with-sha256-backend, the kernels are
+ * fixed at compile time and no detection takes place.
  */
 const char* sha256_auto_detect(void);
 
+/**
+ * @brief Identifiers for the SHA256 kernel implementations.
+ *
+ * Each kernel is a family of compression functions for one instruction set,
+ * processing one or more independent messages ("lanes") at a time.  The values
+ * are distinct bits, so that sets of kernels can be passed around as a
+ * bitmask.  The lane widths each kernel supports are reported by
+ * sha256_kernel_lanes().
+ */
+enum sha256_kernel {
+        SHA256_KERNEL_GENERIC = 0x01, /* portable C, 1 lane */
+        SHA256_KERNEL_SSE4 = 0x02, /* x86-64 SSE4 assembly, 1 lane */
+        SHA256_KERNEL_SSE41 = 0x04, /* x86 SSE4.1, 4 lanes */
+        SHA256_KERNEL_AVX2 = 0x08, /* x86 AVX2, 8 lanes */
+        SHA256_KERNEL_SHANI = 0x10, /* x86 SHA extensions, 1 and 2 lanes */
+        SHA256_KERNEL_ARMV8 = 0x20, /* ARMv8 crypto extensions, 1 and 2 lanes */
+        SHA256_KERNEL_VEC = 0x40, /* portable compiler vectors, 4 and 8 lanes */
+        SHA256_KERNEL_AVX512 = 0x80 /* x86 AVX-512F, 16 lanes */
+};
+
+/**
+ * @brief Return the name of a kernel.
+ *
+ * @param kernel a single SHA256_KERNEL_* value
+ * @return const char* a static lowercase ASCII string, as accepted in the
+ * LIBSHA2_BACKEND environment variable, or NULL if \p kernel is not a single
+ * known kernel
+ */
+const char* sha256_kernel_name(unsigned kernel);
+
+/**
+ * @brief Return the lane widths supported by a kernel.
+ *
+ * @param kernel a single SHA256_KERNEL_* value
+ * @return unsigned the bitwise OR of the supported lane counts (which are all
+ * powers of two), e.g. 1|2 for a kernel with single- and dual-lane code paths,
+ * or 0 if \p kernel is not a single known kernel
+ */
+unsigned sha256_kernel_lanes(unsigned kernel);
+
+/**
+ * @brief Return the set of kernels that can be used on this host.
+ *
+ * @return unsigned a bitmask of SHA256_KERNEL_* values which were compiled
+ * into the library and are supported by the host CPU.  SHA256_KERNEL_GENERIC
+ * is always included, unless the library was configured with
+ * --with-sha256-backend, in which case only the configured kernels are.
+ */
+unsigned sha256_available_kernels(void);
+
+/**
+ * @brief Return the set of kernels presently in use.
+ *
+ * @return unsigned a bitmask of the SHA256_KERNEL_* values the library
+ * currently dispatches to.  SHA256_KERNEL_GENERIC is included if the generic
+ * code handles single-lane hashing.
+ */
+unsigned sha256_selected_kernels(void);
+
+/**
+ * @brief Restrict the library to a specific set of kernels.
+ *
+ * @param kernels a bitmask of SHA256_KERNEL_* values, or 0 to restore the
+ * automatically detected selection
+ * @return int 0 on success, or -1 (leaving the selection unchanged) if any of
+ * the requested kernels is unavailable on this host
+ *
+ * Each operation is dispatched to the fastest of the given kernels that
+ * implements it, or to the generic code if none does.  For example, passing
+ * SHA256_KERNEL_SSE4 | SHA256_KERNEL_SSE41 uses the SSE4 assembly for
+ * single-lane hashing and the SSE4.1 code for 4-lane operations, but never the
+ * AVX2 8-lane code.
+ *
+ * The same selection can be made without recompiling by setting the
+ * LIBSHA2_BACKEND environment variable to a comma-separated list of kernel
+ * names (e.g. "sse4,sse41"), which is read once at startup.  An unknown or
+ * unavailable kernel name causes the variable to be ignored, as does a setuid
+ * or setgid program.
+ *
+ * This function is not thread safe.  It rebinds the kernels one at a time and
+ * rewrites the string returned by sha256_auto_detect(), so it must not run
+ * while any other thread is hashing or reading that string: an in-flight call
+ * could see a missing kernel or a mix of two selections.  Make the selection
+ * at startup, before other threads use the library.  In builds configured
+ * with --with-sha256-backend only the configured set (or 0) is accepted.
+ */
+int sha256_select_backend(unsigned kernels);
+
+/**
+ * @brief Select the fastest kernel for each operation by measurement.
+ *
+ * @param cache_path a file in which to cache the results, or NULL
+ * @return int 1 if valid cached results were loaded, 0 if the kernels were
+ * benchmarked, or -1 if the library was configured with --with-sha256-backend
+ *
+ * The default selection follows a fixed order of preference, which is not
+ * always the fastest: on some processors the AVX2 8-lane code outperforms the
+ * SHA-NI 2-lane code for sha256_double64(), for example.  This function times
+ * every available kernel on the streaming transform and on each lane width of
+ * the sha256_double64() and sha256_midstate() kernels, and binds each
+ * operation to the winner.  A wider kernel is only used if it is faster per
+ * hash than the narrower ones, which decides how batches of each size are
+ * split.  Calibration takes on the order of a hundred milliseconds.
+ *
+ * If \p cache_path names a file written by an earlier call on the same host
+ * and library version, its results are used without benchmarking.  Otherwise
+ * the results are written to it, ignoring errors.  The file is replaced
+ * atomically, so a process starting meanwhile reads either the old results
+ * or the new ones.
+ *
+ * Setting the LIBSHA2_TUNE environment variable to the path of such a file
+ * loads its results at startup, restricted to the kernels named by
+ * LIBSHA2_BACKEND if that is also set.  A missing or stale file leaves the
+ * default selection in place: startup never benchmarks or writes, so create
+ * the file with this function.  Setuid and setgid programs ignore the
+ * variable.  Like sha256_select_backend(), this function must not run
+ * concurrently with any hashing.
+ */
+int sha256_calibrate(const char* cache_path);
+
 /**
  * @brief A structure representing a completed SHA256 hash digest value.
  *
@@ -149,6 +276,73 @@ void sha256_update(struct sha256_ctx* ctx, const void *data, size_t len);
  */
 void sha256_done(struct sha256* hash, struct sha256_ctx* ctx);
 
+/**
+ * @brief Finalize many messages that share a common prefix.
+ *
+ * @param out the n hashes to return
+ * @param prefix a context that has hashed the common prefix, left unchanged
+ * @param suffix pointers to the n suffixes
+ * @param len the lengths in bytes of the n suffixes
+ * @param n the number of suffixes
+ *
+ * Hash i is the SHA256 of the prefix followed by suffix i.  The result is the
+ * same as copying the context n times, then calling sha256_update() and
+ * sha256_done() on each copy, but the suffixes run side by side, one per lane
+ * of a multi-lane kernel.  Every lane resumes from the prefix state, and the
+ * prefix's buffered partial block is completed with each suffix in turn.
+ */
+void sha256_finalize_suffixes(struct sha256 out[], const struct sha256_ctx* prefix, const void* const suffix[], const size_t len[], size_t n);
+
+/**
+ * @brief Compute the SHA256 of a contiguous region of memory.
+ *
+ * @param hash the hash to return
+ * @param data a pointer to data in memory
+ * @param len the number of bytes pointed to by \p data
+ *
+ * Equivalent to sha256_init(), sha256_update() and sha256_done() on a fresh
+ * context.  Messages of up to 55 bytes are padded into a single block on the
+ * stack and compressed with exactly one transform call, and messages of up to
+ * 119 bytes with one call over two blocks, avoiding the buffering done by the
+ * streaming API.  This makes it the preferred interface for hashing many short
+ * keys.
+ */
+void sha256(struct sha256* hash, const void* data, size_t len);
+
+/**
+ * @brief Finalize a SHA256 and return the double-SHA256 of the hashed data.
+ *
+ * @param hash the hash to return
+ * @param ctx the sha256_ctx to finalize
+ *
+ * Equivalent to calling sha256_done() and then hashing the resulting 32-byte
+ * digest a second time, but the second compression is performed directly on
+ * the intermediate state words using a precomputed padding block, without the
+ * round trip through a second sha256_ctx.
+ *
+ * As with sha256_done(), the context is used up by this call and must be
+ * re-initialized before being used again.
+ */
+void sha256d_done(struct sha256* hash, struct sha256_ctx* ctx);
+
+/**
+ * @brief Compute the double-SHA256 of a contiguous region of memory.
+ *
+ * @param hash the hash to return
+ * @param data a pointer to data in memory
+ * @param len the number of bytes pointed to by \p data
+ *
+ * This is the hash construction Bitcoin and related projects use for
+ * transaction identifiers, SHA256(SHA256(data)).
+ *
+ * Example:
+ * static void txid(const unsigned char* tx, size_t len, struct sha256* hash)
+ * {
+ *         sha256d(hash, tx, len);
+ * }
+ */
+void sha256d(struct sha256* hash, const void* data, size_t len);
+
 /**
  * @brief Perform a Merkle-tree compression step using double-SHA256
  *
@@ -164,8 +358,8 @@ void sha256_done(struct sha256* hash, struct sha256_ctx* ctx);
  * because of various optimizations that are available due to the fixed format
  * of the input, this only requires about 2.32x more computation compared with a
  * single round of SHA256. In addition, various multi-lane optimizations are
- * available allowing for up to 8 hashes to be performed simultaneously on some
- * architectures.
+ * available allowing for up to 16 hashes to be performed simultaneously on
+ * some architectures.
  *
  * The origin of this primitive is in how Bitcoin and related projects construct
  * Merkle trees by performing double-SHA256 hashes of child leaf values to
@@ -175,6 +369,20 @@ void sha256_done(struct sha256* hash, struct sha256_ctx* ctx);
  */
 void sha256_double64(struct sha256 out[], const struct sha256 in[], size_t blocks);
 
+/**
+ * @brief Perform a Merkle-tree compression step using single SHA256
+ *
+ * @param out an array of 1*blocks sha256 hash values
+ * @param in an array of 2*blocks sha256 hash values
+ * @param blocks the number of SHA256 hash operations to perform
+ *
+ * Like sha256_double64(), but each pair of input hashes is hashed only once,
+ * as in Merkle trees built with plain SHA256.  This takes two compression
+ * rounds per inner node, the second of them over constant padding, and uses
+ * the same multi-lane kernels.
+ */
+void sha256_hash64(struct sha256 out[], const struct sha256 in[], size_t blocks);
+
 /**
  * @brief Performs multiple SHA256 compression rounds in parallel using the same
  * initial state vector but differing data blocks
@@ -191,7 +399,7 @@ void sha256_double64(struct sha256 out[], const struct sha256 in[], size_t block
  * midstate vector and then attempting multiple final compression rounds in
  * parallel.
  *
- * For maximum performance blocks should be a multiple of 8, as that is the
+ * For maximum performance blocks should be a multiple of 16, as that is the
  * highest degree of parallelism on any presently supported architecture.
  *
  * Note that the midstate is delivered as host-ordered unsigned integers, the
@@ -216,6 +424,354 @@ void sha256_double64(struct sha256 out[], const struct sha256 in[], size_t block
  */
 void sha256_midstate(struct sha256 out[], const uint32_t midstate[8], const unsigned char in[], size_t blocks);
 
+/**
+ * @brief A structure for storing a SHA224 hash digest.
+ *
+ * @u8: an unsigned char array
+ *
+ * SHA224 is SHA256 started from a different initial state, with the digest
+ * truncated to its first 28 bytes.  It uses struct sha256_ctx, sha256_update()
+ * and the same compression kernels.
+ */
+struct sha224 {
+        unsigned char u8[28];
+};
+
+/**
+ * @brief Initializes a SHA256 context for computing a SHA224 hash.
+ *
+ * @param ctx the context to initialize
+ *
+ * Data is then added with sha256_update() and the context finalized with
+ * sha224_done().  Alternatively you may use the SHA224_INIT initialization
+ * constant instead.
+ */
+void sha224_init(struct sha256_ctx* ctx);
+
+/**
+ * @brief Initialization constant for a SHA224 context, equivalent to calling
+ * sha224_init().
+ */
+#define SHA224_INIT                                                   \
+        { { 0xc1059ed8ul, 0x367cd507ul, 0x3070dd17ul, 0xf70e5939ul,   \
+            0xffc00b31ul, 0x68581511ul, 0x64f98fa7ul, 0xbefa4fa4ul }, \
+          { { 0 } }, 0 }
+
+/**
+ * @brief Finalize a SHA224 and return the resulting hash.
+ *
+ * @param hash the hash to return
+ * @param ctx a sha256_ctx initialized with sha224_init()
+ *
+ * As with sha256_done(), the context is used up by this call.
+ */
+void sha224_done(struct sha224* hash, struct sha256_ctx* ctx);
+
+/**
+ * @brief Compute the SHA224 of a contiguous region of memory.
+ *
+ * @param hash the hash to return
+ * @param data a pointer to data in memory
+ * @param len the number of bytes pointed to by \p data
+ *
+ * Equivalent to sha224_init(), sha256_update() and sha224_done() on a fresh
+ * context, with the same short-message handling as sha256().
+ */
+void sha224(struct sha224* hash, const void* data, size_t len);
+
+/**
+ * @brief Compute the SHA224 of many independent messages.
+ *
+ * @param out an array of n hashes to return
+ * @param msg an array of n pointers to the messages
+ * @param len an array of n message lengths
+ * @param n the number of messages
+ *
+ * Each out[i] is set to the SHA224 of the len[i] bytes at msg[i].  Runs of
+ * messages of up to 55 bytes fit a single padded block each and are
+ * compressed together by the sha256_midstate() kernels, up to 16 at a time;
+ * longer messages are hashed one at a time as by sha224().
+ */
+void sha224_batch(struct sha224 out[], const void* const msg[], const size_t len[], size_t n);
+
+/**
+ * @brief Precomputed HMAC-SHA256 key state.
+ *
+ * @inner: the SHA256 midstate after compressing the key XOR ipad
+ * @outer: the SHA256 midstate after compressing the key XOR opad
+ *
+ * Both the inner and the outer hash of HMAC begin with a 64-byte block that
+ * depends only on the key.  sha256_hmac_key_init() compresses the two blocks
+ * once, and sha256_hmac() resumes from the resulting midstates, which saves
+ * two of the four compressions needed for a message of up to 55 bytes.
+ *
+ * The midstates are host-ordered words like sha256_ctx.s, so they can also
+ * be passed to sha256_midstate(): compressing the padded 32-byte inner digest
+ * from outer yields the MAC.  The key state is as sensitive as the key.
+ */
+struct sha256_hmac_key {
+        uint32_t inner[8];
+        uint32_t outer[8];
+};
+
+/**
+ * @brief Precompute the HMAC-SHA256 midstates of a key.
+ *
+ * @param key the key state to initialize
+ * @param secret a pointer to the key bytes
+ * @param len the number of bytes pointed to by \p secret
+ *
+ * As specified by RFC 2104, keys longer than 64 bytes are replaced by their
+ * SHA256 hash first.
+ */
+void sha256_hmac_key_init(struct sha256_hmac_key* key, const void* secret, size_t len);
+
+/**
+ * @brief Compute the HMAC-SHA256 of a contiguous region of memory.
+ *
+ * @param hash the MAC to return
+ * @param key a key state initialized with sha256_hmac_key_init()
+ * @param msg a pointer to the message in memory
+ * @param len the number of bytes pointed to by \p msg
+ *
+ * Example:
+ * static int verify(const struct sha256_hmac_key* key, const char* body, size_t len, const struct sha256* tag)
+ * {
+ *         struct sha256 mac;
+ *         sha256_hmac(&mac, key, body, len);
+ *         return constant_time_equal(mac.u8, tag->u8, 32);
+ * }
+ */
+void sha256_hmac(struct sha256* hash, const struct sha256_hmac_key* key, const void* msg, size_t len);
+
+/**
+ * @brief Compute the HMAC-SHA256 of many independent messages.
+ *
+ * @param out the n MACs to return
+ * @param key the key states of the n messages, which may all be the same
+ * @param msg pointers to the n messages
+ * @param len the lengths in bytes of the n messages
+ * @param n the number of messages
+ *
+ * The result is the same as calling sha256_hmac() on each message in turn,
+ * but the inner and then the outer hashes run side by side, one message per
+ * lane of a multi-lane kernel, with every lane resuming from the midstate of
+ * its own key.  Lanes advance one block at a time in lockstep, so the batch
+ * is fastest when the messages have about the same length; a message of up
+ * to 55 bytes takes one inner and one outer block.
+ */
+void sha256_hmac_batch(struct sha256 out[], const struct sha256_hmac_key* const key[], const void* const msg[], const size_t len[], size_t n);
+
+/**
+ * @brief The precomputed state of a BIP340 tag.
+ *
+ * @s: the SHA256 midstate after compressing SHA256(tag) || SHA256(tag)
+ *
+ * A tagged hash is SHA256(SHA256(tag) || SHA256(tag) || msg), so its first
+ * block depends only on the tag.  sha256_tag_init() compresses it once, and
+ * the tagged hash functions resume from the midstate.  Keep one per tag.
+ */
+struct sha256_tag {
+        uint32_t s[8];
+};
+
+/**
+ * @brief Precompute the midstate of a BIP340 tag.
+ *
+ * @param tag the tag state to initialize
+ * @param name a pointer to the tag bytes, e.g. "BIP0340/challenge"
+ * @param len the number of bytes pointed to by \p name
+ */
+void sha256_tag_init(struct sha256_tag* tag, const void* name, size_t len);
+
+/**
+ * @brief Compute the BIP340 tagged hash of a contiguous region of memory.
+ *
+ * @param hash the hash to return
+ * @param tag a tag state initialized with sha256_tag_init()
+ * @param msg a pointer to the message in memory
+ * @param len the number of bytes pointed to by \p msg
+ */
+void sha256_tagged(struct sha256* hash, const struct sha256_tag* tag, const void* msg, size_t len);
+
+/**
+ * @brief Compute the BIP340 tagged hashes of many messages under one tag.
+ *
+ * @param out the n hashes to return
+ * @param tag a tag state initialized with sha256_tag_init()
+ * @param msg pointers to the n messages
+ * @param len the lengths in bytes of the n messages
+ * @param n the number of messages
+ *
+ * The result is the same as calling sha256_tagged() on each message in turn,
+ * but the messages run side by side, one per lane of a multi-lane kernel,
+ * with every lane resuming from the tag midstate.  A BIP340 challenge hashes
+ * the 96 bytes R || P || m, which with its padding is two blocks per lane.
+ */
+void sha256_tagged_batch(struct sha256 out[], const struct sha256_tag* tag, const void* const msg[], const size_t len[], size_t n);
+
+/**
+ * @brief Extract a pseudorandom key with HKDF-SHA256.
+ *
+ * @param prk the pseudorandom key to return
+ * @param salt a pointer to the salt bytes, or NULL
+ * @param saltlen the number of bytes pointed to by \p salt, which may be 0
+ * @param ikm a pointer to the input keying material
+ * @param ikmlen the number of bytes pointed to by \p ikm
+ *
+ * As specified by RFC 5869, this is the HMAC-SHA256 of the input keying
+ * material under the salt.  An empty salt is treated as 32 zero bytes.
+ */
+void sha256_hkdf_extract(struct sha256* prk, const void* salt, size_t saltlen, const void* ikm, size_t ikmlen);
+
+/**
+ * @brief Expand a pseudorandom key into output keying material with
+ * HKDF-SHA256.
+ *
+ * @param out the output keying material to return
+ * @param outlen the number of bytes to write to \p out, at most 8160
+ * @param prk the pseudorandom key, initialized with sha256_hmac_key_init()
+ * @param info a pointer to the context and application specific information
+ * @param infolen the number of bytes pointed to by \p info
+ * @return int 0 on success, or -1 (writing nothing) if \p outlen exceeds
+ * the 8160 bytes RFC 5869 allows
+ *
+ * As specified by RFC 5869.  Every output block is an HMAC under the same
+ * key, so the key state is taken rather than the key bytes: initialize it
+ * once from the result of sha256_hkdf_extract(), and each block resumes from
+ * its midstates.  With up to 22 bytes of info, the message of every block fits
+ * in one compression, laid out once and updated in place.
+ *
+ * Example:
+ * static void session_keys(unsigned char client[16], unsigned char server[16], const struct sha256* secret)
+ * {
+ *         struct sha256_hmac_key prk;
+ *         sha256_hmac_key_init(&prk, secret->u8, 32);
+ *         sha256_hkdf_expand(client, 16, &prk, "client key", 10);
+ *         sha256_hkdf_expand(server, 16, &prk, "server key", 10);
+ * }
+ */
+int sha256_hkdf_expand(unsigned char* out, size_t outlen, const struct sha256_hmac_key* prk, const void* info, size_t infolen);
+
+/**
+ * @brief Derive a key from a password with PBKDF2-HMAC-SHA256.
+ *
+ * @param out the derived key to return
+ * @param outlen the number of bytes to write to \p out
+ * @param password a pointer to the password bytes
+ * @param pwlen the number of bytes pointed to by \p password
+ * @param salt a pointer to the salt bytes
+ * @param saltlen the number of bytes pointed to by \p salt
+ * @param iterations the iteration count, at least one
+ * @return int 0 on success, or -1 (writing nothing) if \p iterations is zero
+ *         or \p outlen exceeds (2^32 - 1) * 32 bytes
+ *
+ * As specified by RFC 8018.  Every iteration after the first hashes a 32-byte
+ * value, so it costs exactly two compressions from the password's HMAC
+ * midstates.  A key longer than 32 bytes is made of independent output
+ * blocks, which run side by side in the lanes of a multi-lane kernel when
+ * there are at least four of them.
+ */
+int sha256_pbkdf2(unsigned char* out, size_t outlen, const void* password, size_t pwlen, const void* salt, size_t saltlen, uint64_t iterations);
+
+/**
+ * @brief Derive keys from many passwords with PBKDF2-HMAC-SHA256.
+ *
+ * @param out the n derived keys to return, each of \p outlen bytes
+ * @param outlen the number of bytes to write to each key
+ * @param password pointers to the n passwords
+ * @param pwlen the lengths in bytes of the n passwords
+ * @param salt pointers to the n salts
+ * @param saltlen the lengths in bytes of the n salts
+ * @param n the number of passwords
+ * @param iterations the iteration count, shared by all passwords
+ * @return int 0 on success, or -1 (writing nothing) if \p iterations is zero
+ *         or \p outlen exceeds (2^32 - 1) * 32 bytes
+ *
+ * The result is the same as calling sha256_pbkdf2() on each password in turn,
+ * but the output blocks of all the passwords share the lanes of the
+ * multi-lane kernels.  Since every block takes the same number of iterations,
+ * the lanes stay busy until the last group of fewer than four blocks, which
+ * runs one at a time.
+ */
+int sha256_pbkdf2_batch(unsigned char* const out[], size_t outlen, const void* const password[], const size_t pwlen[], const void* const salt[], const size_t saltlen[], size_t n, uint64_t iterations);
+
+/**
+ * @brief The public entry points counted by struct sha256_stats.
+ *
+ * SHA256_API_DONE counts sha256_done(), sha256d_done() and sha224_done(),
+ * SHA256_API_ONESHOT counts sha224() and each message of sha224_batch() as
+ * well as sha256(), and SHA256_API_DOUBLE counts sha256d().
+ * SHA256_API_HMAC counts each message of sha256_hmac_batch() as well as
+ * sha256_hmac(), and SHA256_API_PBKDF2 counts each password of
+ * sha256_pbkdf2_batch() as well as sha256_pbkdf2(), with the output length as
+ * its bytes.  SHA256_API_HKDF counts sha256_hkdf_extract(), with the input
+ * keying material as its bytes, and sha256_hkdf_expand(), with the output.
+ * SHA256_API_TAGGED counts sha256_tagged() and each message of
+ * sha256_tagged_batch(), and SHA256_API_SUFFIXES counts each suffix of
+ * sha256_finalize_suffixes().
+ */
+enum sha256_api {
+        SHA256_API_UPDATE,
+        SHA256_API_DONE,
+        SHA256_API_ONESHOT,
+        SHA256_API_DOUBLE,
+        SHA256_API_DOUBLE64,
+        SHA256_API_MIDSTATE,
+        SHA256_API_HASH64,
+        SHA256_API_HMAC,
+        SHA256_API_PBKDF2,
+        SHA256_API_HKDF,
+        SHA256_API_TAGGED,
+        SHA256_API_SUFFIXES,
+        SHA256_API_COUNT
+};
+
+/**
+ * @brief Usage counters, summed over all threads.
+ *
+ * @api_calls: calls of each entry point, indexed by enum sha256_api
+ * @api_bytes: bytes of input passed to each entry point
+ * @kernel_calls: kernel invocations, indexed by the bit number of each
+ * enum sha256_kernel value (0 for SHA256_KERNEL_GENERIC, 4 for
+ * SHA256_KERNEL_SHANI, and so on)
+ * @kernel_blocks: 64-byte blocks compressed by each kernel, counting every
+ * lane of a multi-lane kernel
+ * @double64_lanes: sha256_double64() kernel calls processing 1, 2, 4, 8 and
+ * 16 lanes at once
+ * @midstate_lanes: likewise for sha256_midstate()
+ * @hash64_lanes: likewise for sha256_hash64()
+ *
+ * The lane histograms show how batches are split: a caller that passes 7
+ * blocks at a time on an AVX2 machine gets one 4-lane, one 2-lane and one
+ * single-lane call per batch, rather than the 8-lane kernel.
+ */
+struct sha256_stats {
+        uint64_t api_calls[SHA256_API_COUNT];
+        uint64_t api_bytes[SHA256_API_COUNT];
+        uint64_t kernel_calls[16];
+        uint64_t kernel_blocks[16];
+        uint64_t double64_lanes[5];
+        uint64_t midstate_lanes[5];
+        uint64_t hash64_lanes[5];
+};
+
+/**
+ * @brief Read the usage counters.
+ *
+ * @param stats receives the sums of every thread's counters since it started,
+ * including threads that have since exited
+ * @return int 0 on success, or -1 if the library was configured without
+ * --enable-stats, in which case \p stats is zeroed
+ *
+ * Counting is opt-in at configure time.  When enabled, each thread counts
+ * into its own storage without locks or atomic operations, and only this
+ * function takes a lock.  Counts for threads that are hashing concurrently
+ * may be slightly out of date.  Calls made by the self-test and calibration
+ * are not counted.
+ */
+int sha256_stats_snapshot(struct sha256_stats* stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,414 @@
+/* Copyright (c) 2014-2018 The Bitcoin Core developers
+ * Copyright (c) 2022 Mark Friedenbach
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef SHA2__SHA512_H
+#define SHA2__SHA512_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h> /* for uint64_t */
+#include <stdlib.h> /* for size_t */
+
+/**
+ * @brief Autodetect the best available SHA512 implementation.
+ *
+ * @return const char* an ASCII-encoded string describing the selected
+ * algorithm(s)
+ *
+ * The SHA512 counterpart of sha256_auto_detect(), with the same guarantees:
+ * detection runs exactly once and is thread safe, in a library constructor
+ * or on first use, and the kernels are called through function pointers.
+ * SHA384, SHA512/256, SHA512/224 and the batch interfaces use the kernels it
+ * selects.
+ * The selection is independent of SHA256: neither the LIBSHA2_BACKEND
+ * environment variable nor sha256_select_backend() and sha256_calibrate()
+ * affect it.
+ *
+ * If the library was configured with --with-sha256-backend=generic, the
+ * portable code is used without detection.
+ */
+const char* sha512_auto_detect(void);
+
+/**
+ * @brief A structure for storing a SHA512 hash digest.
+ *
+ * @u8: an unsigned char array
+ *
+ * Like struct sha256, the digest is stored in big-endian byte order.
+ */
+struct sha512 {
+        unsigned char u8[64];
+};
+
+/**
+ * @brief A structure for storing a SHA384 hash digest.
+ *
+ * @u8: an unsigned char array
+ */
+struct sha384 {
+        unsigned char u8[48];
+};
+
+/**
+ * @brief A structure for storing a SHA512/256 hash digest.
+ *
+ * @u8: an unsigned char array
+ */
+struct sha512_256 {
+        unsigned char u8[32];
+};
+
+/**
+ * @brief A structure for storing a SHA512/224 hash digest.
+ *
+ * @u8: an unsigned char array
+ */
+struct sha512_224 {
+        unsigned char u8[28];
+};
+
+/**
+ * @brief A structure for storing the running context of a SHA512 or SHA384
+ * hash.
+ *
+ * @s: the intermediate state in host-native byte order
+ * @buf: a buffer of up to 127 bytes of unhashed data
+ * @bytes: the total number of bytes hashed, including any buffered data
+ *
+ * The same as struct sha256_ctx, but with 64-bit state words and 128-byte
+ * blocks.  SHA384, SHA512/256 and SHA512/224 differ from SHA512 only in
+ * their initial states and in truncating the digest, so all of them share
+ * this context and sha512_update().
+ */
+struct sha512_ctx {
+        uint64_t s[8];
+        union {
+                uint64_t u64[16];
+                unsigned char u8[128];
+        } buf;
+        size_t bytes;
+};
+
+/**
+ * @brief Initializes a SHA512 context.
+ *
+ * @param ctx the context to initialize
+ */
+void sha512_init(struct sha512_ctx* ctx);
+
+/**
+ * @brief Initialization constant for a SHA512 context, equivalent to calling
+ * sha512_init().
+ */
+#define SHA512_INIT                                                                     \
+        { { 0x6a09e667f3bcc908ull, 0xbb67ae8584caa73bull, 0x3c6ef372fe94f82bull,        \
+            0xa54ff53a5f1d36f1ull, 0x510e527fade682d1ull, 0x9b05688c2b3e6c1full,        \
+            0x1f83d9abfb41bd6bull, 0x5be0cd19137e2179ull },                             \
+          { { 0 } }, 0 }
+
+/**
+ * @brief Add some data from memory to the hash.
+ *
+ * @param ctx the sha512_ctx to use, initialized for either SHA512 or SHA384
+ * @param data a pointer to data in memory
+ * @param len the number of bytes pointed to by \p data
+ */
+void sha512_update(struct sha512_ctx* ctx, const void *data, size_t len);
+
+/**
+ * @brief Finalize a SHA512 and return the resulting hash.
+ *
+ * @param hash the hash to return
+ * @param ctx the sha512_ctx to finalize
+ *
+ * As with sha256_done(), the context is used up by this call and must be
+ * re-initialized before being used again.
+ */
+void sha512_done(struct sha512* hash, struct sha512_ctx* ctx);
+
+/**
+ * @brief Compute the SHA512 of a contiguous region of memory.
+ *
+ * @param hash the hash to return
+ * @param data a pointer to data in memory
+ * @param len the number of bytes pointed to by \p data
+ */
+void sha512(struct sha512* hash, const void* data, size_t len);
+
+/**
+ * @brief Initializes a context for SHA384.
+ *
+ * @param ctx the context to initialize
+ *
+ * Data is added with sha512_update(), and the hash finalized with
+ * sha384_done().
+ */
+void sha384_init(struct sha512_ctx* ctx);
+
+/**
+ * @brief Initialization constant for a SHA384 context, equivalent to calling
+ * sha384_init().
+ */
+#define SHA384_INIT                                                                     \
+        { { 0xcbbb9d5dc1059ed8ull, 0x629a292a367cd507ull, 0x9159015a3070dd17ull,        \
+            0x152fecd8f70e5939ull, 0x67332667ffc00b31ull, 0x8eb44a8768581511ull,        \
+            0xdb0c2e0d64f98fa7ull, 0x47b5481dbefa4fa4ull },                             \
+          { { 0 } }, 0 }
+
+/**
+ * @brief Finalize a SHA384 and return the resulting hash.
+ *
+ * @param hash the hash to return
+ * @param ctx the sha512_ctx to finalize, which must have been initialized
+ * with sha384_init() or SHA384_INIT
+ */
+void sha384_done(struct sha384* hash, struct sha512_ctx* ctx);
+
+/**
+ * @brief Compute the SHA384 of a contiguous region of memory.
+ *
+ * @param hash the hash to return
+ * @param data a pointer to data in memory
+ * @param len the number of bytes pointed to by \p data
+ */
+void sha384(struct sha384* hash, const void* data, size_t len);
+
+/**
+ * @brief Initializes a context for SHA512/256.
+ *
+ * @param ctx the context to initialize
+ *
+ * Data is added with sha512_update(), and the hash finalized with
+ * sha512_256_done().  SHA512/256 has the same 32-byte digest as SHA256 but
+ * processes 128 bytes per compression, so on 64-bit machines without SHA
+ * instructions it hashes long messages considerably faster.
+ */
+void sha512_256_init(struct sha512_ctx* ctx);
+
+/**
+ * @brief Initialization constant for a SHA512/256 context, equivalent to
+ * calling sha512_256_init().
+ */
+#define SHA512_256_INIT                                                                 \
+        { { 0x22312194fc2bf72cull, 0x9f555fa3c84c64c2ull, 0x2393b86b6f53b151ull,        \
+            0x963877195940eabdull, 0x96283ee2a88effe3ull, 0xbe5e1e2553863992ull,        \
+            0x2b0199fc2c85b8aaull, 0x0eb72ddc81c52ca2ull },                             \
+          { { 0 } }, 0 }
+
+/**
+ * @brief Finalize a SHA512/256 and return the resulting hash.
+ *
+ * @param hash the hash to return
+ * @param ctx the sha512_ctx to finalize, which must have been initialized
+ * with sha512_256_init() or SHA512_256_INIT
+ */
+void sha512_256_done(struct sha512_256* hash, struct sha512_ctx* ctx);
+
+/**
+ * @brief Compute the SHA512/256 of a contiguous region of memory.
+ *
+ * @param hash the hash to return
+ * @param data a pointer to data in memory
+ * @param len the number of bytes pointed to by \p data
+ */
+void sha512_256(struct sha512_256* hash, const void* data, size_t len);
+
+/**
+ * @brief Initializes a context for SHA512/224.
+ *
+ * @param ctx the context to initialize
+ *
+ * Data is added with sha512_update(), and the hash finalized with
+ * sha512_224_done().
+ */
+void sha512_224_init(struct sha512_ctx* ctx);
+
+/**
+ * @brief Initialization constant for a SHA512/224 context, equivalent to
+ * calling sha512_224_init().
+ */
+#define SHA512_224_INIT                                                                 \
+        { { 0x8c3d37c819544da2ull, 0x73e1996689dcd4d6ull, 0x1dfab7ae32ff9c82ull,        \
+            0x679dd514582f9fcfull, 0x0f6d2b697bd44da8ull, 0x77e36f7304c48942ull,        \
+            0x3f9d85a86a1d36c8ull, 0x1112e6ad91d692a1ull },                             \
+          { { 0 } }, 0 }
+
+/**
+ * @brief Finalize a SHA512/224 and return the resulting hash.
+ *
+ * @param hash the hash to return
+ * @param ctx the sha512_ctx to finalize, which must have been initialized
+ * with sha512_224_init() or SHA512_224_INIT
+ */
+void sha512_224_done(struct sha512_224* hash, struct sha512_ctx* ctx);
+
+/**
+ * @brief Compute the SHA512/224 of a contiguous region of memory.
+ *
+ * @param hash the hash to return
+ * @param data a pointer to data in memory
+ * @param len the number of bytes pointed to by \p data
+ */
+void sha512_224(struct sha512_224* hash, const void* data, size_t len);
+
+/**
+ * @brief Compute the SHA512 of many independent messages.
+ *
+ * @param out the n hashes to return
+ * @param msg pointers to the n messages
+ * @param len the lengths in bytes of the n messages
+ * @param n the number of messages
+ *
+ * The result is the same as calling sha512() on each message in turn, but
+ * messages are hashed side by side, one per 64-bit lane of a multi-lane
+ * kernel: four at a time with AVX2, eight with AVX-512.  Lanes advance one
+ * block at a time in lockstep, so the batch is fastest when the messages have
+ * about the same length; short messages such as those hashed by Ed25519 batch
+ * verification or BIP32 derivation all fit in one or two blocks.  Messages
+ * that do not fill the widest kernel fall back to narrower ones, then to the
+ * single-stream code.
+ */
+void sha512_batch(struct sha512 out[], const void* const msg[], const size_t len[], size_t n);
+
+/**
+ * @brief Compute the SHA384 of many independent messages.
+ *
+ * @param out the n hashes to return
+ * @param msg pointers to the n messages
+ * @param len the lengths in bytes of the n messages
+ * @param n the number of messages
+ *
+ * As sha512_batch(), for SHA384.
+ */
+void sha384_batch(struct sha384 out[], const void* const msg[], const size_t len[], size_t n);
+
+/**
+ * @brief Compute the SHA512/256 of many independent messages.
+ *
+ * @param out the n hashes to return
+ * @param msg pointers to the n messages
+ * @param len the lengths in bytes of the n messages
+ * @param n the number of messages
+ *
+ * As sha512_batch(), for SHA512/256.
+ */
+void sha512_256_batch(struct sha512_256 out[], const void* const msg[], const size_t len[], size_t n);
+
+/**
+ * @brief Compute the SHA512/224 of many independent messages.
+ *
+ * @param out the n hashes to return
+ * @param msg pointers to the n messages
+ * @param len the lengths in bytes of the n messages
+ * @param n the number of messages
+ *
+ * As sha512_batch(), for SHA512/224.
+ */
+void sha512_224_batch(struct sha512_224 out[], const void* const msg[], const size_t len[], size_t n);
+
+/**
+ * @brief The precomputed state of an HMAC-SHA512 key.
+ *
+ * @inner: the SHA512 midstate after the key XOR ipad
+ * @outer: the SHA512 midstate after the key XOR opad
+ *
+ * The SHA512 counterpart of struct sha256_hmac_key.
+ */
+struct sha512_hmac_key {
+        uint64_t inner[8];
+        uint64_t outer[8];
+};
+
+/**
+ * @brief Precompute the HMAC-SHA512 midstates of a key.
+ *
+ * @param key the key state to initialize
+ * @param secret a pointer to the key bytes
+ * @param len the number of bytes pointed to by \p secret
+ *
+ * As specified by RFC 2104, keys longer than 128 bytes are replaced by their
+ * SHA512 hash first.
+ */
+void sha512_hmac_key_init(struct sha512_hmac_key* key, const void* secret, size_t len);
+
+/**
+ * @brief Compute the HMAC-SHA512 of a contiguous region of memory.
+ *
+ * @param hash the MAC to return
+ * @param key a key state initialized with sha512_hmac_key_init()
+ * @param msg a pointer to the message in memory
+ * @param len the number of bytes pointed to by \p msg
+ */
+void sha512_hmac(struct sha512* hash, const struct sha512_hmac_key* key, const void* msg, size_t len);
+
+/**
+ * @brief Derive a key from a password with PBKDF2-HMAC-SHA512.
+ *
+ * @param out the derived key to return
+ * @param outlen the number of bytes to write to \p out
+ * @param password a pointer to the password bytes
+ * @param pwlen the number of bytes pointed to by \p password
+ * @param salt a pointer to the salt bytes
+ * @param saltlen the number of bytes pointed to by \p salt
+ * @param iterations the iteration count, at least one
+ * @return int 0 on success, or -1 (writing nothing) if \p iterations is zero
+ *         or \p outlen exceeds (2^32 - 1) * 64 bytes
+ *
+ * As sha256_pbkdf2(), with 64-byte output blocks.  Every iteration after the
+ * first costs two compressions from the password's HMAC midstates.
+ */
+int sha512_pbkdf2(unsigned char* out, size_t outlen, const void* password, size_t pwlen, const void* salt, size_t saltlen, uint64_t iterations);
+
+/**
+ * @brief Derive keys from many passwords with PBKDF2-HMAC-SHA512.
+ *
+ * @param out the n derived keys to return, each of \p outlen bytes
+ * @param outlen the number of bytes to write to each key
+ * @param password pointers to the n passwords
+ * @param pwlen the lengths in bytes of the n passwords
+ * @param salt pointers to the n salts
+ * @param saltlen the lengths in bytes of the n salts
+ * @param n the number of passwords
+ * @param iterations the iteration count, shared by all passwords
+ * @return int 0 on success, or -1 (writing nothing) if \p iterations is zero
+ *         or \p outlen exceeds (2^32 - 1) * 64 bytes
+ *
+ * The result is the same as calling sha512_pbkdf2() on each password in turn,
+ * but the output blocks of all the passwords run side by side, one per 64-bit
+ * lane of the 4-lane AVX2 or 8-lane AVX-512 kernel.  A BIP39 seed is one
+ * block of 2048 iterations, with the mnemonic as the password and "mnemonic"
+ * followed by the passphrase as the salt, so checking many candidate
+ * mnemonics is a single call:
+ *
+ * Example:
+ * static void seeds(unsigned char* const seed[], const char* const mnemonic[], size_t n)
+ * {
+ *         const void* password[64];
+ *         const void* salt[64];
+ *         size_t pwlen[64], saltlen[64], i;
+ *         for (i = 0; i < n; ++i) {
+ *                 password[i] = mnemonic[i];
+ *                 pwlen[i] = strlen(mnemonic[i]);
+ *                 salt[i] = "mnemonic";
+ *                 saltlen[i] = 8;
+ *         }
+ *         sha512_pbkdf2_batch(seed, 64, password, pwlen, salt, saltlen, n, 2048);
+ * }
+ */
+int sha512_pbkdf2_batch(unsigned char* const out[], size_t outlen, const void* const password[], const size_t pwlen[], const void* const salt[], const size_t saltlen[], size_t n, uint64_t iterations);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SHA2__SHA512_H */
+
+/* End of File
+ */
@@ -6,14 +6,32 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/.
  */
 
+/* for clock_gettime */
+#define _GNU_SOURCE
+
 #include <sha2/sha256.h>
 #include "common.h"
 
 #include <assert.h>
+#include <stdio.h> /* for the tuning file */
+#include <stdlib.h> /* for getenv, malloc */
 #include <string.h>
+#include <time.h> /* for clock_gettime */
+
+#if defined(HAVE_PTHREAD_ONCE)
+#include <pthread.h>
+#endif
+
+#if defined(SHA256_USDT)
+#include <sys/sdt.h>
+#endif
 
 #include "compat/cpuid.h"
 
+#if defined(HAVE_UNISTD_H)
+#include <unistd.h> /* for getpid, issetugid */
+#endif
+
 #if defined(__linux__) && (defined(__arm__) || defined(__aarch64__))
 #include <sys/auxv.h>
 #include <asm/hwcap.h>
@@ -55,6 +73,19 @@ static inline __attribute__((always_inline)) void Initialize(uint32_t* s)
         s[7] = 0x5be0cd19ul;
 }
 
+/** Initialize SHA-224 state. */
+static inline __attribute__((always_inline)) void Initialize224(uint32_t* s)
+{
+        s[0] = 0xc1059ed8ul;
+        s[1] = 0x367cd507ul;
+        s[2] = 0x3070dd17ul;
+        s[3] = 0xf70e5939ul;
+        s[4] = 0xffc00b31ul;
+        s[5] = 0x68581511ul;
+        s[6] = 0x64f98fa7ul;
+        s[7] = 0xbefa4fa4ul;
+}
+
 /** Perform a number of SHA-256 transformations, processing 64-byte chunks. */
 static void transform_noasm(uint32_t* s, const unsigned char* chunk, size_t blocks)
 {
@@ -393,9 +424,167 @@ static void transform_d64_noasm(struct sha256 out[1], const struct sha256 in[2])
         WriteBE32(&out->u8[28], h + 0x5be0cd19ul);
 }
 
+/** Compute SHA-256 of a 32-byte message given as eight host-order words. */
+static void transform_d32_noasm(struct sha256 out[1], const uint32_t in[8])
+{
+        uint32_t a = 0x6a09e667ul;
+        uint32_t b = 0xbb67ae85ul;
+        uint32_t c = 0x3c6ef372ul;
+        uint32_t d = 0xa54ff53aul;
+        uint32_t e = 0x510e527ful;
+        uint32_t f = 0x9b05688cul;
+        uint32_t g = 0x1f83d9abul;
+        uint32_t h = 0x5be0cd19ul;
+
+        /* The digest words are the first half of the message schedule, and
+         * the padding for a 32-byte message is folded into the constants. */
+        uint32_t w0 = in[0], w1 = in[1], w2 = in[2], w3 = in[3], w4 = in[4], w5 = in[5], w6 = in[6], w7 = in[7];
+        uint32_t w8, w9, w10, w11, w12, w13, w14, w15;
+
+        Round(a, b, c, &d, e, f, g, &h, 0x428a2f98ul + w0);
+        Round(h, a, b, &c, d, e, f, &g, 0x71374491ul + w1);
+        Round(g, h, a, &b, c, d, e, &f, 0xb5c0fbcful + w2);
+        Round(f, g, h, &a, b, c, d, &e, 0xe9b5dba5ul + w3);
+        Round(e, f, g, &h, a, b, c, &d, 0x3956c25bul + w4);
+        Round(d, e, f, &g, h, a, b, &c, 0x59f111f1ul + w5);
+        Round(c, d, e, &f, g, h, a, &b, 0x923f82a4ul + w6);
+        Round(b, c, d, &e, f, g, h, &a, 0xab1c5ed5ul + w7);
+        Round(a, b, c, &d, e, f, g, &h, 0x5807aa98ul);
+        Round(h, a, b, &c, d, e, f, &g, 0x12835b01ul);
+        Round(g, h, a, &b, c, d, e, &f, 0x243185beul);
+        Round(f, g, h, &a, b, c, d, &e, 0x550c7dc3ul);
+        Round(e, f, g, &h, a, b, c, &d, 0x72be5d74ul);
+        Round(d, e, f, &g, h, a, b, &c, 0x80deb1feul);
+        Round(c, d, e, &f, g, h, a, &b, 0x9bdc06a7ul);
+        Round(b, c, d, &e, f, g, h, &a, 0xc19bf274ul);
+        Round(a, b, c, &d, e, f, g, &h, 0xe49b69c1ul + (w0 += sigma0(w1)));
+        Round(h, a, b, &c, d, e, f, &g, 0xefbe4786ul + (w1 += 0xa00000ul + sigma0(w2)));
+        Round(g, h, a, &b, c, d, e, &f, 0x0fc19dc6ul + (w2 += sigma1(w0) + sigma0(w3)));
+        Round(f, g, h, &a, b, c, d, &e, 0x240ca1ccul + (w3 += sigma1(w1) + sigma0(w4)));
+        Round(e, f, g, &h, a, b, c, &d, 0x2de92c6ful + (w4 += sigma1(w2) + sigma0(w5)));
+        Round(d, e, f, &g, h, a, b, &c, 0x4a7484aaul + (w5 += sigma1(w3) + sigma0(w6)));
+        Round(c, d, e, &f, g, h, a, &b, 0x5cb0a9dcul + (w6 += sigma1(w4) + 0x100ul + sigma0(w7)));
+        Round(b, c, d, &e, f, g, h, &a, 0x76f988daul + (w7 += sigma1(w5) + w0 + 0x11002000ul));
+        Round(a, b, c, &d, e, f, g, &h, 0x983e5152ul + (w8 = 0x80000000ul + sigma1(w6) + w1));
+        Round(h, a, b, &c, d, e, f, &g, 0xa831c66dul + (w9 = sigma1(w7) + w2));
+        Round(g, h, a, &b, c, d, e, &f, 0xb00327c8ul + (w10 = sigma1(w8) + w3));
+        Round(f, g, h, &a, b, c, d, &e, 0xbf597fc7ul + (w11 = sigma1(w9) + w4));
+        Round(e, f, g, &h, a, b, c, &d, 0xc6e00bf3ul + (w12 = sigma1(w10) + w5));
+        Round(d, e, f, &g, h, a, b, &c, 0xd5a79147ul + (w13 = sigma1(w11) + w6));
+        Round(c, d, e, &f, g, h, a, &b, 0x06ca6351ul + (w14 = sigma1(w12) + w7 + 0x400022ul));
+        Round(b, c, d, &e, f, g, h, &a, 0x14292967ul + (w15 = 0x100ul + sigma1(w13) + w8 + sigma0(w0)));
+        Round(a, b, c, &d, e, f, g, &h, 0x27b70a85ul + (w0 += sigma1(w14) + w9 + sigma0(w1)));
+        Round(h, a, b, &c, d, e, f, &g, 0x2e1b2138ul + (w1 += sigma1(w15) + w10 + sigma0(w2)));
+        Round(g, h, a, &b, c, d, e, &f, 0x4d2c6dfcul + (w2 += sigma1(w0) + w11 + sigma0(w3)));
+        Round(f, g, h, &a, b, c, d, &e, 0x53380d13ul + (w3 += sigma1(w1) + w12 + sigma0(w4)));
+        Round(e, f, g, &h, a, b, c, &d, 0x650a7354ul + (w4 += sigma1(w2) + w13 + sigma0(w5)));
+        Round(d, e, f, &g, h, a, b, &c, 0x766a0abbul + (w5 += sigma1(w3) + w14 + sigma0(w6)));
+        Round(c, d, e, &f, g, h, a, &b, 0x81c2c92eul + (w6 += sigma1(w4) + w15 + sigma0(w7)));
+        Round(b, c, d, &e, f, g, h, &a, 0x92722c85ul + (w7 += sigma1(w5) + w0 + sigma0(w8)));
+        Round(a, b, c, &d, e, f, g, &h, 0xa2bfe8a1ul + (w8 += sigma1(w6) + w1 + sigma0(w9)));
+        Round(h, a, b, &c, d, e, f, &g, 0xa81a664bul + (w9 += sigma1(w7) + w2 + sigma0(w10)));
+        Round(g, h, a, &b, c, d, e, &f, 0xc24b8b70ul + (w10 += sigma1(w8) + w3 + sigma0(w11)));
+        Round(f, g, h, &a, b, c, d, &e, 0xc76c51a3ul + (w11 += sigma1(w9) + w4 + sigma0(w12)));
+        Round(e, f, g, &h, a, b, c, &d, 0xd192e819ul + (w12 += sigma1(w10) + w5 + sigma0(w13)));
+        Round(d, e, f, &g, h, a, b, &c, 0xd6990624ul + (w13 += sigma1(w11) + w6 + sigma0(w14)));
+        Round(c, d, e, &f, g, h, a, &b, 0xf40e3585ul + (w14 += sigma1(w12) + w7 + sigma0(w15)));
+        Round(b, c, d, &e, f, g, h, &a, 0x106aa070ul + (w15 += sigma1(w13) + w8 + sigma0(w0)));
+        Round(a, b, c, &d, e, f, g, &h, 0x19a4c116ul + (w0 += sigma1(w14) + w9 + sigma0(w1)));
+        Round(h, a, b, &c, d, e, f, &g, 0x1e376c08ul + (w1 += sigma1(w15) + w10 + sigma0(w2)));
+        Round(g, h, a, &b, c, d, e, &f, 0x2748774cul + (w2 += sigma1(w0) + w11 + sigma0(w3)));
+        Round(f, g, h, &a, b, c, d, &e, 0x34b0bcb5ul + (w3 += sigma1(w1) + w12 + sigma0(w4)));
+        Round(e, f, g, &h, a, b, c, &d, 0x391c0cb3ul + (w4 += sigma1(w2) + w13 + sigma0(w5)));
+        Round(d, e, f, &g, h, a, b, &c, 0x4ed8aa4aul + (w5 += sigma1(w3) + w14 + sigma0(w6)));
+        Round(c, d, e, &f, g, h, a, &b, 0x5b9cca4ful + (w6 += sigma1(w4) + w15 + sigma0(w7)));
+        Round(b, c, d, &e, f, g, h, &a, 0x682e6ff3ul + (w7 += sigma1(w5) + w0 + sigma0(w8)));
+        Round(a, b, c, &d, e, f, g, &h, 0x748f82eeul + (w8 += sigma1(w6) + w1 + sigma0(w9)));
+        Round(h, a, b, &c, d, e, f, &g, 0x78a5636ful + (w9 += sigma1(w7) + w2 + sigma0(w10)));
+        Round(g, h, a, &b, c, d, e, &f, 0x84c87814ul + (w10 += sigma1(w8) + w3 + sigma0(w11)));
+        Round(f, g, h, &a, b, c, d, &e, 0x8cc70208ul + (w11 += sigma1(w9) + w4 + sigma0(w12)));
+        Round(e, f, g, &h, a, b, c, &d, 0x90befffaul + (w12 += sigma1(w10) + w5 + sigma0(w13)));
+        Round(d, e, f, &g, h, a, b, &c, 0xa4506cebul + (w13 += sigma1(w11) + w6 + sigma0(w14)));
+        Round(c, d, e, &f, g, h, a, &b, 0xbef9a3f7ul + (w14 + sigma1(w12) + w7 + sigma0(w15)));
+        Round(b, c, d, &e, f, g, h, &a, 0xc67178f2ul + (w15 + sigma1(w13) + w8 + sigma0(w0)));
+
+        /* Output */
+        WriteBE32(&out->u8[0], a + 0x6a09e667ul);
+        WriteBE32(&out->u8[4], b + 0xbb67ae85ul);
+        WriteBE32(&out->u8[8], c + 0x3c6ef372ul);
+        WriteBE32(&out->u8[12], d + 0xa54ff53aul);
+        WriteBE32(&out->u8[16], e + 0x510e527ful);
+        WriteBE32(&out->u8[20], f + 0x9b05688cul);
+        WriteBE32(&out->u8[24], g + 0x1f83d9abul);
+        WriteBE32(&out->u8[28], h + 0x5be0cd19ul);
+}
+
+/** The SHA-256 round constants. */
+static const uint32_t K[64] = {
+        0x428a2f98ul, 0x71374491ul, 0xb5c0fbcful, 0xe9b5dba5ul, 0x3956c25bul, 0x59f111f1ul, 0x923f82a4ul, 0xab1c5ed5ul,
+        0xd807aa98ul, 0x12835b01ul, 0x243185beul, 0x550c7dc3ul, 0x72be5d74ul, 0x80deb1feul, 0x9bdc06a7ul, 0xc19bf174ul,
+        0xe49b69c1ul, 0xefbe4786ul, 0x0fc19dc6ul, 0x240ca1ccul, 0x2de92c6ful, 0x4a7484aaul, 0x5cb0a9dcul, 0x76f988daul,
+        0x983e5152ul, 0xa831c66dul, 0xb00327c8ul, 0xbf597fc7ul, 0xc6e00bf3ul, 0xd5a79147ul, 0x06ca6351ul, 0x14292967ul,
+        0x27b70a85ul, 0x2e1b2138ul, 0x4d2c6dfcul, 0x53380d13ul, 0x650a7354ul, 0x766a0abbul, 0x81c2c92eul, 0x92722c85ul,
+        0xa2bfe8a1ul, 0xa81a664bul, 0xc24b8b70ul, 0xc76c51a3ul, 0xd192e819ul, 0xd6990624ul, 0xf40e3585ul, 0x106aa070ul,
+        0x19a4c116ul, 0x1e376c08ul, 0x2748774cul, 0x34b0bcb5ul, 0x391c0cb3ul, 0x4ed8aa4aul, 0x5b9cca4ful, 0x682e6ff3ul,
+        0x748f82eeul, 0x78a5636ful, 0x84c87814ul, 0x8cc70208ul, 0x90befffaul, 0xa4506cebul, 0xbef9a3f7ul, 0xc67178f2ul
+};
+
+/** Compute the message schedule, with the round constants added in, of the
+ * final block of a message of the given length, when that block contains only
+ * padding.  This is the case when the length is a multiple of 64, or leaves
+ * less than 9 bytes free in the last data block. */
+static void pad_schedule(uint32_t ks[64], size_t bytes)
+{
+        uint32_t w[64];
+        int i;
+        memset(w, 0, 14 * sizeof(uint32_t));
+        if (bytes % 64 == 0) {
+                w[0] = 0x80000000ul;
+        }
+        w[14] = (uint32_t)((uint64_t)bytes >> 29);
+        w[15] = (uint32_t)((uint64_t)bytes << 3);
+        for (i = 16; i < 64; ++i) {
+                w[i] = sigma1(w[i - 2]) + w[i - 7] + sigma0(w[i - 15]) + w[i - 16];
+        }
+        for (i = 0; i < 64; ++i) {
+                ks[i] = K[i] + w[i];
+        }
+}
+
+/** Perform one SHA-256 transformation from a precomputed message schedule with
+ * the round constants already added in. */
+static void transform_ks_noasm(uint32_t* s, const uint32_t* ks)
+{
+        uint32_t a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+        int i;
+
+        for (i = 0; i < 64; i += 8) {
+                Round(a, b, c, &d, e, f, g, &h, ks[i + 0]);
+                Round(h, a, b, &c, d, e, f, &g, ks[i + 1]);
+                Round(g, h, a, &b, c, d, e, &f, ks[i + 2]);
+                Round(f, g, h, &a, b, c, d, &e, ks[i + 3]);
+                Round(e, f, g, &h, a, b, c, &d, ks[i + 4]);
+                Round(d, e, f, &g, h, a, b, &c, ks[i + 5]);
+                Round(c, d, e, &f, g, h, a, &b, ks[i + 6]);
+                Round(b, c, d, &e, f, g, h, &a, ks[i + 7]);
+        }
+
+        s[0] += a;
+        s[1] += b;
+        s[2] += c;
+        s[3] += d;
+        s[4] += e;
+        s[5] += f;
+        s[6] += g;
+        s[7] += h;
+}
+
 typedef void (*transform_t)(uint32_t*, const unsigned char*, size_t);
 typedef void (*transform_multi_t)(struct sha256*, const uint32_t*, const unsigned char*);
 typedef void (*transform_d64_t)(struct sha256[], const struct sha256[]);
+typedef void (*transform_d32_t)(struct sha256[], const uint32_t[]);
+typedef void (*transform_ks_t)(uint32_t*, const uint32_t*);
+typedef void (*transform_states_t)(uint32_t*, const unsigned char*);
 
 void transform_d64_wrapper(struct sha256 out[1], const struct sha256 in[2], transform_t tr)
 {
@@ -434,6 +623,56 @@ void transform_d64_wrapper(struct sha256 out[1], const struct sha256 in[2], tran
         WriteBE32(&out->u8[24], s[6]);
         WriteBE32(&out->u8[28], s[7]);
 }
+/** SHA256 of a 64-byte message, with the given single-block transform. */
+static void transform_h64_wrapper(struct sha256 out[1], const struct sha256 in[2], transform_t tr)
+{
+        uint32_t s[8];
+        static const unsigned char padding1[64] = {
+                0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                0,    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                0,    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                0,    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0
+        };
+        Initialize(s);
+        tr(s, in->u8, 1);
+        tr(s, padding1, 1);
+        WriteBE32(&out->u8[0], s[0]);
+        WriteBE32(&out->u8[4], s[1]);
+        WriteBE32(&out->u8[8], s[2]);
+        WriteBE32(&out->u8[12], s[3]);
+        WriteBE32(&out->u8[16], s[4]);
+        WriteBE32(&out->u8[20], s[5]);
+        WriteBE32(&out->u8[24], s[6]);
+        WriteBE32(&out->u8[28], s[7]);
+}
+static void transform_d32_wrapper(struct sha256 out[1], const uint32_t in[8], transform_t tr)
+{
+        uint32_t s[8];
+        unsigned char buffer[64] = {
+                0,    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                0,    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                0,    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0
+        };
+        WriteBE32(buffer + 0, in[0]);
+        WriteBE32(buffer + 4, in[1]);
+        WriteBE32(buffer + 8, in[2]);
+        WriteBE32(buffer + 12, in[3]);
+        WriteBE32(buffer + 16, in[4]);
+        WriteBE32(buffer + 20, in[5]);
+        WriteBE32(buffer + 24, in[6]);
+        WriteBE32(buffer + 28, in[7]);
+        Initialize(s);
+        tr(s, buffer, 1);
+        WriteBE32(&out->u8[0], s[0]);
+        WriteBE32(&out->u8[4], s[1]);
+        WriteBE32(&out->u8[8], s[2]);
+        WriteBE32(&out->u8[12], s[3]);
+        WriteBE32(&out->u8[16], s[4]);
+        WriteBE32(&out->u8[20], s[5]);
+        WriteBE32(&out->u8[24], s[6]);
+        WriteBE32(&out->u8[28], s[7]);
+}
 #if defined(__x86_64__) || defined(__amd64__)
 void transform_sha256d64_shani(struct sha256 out[1], const struct sha256 in[2])
 {
@@ -443,6 +682,10 @@ void transform_sha256d64_sse4(struct sha256 out[1], const struct sha256 in[2])
 {
         transform_d64_wrapper(out, in, transform_sha256_sse4);
 }
+void transform_sha256d32_sse4(struct sha256 out[1], const uint32_t in[8])
+{
+        transform_d32_wrapper(out, in, transform_sha256_sse4);
+}
 #endif /* defined(__x86_64__) || defined(__amd64__) || defined(__i386__) */
 #if defined(__arm__) || defined(__aarch32__) || defined(__arm64__) || defined(__aarch64__) || defined(_M_ARM)
 void transform_sha256d64_armv8(struct sha256 out[1], const struct sha256 in[2])
@@ -451,6 +694,135 @@ void transform_sha256d64_armv8(struct sha256 out[1], const struct sha256 in[2])
 }
 #endif /* defined(__arm__) || defined(__aarch32__) || defined(__arm64__) || defined(__aarch64__) || defined(_M_ARM) */
 
+/** The operations that are dispatched separately, each of which may be bound
+ * to a different kernel. */
+enum {
+        OP_TRANSFORM, /* transform, with transform_d32 and transform_ks */
+        OP_D64,
+        OP_D64_2WAY,
+        OP_D64_4WAY,
+        OP_D64_8WAY,
+        OP_D64_16WAY,
+        OP_MULTI_2WAY,
+        OP_MULTI_4WAY,
+        OP_MULTI_8WAY,
+        OP_MULTI_16WAY,
+        OP_H64_4WAY,
+        OP_H64_8WAY,
+        OP_H64_16WAY,
+        OP_STATES_4WAY,
+        OP_STATES_8WAY,
+        OP_STATES_16WAY,
+        OPS
+};
+
+#if defined(SHA256_BACKEND_PINNED)
+/* The backend was chosen at configure time.  The kernels are bound to constant
+ * pointers, so every call is a direct call the compiler (or LTO) can see
+ * through. */
+#if defined(SHA256_BACKEND_SHANI)
+#define PINNED_TRANSFORM transform_sha256_shani
+#define PINNED_TRANSFORM_D64 transform_sha256d64_shani
+#define PINNED_TRANSFORM_D64_2WAY transform_sha256d64_shani_2way
+#define PINNED_TRANSFORM_D32 transform_sha256d32_shani
+#define PINNED_TRANSFORM_KS transform_sha256ks_shani
+#define SHA256_BACKEND_NAME "shani(1way,2way)"
+#define PINNED_KERNELS SHA256_KERNEL_SHANI
+#define PINNED_OP_KERNELS { 4, 4, 4, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 }
+#elif defined(SHA256_BACKEND_AVX2) || defined(SHA256_BACKEND_SSE4)
+#define PINNED_TRANSFORM transform_sha256_sse4
+#define PINNED_TRANSFORM_4WAY transform_sha256multi_sse41_4way
+#define PINNED_TRANSFORM_D64 transform_sha256d64_sse4
+#define PINNED_TRANSFORM_D64_4WAY transform_sha256d64_sse41_4way
+#define PINNED_TRANSFORM_H64_4WAY transform_sha256h64_sse41_4way
+#define PINNED_TRANSFORM_STATES_4WAY transform_sha256states_sse41_4way
+#define PINNED_TRANSFORM_D32 transform_sha256d32_sse4
+#define PINNED_TRANSFORM_KS transform_sha256ks_sse4
+#if defined(SHA256_BACKEND_AVX2)
+#define PINNED_TRANSFORM_8WAY transform_sha256multi_avx2_8way
+#define PINNED_TRANSFORM_D64_8WAY transform_sha256d64_avx2_8way
+#define PINNED_TRANSFORM_H64_8WAY transform_sha256h64_avx2_8way
+#define PINNED_TRANSFORM_STATES_8WAY transform_sha256states_avx2_8way
+#define SHA256_BACKEND_NAME "sse4(1way),sse41(4way),avx2(8way)"
+#define PINNED_KERNELS (SHA256_KERNEL_SSE4 | SHA256_KERNEL_SSE41 | SHA256_KERNEL_AVX2)
+#define PINNED_OP_KERNELS { 1, 1, 0, 2, 3, 0, 0, 2, 3, 0, 2, 3, 0, 2, 3, 0 }
+#else
+#define SHA256_BACKEND_NAME "sse4(1way),sse41(4way)"
+#define PINNED_KERNELS (SHA256_KERNEL_SSE4 | SHA256_KERNEL_SSE41)
+#define PINNED_OP_KERNELS { 1, 1, 0, 2, 0, 0, 0, 2, 0, 0, 2, 0, 0, 2, 0, 0 }
+#endif
+#elif defined(SHA256_BACKEND_ARMV8)
+#define PINNED_TRANSFORM transform_sha256_armv8
+#define PINNED_TRANSFORM_D64 transform_sha256d64_armv8
+#define PINNED_TRANSFORM_D64_2WAY transform_sha256d64_armv8_2way
+#define PINNED_TRANSFORM_D32 transform_sha256d32_armv8
+#define PINNED_TRANSFORM_KS NULL
+#define SHA256_BACKEND_NAME "armv8(1way,2way)"
+#define PINNED_KERNELS SHA256_KERNEL_ARMV8
+#define PINNED_OP_KERNELS { 5, 5, 5, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 }
+#else /* SHA256_BACKEND_GENERIC */
+#define PINNED_TRANSFORM transform_noasm
+#define PINNED_TRANSFORM_D64 transform_d64_noasm
+#define PINNED_TRANSFORM_D32 transform_d32_noasm
+#define PINNED_TRANSFORM_KS transform_ks_noasm
+#define SHA256_BACKEND_NAME "standard"
+#define PINNED_KERNELS SHA256_KERNEL_GENERIC
+#define PINNED_OP_KERNELS { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 }
+#endif
+#if !defined(PINNED_TRANSFORM_2WAY)
+#define PINNED_TRANSFORM_2WAY NULL
+#endif
+#if !defined(PINNED_TRANSFORM_4WAY)
+#define PINNED_TRANSFORM_4WAY NULL
+#endif
+#if !defined(PINNED_TRANSFORM_8WAY)
+#define PINNED_TRANSFORM_8WAY NULL
+#endif
+#if !defined(PINNED_TRANSFORM_D64_2WAY)
+#define PINNED_TRANSFORM_D64_2WAY NULL
+#endif
+#if !defined(PINNED_TRANSFORM_D64_4WAY)
+#define PINNED_TRANSFORM_D64_4WAY NULL
+#endif
+#if !defined(PINNED_TRANSFORM_D64_8WAY)
+#define PINNED_TRANSFORM_D64_8WAY NULL
+#endif
+#if !defined(PINNED_TRANSFORM_H64_4WAY)
+#define PINNED_TRANSFORM_H64_4WAY NULL
+#endif
+#if !defined(PINNED_TRANSFORM_H64_8WAY)
+#define PINNED_TRANSFORM_H64_8WAY NULL
+#endif
+#if !defined(PINNED_TRANSFORM_STATES_4WAY)
+#define PINNED_TRANSFORM_STATES_4WAY NULL
+#endif
+#if !defined(PINNED_TRANSFORM_STATES_8WAY)
+#define PINNED_TRANSFORM_STATES_8WAY NULL
+#endif
+static const transform_t transform = PINNED_TRANSFORM;
+static const transform_multi_t transform_2way = PINNED_TRANSFORM_2WAY;
+static const transform_multi_t transform_4way = PINNED_TRANSFORM_4WAY;
+static const transform_multi_t transform_8way = PINNED_TRANSFORM_8WAY;
+static const transform_d64_t transform_d64 = PINNED_TRANSFORM_D64;
+static const transform_d64_t transform_d64_2way = PINNED_TRANSFORM_D64_2WAY;
+static const transform_d64_t transform_d64_4way = PINNED_TRANSFORM_D64_4WAY;
+static const transform_d64_t transform_d64_8way = PINNED_TRANSFORM_D64_8WAY;
+static const transform_d64_t transform_d64_16way = NULL;
+static const transform_multi_t transform_16way = NULL;
+static const transform_d64_t transform_h64_4way = PINNED_TRANSFORM_H64_4WAY;
+static const transform_d64_t transform_h64_8way = PINNED_TRANSFORM_H64_8WAY;
+static const transform_d64_t transform_h64_16way = NULL;
+static const transform_states_t transform_states_4way = PINNED_TRANSFORM_STATES_4WAY;
+static const transform_states_t transform_states_8way = PINNED_TRANSFORM_STATES_8WAY;
+static const transform_states_t transform_states_16way = NULL;
+static const transform_d32_t transform_d32 = PINNED_TRANSFORM_D32;
+static const transform_ks_t transform_ks = PINNED_TRANSFORM_KS;
+#if defined(SHA256_STATS)
+/** The kernel bound to each operation, as a bit number of enum
+ * sha256_kernel. */
+static const unsigned char op_kernel[OPS] = PINNED_OP_KERNELS;
+#endif
+#else /* SHA256_BACKEND_PINNED */
 transform_t transform = transform_noasm;
 transform_multi_t transform_2way = NULL;
 transform_multi_t transform_4way = NULL;
@@ -459,6 +831,20 @@ transform_d64_t transform_d64 = transform_d64_noasm;
 transform_d64_t transform_d64_2way = NULL;
 transform_d64_t transform_d64_4way = NULL;
 transform_d64_t transform_d64_8way = NULL;
+transform_d64_t transform_d64_16way = NULL;
+transform_multi_t transform_16way = NULL;
+transform_d64_t transform_h64_4way = NULL;
+transform_d64_t transform_h64_8way = NULL;
+transform_d64_t transform_h64_16way = NULL;
+transform_states_t transform_states_4way = NULL;
+transform_states_t transform_states_8way = NULL;
+transform_states_t transform_states_16way = NULL;
+transform_d32_t transform_d32 = transform_d32_noasm;
+transform_ks_t transform_ks = transform_ks_noasm;
+#if defined(SHA256_STATS)
+static unsigned char op_kernel[OPS];
+#endif
+#endif /* SHA256_BACKEND_PINNED */
 
 #ifndef NDEBUG
 static int self_test() {
@@ -526,6 +912,46 @@ static int self_test() {
             if (memcmp(out, result_d64, 32)) return 0;
         }
 
+        /* Test transform_d32 by hashing the first transform_d64 input by hand,
+         * then handing the host-order state to transform_d32. */
+        {
+            struct sha256 out[1];
+            uint32_t state[8];
+            static const unsigned char padding[64] = {
+                    0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                    0,    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                    0,    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                    0,    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0
+            };
+            memcpy(state, init, 8 * sizeof(uint32_t));
+            transform(state, data + 1, 1);
+            transform(state, padding, 1);
+            transform_d32(out, state);
+            if (memcmp(out, result_d64, 32)) return 0;
+        }
+
+        /* Test transform_ks against transform on the padding-only final
+         * blocks of a 64-byte and a 120-byte message, if available. */
+        if (transform_ks) {
+            uint32_t state1[8], state2[8], ks[64];
+            unsigned char padding[64] = { 0 };
+            padding[0] = 0x80;
+            padding[62] = 0x02;
+            memcpy(state1, result[1], 8 * sizeof(uint32_t));
+            memcpy(state2, result[1], 8 * sizeof(uint32_t));
+            transform(state1, padding, 1);
+            pad_schedule(ks, 64);
+            transform_ks(state2, ks);
+            if (memcmp(state1, state2, 8 * sizeof(uint32_t))) return 0;
+            padding[0] = 0;
+            padding[62] = 0x03;
+            padding[63] = 0xc0;
+            transform(state1, padding, 1);
+            pad_schedule(ks, 120);
+            transform_ks(state2, ks);
+            if (memcmp(state1, state2, 8 * sizeof(uint32_t))) return 0;
+        }
+
         /* Test transform_d64_2way, if available. */
         if (transform_d64_2way) {
                 struct sha256 out[2];
@@ -547,10 +973,146 @@ static int self_test() {
                 if (memcmp(out, result_d64, 256)) return 0;
         }
 
+        /* Test the 16-way and single-SHA256 kernels against the single-lane
+         * ones, on the test data repeated to 32 hashes. */
+        {
+                struct sha256 in[32], expected[16], out[16];
+                int lane;
+                memcpy(in, data + 1, 640);
+                memcpy(in + 20, data + 1, 384);
+                if (transform_d64_16way) {
+                        for (lane = 0; lane < 16; ++lane) {
+                                transform_d64(&expected[lane], &in[2 * lane]);
+                        }
+                        transform_d64_16way(out, in);
+                        if (memcmp(out, expected, sizeof(out))) return 0;
+                }
+                for (lane = 0; lane < 16; ++lane) {
+                        transform_h64_wrapper(&expected[lane], &in[2 * lane], transform);
+                }
+                if (transform_h64_4way) {
+                        transform_h64_4way(out, in);
+                        if (memcmp(out, expected, 128)) return 0;
+                }
+                if (transform_h64_8way) {
+                        transform_h64_8way(out, in);
+                        if (memcmp(out, expected, 256)) return 0;
+                }
+                if (transform_h64_16way) {
+                        transform_h64_16way(out, in);
+                        if (memcmp(out, expected, 512)) return 0;
+                }
+        }
+
+        /* Test the per-lane state kernels, with lane i compressing block
+         * i % 8 of the test data from the state before it. */
+        {
+                transform_states_t kernels[3];
+                unsigned char blocks[1024];
+                uint32_t states[128];
+                int k, lane;
+                kernels[0] = transform_states_4way;
+                kernels[1] = transform_states_8way;
+                kernels[2] = transform_states_16way;
+                memcpy(blocks, data + 1, 512);
+                memcpy(blocks + 512, data + 1, 512);
+                for (k = 0; k < 3; ++k) {
+                        if (!kernels[k]) {
+                                continue;
+                        }
+                        for (lane = 0; lane < 16; ++lane) {
+                                memcpy(&states[8 * lane], result[lane % 8], 8 * sizeof(uint32_t));
+                        }
+                        kernels[k](states, blocks);
+                        for (lane = 0; lane < 4 << k; ++lane) {
+                                if (memcmp(&states[8 * lane], result[lane % 8 + 1], 8 * sizeof(uint32_t))) return 0;
+                        }
+                }
+        }
+
         return !0;
 }
 #endif /* NDEBUG */
 
+/* Kernel selection */
+
+/** Names and lane widths of the kernels, as reported by sha256_kernel_name()
+ * and sha256_kernel_lanes(). */
+static const struct {
+        unsigned kernel;
+        const char* name;
+        unsigned lanes;
+} kernel_table[] = {
+        { SHA256_KERNEL_GENERIC, "generic", 1 },
+        { SHA256_KERNEL_SSE4, "sse4", 1 },
+        { SHA256_KERNEL_SSE41, "sse41", 4 },
+        { SHA256_KERNEL_AVX2, "avx2", 8 },
+        { SHA256_KERNEL_SHANI, "shani", 1 | 2 },
+        { SHA256_KERNEL_ARMV8, "armv8", 1 | 2 },
+        { SHA256_KERNEL_VEC, "vec", 4 | 8 },
+        { SHA256_KERNEL_AVX512, "avx512", 16 }
+};
+
+const char* sha256_kernel_name(unsigned kernel)
+{
+        size_t i;
+        for (i = 0; i < sizeof(kernel_table) / sizeof(kernel_table[0]); ++i) {
+                if (kernel_table[i].kernel == kernel) {
+                        return kernel_table[i].name;
+                }
+        }
+        return NULL;
+}
+
+unsigned sha256_kernel_lanes(unsigned kernel)
+{
+        size_t i;
+        for (i = 0; i < sizeof(kernel_table) / sizeof(kernel_table[0]); ++i) {
+                if (kernel_table[i].kernel == kernel) {
+                        return kernel_table[i].lanes;
+                }
+        }
+        return 0;
+}
+
+#if defined(SHA256_BACKEND_PINNED)
+unsigned sha256_available_kernels(void)
+{
+        return PINNED_KERNELS;
+}
+
+unsigned sha256_selected_kernels(void)
+{
+        return PINNED_KERNELS;
+}
+
+int sha256_select_backend(unsigned kernels)
+{
+        return kernels == 0 || kernels == PINNED_KERNELS ? 0 : -1;
+}
+
+int sha256_calibrate(const char* cache_path)
+{
+        (void)cache_path;
+        return -1;
+}
+
+const char* sha256_auto_detect(void)
+{
+        assert(self_test());
+        return SHA256_BACKEND_NAME;
+}
+#else /* SHA256_BACKEND_PINNED */
+/** A description of the selected algorithm(s), returned by
+ * sha256_auto_detect(). */
+static char backend_name[255] = "standard";
+
+/** The kernels supported by both the build and the host. */
+static unsigned available_kernels = SHA256_KERNEL_GENERIC;
+
+/** The kernels the transform pointers are currently bound to. */
+static unsigned selected_kernels = SHA256_KERNEL_GENERIC;
+
 #if (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
 /** Check whether the OS has enabled AVX registers. */
 static int AVXEnabled()
@@ -559,26 +1121,38 @@ static int AVXEnabled()
         __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
         return (a & 6) == 6;
 }
+
+/** Check whether the OS has enabled AVX-512 registers as well. */
+static int AVX512Enabled(void)
+{
+        uint32_t a, d;
+        __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+        return (a & 0xe6) == 0xe6;
+}
 #endif
 
-const char* sha256_auto_detect()
+/** Query the host capabilities for the kernels it can run. */
+static unsigned probe(void)
 {
-        static char ret[255] = "standard";
+        unsigned kernels = SHA256_KERNEL_GENERIC;
 #if defined(HAVE_GETCPUID)
         int have_sse4 = 0;
         int have_xsave = 0;
         int have_avx = 0;
         int have_avx2 = 0;
+        int have_avx512 = 0;
         int have_shani = 0;
         int enabled_avx = 0;
 
         uint32_t eax=0, ebx=0, ecx=0, edx=0;
 
         (void)AVXEnabled;
+        (void)AVX512Enabled;
         (void)have_sse4;
         (void)have_avx;
         (void)have_xsave;
         (void)have_avx2;
+        (void)have_avx512;
         (void)have_shani;
         (void)enabled_avx;
 
@@ -592,38 +1166,34 @@ const char* sha256_auto_detect()
         if (have_sse4) {
                 GetCPUID(7, 0, &eax, &ebx, &ecx, &edx);
                 have_avx2 = (ebx >> 5) & 1;
+                have_avx512 = (ebx >> 16) & 1;
                 have_shani = (ebx >> 29) & 1;
         }
 
 #if !defined(BUILD_BITCOIN_INTERNAL)
         if (have_shani) {
-                transform = transform_sha256_shani;
-                transform_d64 = transform_sha256d64_shani;
-                transform_d64_2way = transform_sha256d64_shani_2way;
-                strcpy(ret, "shani(1way,2way)");
-                have_sse4 = 0; /* Disable SSE4/AVX2; */
-                have_avx2 = 0;
+                kernels |= SHA256_KERNEL_SHANI;
         }
 #endif
 
         if (have_sse4) {
 #if defined(__x86_64__) || defined(__amd64__)
-                transform = transform_sha256_sse4;
-                transform_d64 = transform_sha256d64_sse4;
-                strcpy(ret, "sse4(1way)");
+                kernels |= SHA256_KERNEL_SSE4;
 #endif
 #if !defined(BUILD_BITCOIN_INTERNAL)
-                transform_4way = transform_sha256multi_sse41_4way;
-                transform_d64_4way = transform_sha256d64_sse41_4way;
-                strcat(ret, ",sse41(4way)");
+                kernels |= SHA256_KERNEL_SSE41;
 #endif
-    }
+        }
 
 #if !defined(BUILD_BITCOIN_INTERNAL)
         if (have_avx2 && have_avx && enabled_avx) {
-                transform_8way = transform_sha256multi_avx2_8way;
-                transform_d64_8way = transform_sha256d64_avx2_8way;
-                strcat(ret, ",avx2(8way)");
+                kernels |= SHA256_KERNEL_AVX2;
+        }
+#endif
+
+#if defined(ENABLE_AVX512) && (defined(__x86_64__) || defined(__amd64__))
+        if (have_avx512 && enabled_avx && AVX512Enabled()) {
+                kernels |= SHA256_KERNEL_AVX512;
         }
 #endif
 
@@ -652,42 +1222,788 @@ const char* sha256_auto_detect()
 #endif
 
         if (have_arm_shani) {
-                transform = transform_sha256_armv8;
-                transform_d64 = transform_sha256d64_armv8;
-                transform_d64_2way = transform_sha256d64_armv8_2way;
-                strcpy(ret, "armv8(1way,2way)");
+                kernels |= SHA256_KERNEL_ARMV8;
         }
 #endif
 
-        assert(self_test());
-        return ret;
+#if defined(__GNUC__)
+        /* Built for the baseline instruction set, so always runnable. */
+        kernels |= SHA256_KERNEL_VEC;
+#endif
+
+        return kernels;
 }
 
-/* SHA-256 */
+static const char* const op_names[OPS] = {
+        "transform", "d64", "d64_2way", "d64_4way", "d64_8way", "d64_16way",
+        "multi_2way", "multi_4way", "multi_8way", "multi_16way",
+        "h64_4way", "h64_8way", "h64_16way",
+        "states_4way", "states_8way", "states_16way"
+};
 
-void sha256_init(struct sha256_ctx* ctx)
+/** The number of lanes, or for OP_TRANSFORM the number of blocks, handled by
+ * one call of each operation. */
+static const unsigned op_lanes[OPS] = { 1, 1, 2, 4, 8, 16, 2, 4, 8, 16, 4, 8, 16, 4, 8, 16 };
+
+/** Each kernel's implementation of each operation, in increasing order of
+ * preference.  The first entry must be the generic code. */
+static const struct {
+        unsigned kernel;
+        transform_t transform;
+        transform_d32_t d32;
+        transform_ks_t ks;
+        transform_d64_t d64[5]; /* 1, 2, 4, 8 and 16 lanes */
+        transform_multi_t multi[4]; /* 2, 4, 8 and 16 lanes */
+        transform_d64_t h64[3]; /* 4, 8 and 16 lanes */
+        transform_states_t states[3]; /* 4, 8 and 16 lanes */
+} kernel_impls[] = {
+        { SHA256_KERNEL_GENERIC, transform_noasm, transform_d32_noasm, transform_ks_noasm,
+          { transform_d64_noasm, NULL, NULL, NULL, NULL }, { NULL, NULL, NULL, NULL }, { NULL, NULL, NULL }, { NULL, NULL, NULL } },
+#if defined(__x86_64__) || defined(__amd64__)
+        { SHA256_KERNEL_SSE4, transform_sha256_sse4, transform_sha256d32_sse4, transform_sha256ks_sse4,
+          { transform_sha256d64_sse4, NULL, NULL, NULL, NULL }, { NULL, NULL, NULL, NULL }, { NULL, NULL, NULL }, { NULL, NULL, NULL } },
+#endif
+#if defined(__GNUC__)
+        { SHA256_KERNEL_VEC, NULL, NULL, NULL,
+          { NULL, NULL, transform_sha256d64_vec_4way, transform_sha256d64_vec_8way, NULL },
+          { NULL, transform_sha256multi_vec_4way, transform_sha256multi_vec_8way, NULL },
+          { transform_sha256h64_vec_4way, transform_sha256h64_vec_8way, NULL },
+          { transform_sha256states_vec_4way, transform_sha256states_vec_8way, NULL } },
+#endif
+#if defined(__x86_64__) || defined(__amd64__) || defined(__i386__)
+        { SHA256_KERNEL_SSE41, NULL, NULL, NULL,
+          { NULL, NULL, transform_sha256d64_sse41_4way, NULL, NULL },
+          { NULL, transform_sha256multi_sse41_4way, NULL, NULL },
+          { transform_sha256h64_sse41_4way, NULL, NULL },
+          { transform_sha256states_sse41_4way, NULL, NULL } },
+        { SHA256_KERNEL_AVX2, NULL, NULL, NULL,
+          { NULL, NULL, NULL, transform_sha256d64_avx2_8way, NULL },
+          { NULL, NULL, transform_sha256multi_avx2_8way, NULL },
+          { NULL, transform_sha256h64_avx2_8way, NULL },
+          { NULL, transform_sha256states_avx2_8way, NULL } },
+#endif
+#if defined(ENABLE_AVX512) && (defined(__x86_64__) || defined(__amd64__))
+        { SHA256_KERNEL_AVX512, NULL, NULL, NULL,
+          { NULL, NULL, NULL, NULL, transform_sha256d64_avx512_16way },
+          { NULL, NULL, NULL, transform_sha256multi_avx512_16way },
+          { NULL, NULL, transform_sha256h64_avx512_16way },
+          { NULL, NULL, transform_sha256states_avx512_16way } },
+#endif
+#if defined(__x86_64__) || defined(__amd64__)
+        { SHA256_KERNEL_SHANI, transform_sha256_shani, transform_sha256d32_shani, transform_sha256ks_shani,
+          { transform_sha256d64_shani, transform_sha256d64_shani_2way, NULL, NULL, NULL }, { NULL, NULL, NULL, NULL }, { NULL, NULL, NULL }, { NULL, NULL, NULL } },
+#endif
+#if defined(__arm__) || defined(__aarch32__) || defined(__arm64__) || defined(__aarch64__) || defined(_M_ARM)
+        /* No ARMv8 transform_ks; scalar rounds would be slower. */
+        { SHA256_KERNEL_ARMV8, transform_sha256_armv8, transform_sha256d32_armv8, NULL,
+          { transform_sha256d64_armv8, transform_sha256d64_armv8_2way, NULL, NULL, NULL }, { NULL, NULL, NULL, NULL }, { NULL, NULL, NULL }, { NULL, NULL, NULL } },
+#endif
+};
+
+#define KERNEL_IMPLS (sizeof(kernel_impls) / sizeof(kernel_impls[0]))
+
+/** Whether kernel_impls[impl] implements an operation. */
+static int impl_has(size_t impl, int op)
 {
-        assert(ctx);
-        ctx->bytes = 0;
-        Initialize(ctx->s);
+        switch (op) {
+        case OP_TRANSFORM: return kernel_impls[impl].transform != NULL;
+        case OP_D64: return kernel_impls[impl].d64[0] != NULL;
+        case OP_D64_2WAY: return kernel_impls[impl].d64[1] != NULL;
+        case OP_D64_4WAY: return kernel_impls[impl].d64[2] != NULL;
+        case OP_D64_8WAY: return kernel_impls[impl].d64[3] != NULL;
+        case OP_D64_16WAY: return kernel_impls[impl].d64[4] != NULL;
+        case OP_MULTI_2WAY: return kernel_impls[impl].multi[0] != NULL;
+        case OP_MULTI_4WAY: return kernel_impls[impl].multi[1] != NULL;
+        case OP_MULTI_8WAY: return kernel_impls[impl].multi[2] != NULL;
+        case OP_MULTI_16WAY: return kernel_impls[impl].multi[3] != NULL;
+        case OP_H64_4WAY: return kernel_impls[impl].h64[0] != NULL;
+        case OP_H64_8WAY: return kernel_impls[impl].h64[1] != NULL;
+        case OP_H64_16WAY: return kernel_impls[impl].h64[2] != NULL;
+        case OP_STATES_4WAY: return kernel_impls[impl].states[0] != NULL;
+        case OP_STATES_8WAY: return kernel_impls[impl].states[1] != NULL;
+        case OP_STATES_16WAY: return kernel_impls[impl].states[2] != NULL;
+        }
+        return 0;
 }
 
-void sha256_update(struct sha256_ctx* ctx, const void *_data, size_t len)
+/** The kernel_impls entry bound to each operation, or -1 for none. */
+static int op_impl[OPS];
+
+/** Point the transform pointers at the entries recorded in op_impl, and
+ * update backend_name and selected_kernels to match. */
+static void install(void)
 {
-        const unsigned char* data = (const unsigned char*)_data;
-        const unsigned char* end = data + len;
-        size_t bufsize = ctx->bytes % 64;
-        if (bufsize && bufsize + len >= 64) {
-                /* Fill the buffer, and process it. */
-                memcpy(ctx->buf.u8 + bufsize, data, 64 - bufsize);
-                ctx->bytes += 64 - bufsize;
-                data += 64 - bufsize;
-                transform(ctx->s, ctx->buf.u8, 1);
-                bufsize = 0;
+        char* ret = backend_name;
+        size_t i;
+        int op;
+
+        transform = kernel_impls[op_impl[OP_TRANSFORM]].transform;
+        transform_d32 = kernel_impls[op_impl[OP_TRANSFORM]].d32;
+        transform_ks = kernel_impls[op_impl[OP_TRANSFORM]].ks;
+        transform_d64 = kernel_impls[op_impl[OP_D64]].d64[0];
+        transform_d64_2way = op_impl[OP_D64_2WAY] < 0 ? NULL : kernel_impls[op_impl[OP_D64_2WAY]].d64[1];
+        transform_d64_4way = op_impl[OP_D64_4WAY] < 0 ? NULL : kernel_impls[op_impl[OP_D64_4WAY]].d64[2];
+        transform_d64_8way = op_impl[OP_D64_8WAY] < 0 ? NULL : kernel_impls[op_impl[OP_D64_8WAY]].d64[3];
+        transform_d64_16way = op_impl[OP_D64_16WAY] < 0 ? NULL : kernel_impls[op_impl[OP_D64_16WAY]].d64[4];
+        transform_2way = op_impl[OP_MULTI_2WAY] < 0 ? NULL : kernel_impls[op_impl[OP_MULTI_2WAY]].multi[0];
+        transform_4way = op_impl[OP_MULTI_4WAY] < 0 ? NULL : kernel_impls[op_impl[OP_MULTI_4WAY]].multi[1];
+        transform_8way = op_impl[OP_MULTI_8WAY] < 0 ? NULL : kernel_impls[op_impl[OP_MULTI_8WAY]].multi[2];
+        transform_16way = op_impl[OP_MULTI_16WAY] < 0 ? NULL : kernel_impls[op_impl[OP_MULTI_16WAY]].multi[3];
+        transform_h64_4way = op_impl[OP_H64_4WAY] < 0 ? NULL : kernel_impls[op_impl[OP_H64_4WAY]].h64[0];
+        transform_h64_8way = op_impl[OP_H64_8WAY] < 0 ? NULL : kernel_impls[op_impl[OP_H64_8WAY]].h64[1];
+        transform_h64_16way = op_impl[OP_H64_16WAY] < 0 ? NULL : kernel_impls[op_impl[OP_H64_16WAY]].h64[2];
+        transform_states_4way = op_impl[OP_STATES_4WAY] < 0 ? NULL : kernel_impls[op_impl[OP_STATES_4WAY]].states[0];
+        transform_states_8way = op_impl[OP_STATES_8WAY] < 0 ? NULL : kernel_impls[op_impl[OP_STATES_8WAY]].states[1];
+        transform_states_16way = op_impl[OP_STATES_16WAY] < 0 ? NULL : kernel_impls[op_impl[OP_STATES_16WAY]].states[2];
+#if defined(SHA256_STATS)
+        for (op = 0; op < OPS; ++op) {
+                unsigned char bit = 0;
+                if (op_impl[op] >= 0) {
+                        while (!(kernel_impls[op_impl[op]].kernel & (1u << bit))) {
+                                ++bit;
+                        }
+                }
+                op_kernel[op] = bit;
+        }
+#endif
+
+        /* Describe the selection as e.g. "sse4(1way),sse41(4way),avx2(8way)",
+         * calling the generic code "standard". */
+        ret[0] = '\0';
+        selected_kernels = 0;
+        for (i = 0; i < KERNEL_IMPLS; ++i) {
+                unsigned lanes = 0;
+                for (op = 0; op < OPS; ++op) {
+                        if (op_impl[op] == (int)i) {
+                                lanes |= op == OP_TRANSFORM ? 1 : op_lanes[op];
+                        }
+                }
+                if (!lanes) {
+                        continue;
+                }
+                selected_kernels |= kernel_impls[i].kernel;
+                if (ret[0]) {
+                        strcat(ret, ",");
+                }
+                if (kernel_impls[i].kernel == SHA256_KERNEL_GENERIC) {
+                        strcat(ret, "standard");
+                        continue;
+                }
+                strcat(ret, sha256_kernel_name(kernel_impls[i].kernel));
+                strcat(ret, "(");
+                strcat(ret, lanes & 1 ? "1way," : "");
+                strcat(ret, lanes & 2 ? "2way," : "");
+                strcat(ret, lanes & 4 ? "4way," : "");
+                strcat(ret, lanes & 8 ? "8way," : "");
+                strcat(ret, lanes & 16 ? "16way," : "");
+                ret[strlen(ret) - 1] = ')';
+        }
+}
+
+/** Point the transform pointers at the given kernels.  Each operation uses
+ * the most preferred of the given kernels that implements it, falling back to
+ * the generic code. */
+static void bind(unsigned kernels)
+{
+        size_t i;
+        int op;
+        for (op = 0; op < OPS; ++op) {
+                op_impl[op] = op == OP_TRANSFORM || op == OP_D64 ? 0 : -1;
+                for (i = 1; i < KERNEL_IMPLS; ++i) {
+                        if ((kernels & kernel_impls[i].kernel) && impl_has(i, op)) {
+                                op_impl[op] = (int)i;
+                        }
+                }
+        }
+        install();
+}
+
+/* Calibration */
+
+/** Run one call of an operation of kernel_impls[impl] on scratch data. */
+static void run_op(int op, size_t impl, unsigned char buf[2048])
+{
+        struct sha256* out = (struct sha256*)(void*)buf;
+        const struct sha256* in = (const struct sha256*)(void*)(buf + 1024);
+        uint32_t* states = (uint32_t*)(void*)buf;
+        uint32_t s[8];
+        Initialize(s);
+        switch (op) {
+        case OP_TRANSFORM:
+                kernel_impls[impl].transform(s, buf + 1024, 8);
+                memcpy(buf, s, sizeof(s));
+                break;
+        case OP_D64: kernel_impls[impl].d64[0](out, in); break;
+        case OP_D64_2WAY: kernel_impls[impl].d64[1](out, in); break;
+        case OP_D64_4WAY: kernel_impls[impl].d64[2](out, in); break;
+        case OP_D64_8WAY: kernel_impls[impl].d64[3](out, in); break;
+        case OP_D64_16WAY: kernel_impls[impl].d64[4](out, in); break;
+        case OP_MULTI_2WAY: kernel_impls[impl].multi[0](out, s, buf + 1024); break;
+        case OP_MULTI_4WAY: kernel_impls[impl].multi[1](out, s, buf + 1024); break;
+        case OP_MULTI_8WAY: kernel_impls[impl].multi[2](out, s, buf + 1024); break;
+        case OP_MULTI_16WAY: kernel_impls[impl].multi[3](out, s, buf + 1024); break;
+        case OP_H64_4WAY: kernel_impls[impl].h64[0](out, in); break;
+        case OP_H64_8WAY: kernel_impls[impl].h64[1](out, in); break;
+        case OP_H64_16WAY: kernel_impls[impl].h64[2](out, in); break;
+        case OP_STATES_4WAY: kernel_impls[impl].states[0](states, buf + 1024); break;
+        case OP_STATES_8WAY: kernel_impls[impl].states[1](states, buf + 1024); break;
+        case OP_STATES_16WAY: kernel_impls[impl].states[2](states, buf + 1024); break;
+        }
+}
+
+/** Read the calling thread's processor time in seconds, or a negative value
+ * if there is no such clock.  Process time (clock()) would also count the
+ * other threads, which is noise here. */
+static double op_clock(void)
+{
+#if defined(CLOCK_THREAD_CPUTIME_ID)
+        struct timespec ts;
+        if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+                return ts.tv_sec + ts.tv_nsec * 1e-9;
+        }
+        return -1;
+#else
+        clock_t now = clock();
+        return now == (clock_t)-1 ? -1 : (double)now / CLOCKS_PER_SEC;
+#endif
+}
+
+/** Measure the processor time an operation of kernel_impls[impl] takes per
+ * lane (or block), as the best of a few short runs. */
+static double op_cost(int op, size_t impl)
+{
+        static union {
+                uint32_t align;
+                unsigned char u8[2048];
+        } buf;
+        double best = 0;
+        int trial;
+        memset(buf.u8, 0x5a, sizeof(buf.u8));
+        for (trial = 0; trial < 3; ++trial) {
+                unsigned long calls = 0;
+                double start = op_clock(), end;
+                if (start < 0) {
+                        /* No processor clock; keep the default order. */
+                        return 0;
+                }
+                do {
+                        run_op(op, impl, buf.u8);
+                        ++calls;
+                } while ((end = op_clock()) - start < 0.002);
+                if (!trial || (end - start) / calls < best) {
+                        best = (end - start) / calls;
+                }
+        }
+        return best / (op == OP_TRANSFORM ? 8 : op_lanes[op]);
+}
+
+/** Bind each operation to the fastest of the given kernels, preferring the
+ * later table entry on a tie.  A multi-lane operation is only used if it
+ * beats the narrower ones chosen before it, which decides how each batch size
+ * is split between lane widths. */
+static void calibrate(unsigned kernels)
+{
+        /* Each group starts from a single-lane operation.  A single-SHA256
+         * of a 64-byte message is two streaming transforms; OPS pads the
+         * group to length. */
+        static const int groups[4][5] = {
+                { OP_D64, OP_D64_2WAY, OP_D64_4WAY, OP_D64_8WAY, OP_D64_16WAY },
+                { OP_TRANSFORM, OP_MULTI_2WAY, OP_MULTI_4WAY, OP_MULTI_8WAY, OP_MULTI_16WAY },
+                { OP_TRANSFORM, OP_H64_4WAY, OP_H64_8WAY, OP_H64_16WAY, OPS },
+                { OP_TRANSFORM, OP_STATES_4WAY, OP_STATES_8WAY, OP_STATES_16WAY, OPS }
+        };
+        double best = 0;
+        size_t i;
+        int g, j;
+
+        /* The streaming transform, also used for single-lane midstates. */
+        op_impl[OP_TRANSFORM] = 0;
+        for (i = 0; i < KERNEL_IMPLS; ++i) {
+                if (((kernels & kernel_impls[i].kernel) || !i) && impl_has(i, OP_TRANSFORM)) {
+                        double cost = op_cost(OP_TRANSFORM, i);
+                        if (!i || cost <= best) {
+                                op_impl[OP_TRANSFORM] = (int)i;
+                                best = cost;
+                        }
+                }
+        }
+
+        for (g = 0; g < 4; ++g) {
+                double narrower = 0;
+                for (j = 0; j < 5; ++j) {
+                        int op = groups[g][j];
+                        if (op == OPS) {
+                                continue;
+                        }
+                        if (op == OP_TRANSFORM) {
+                                narrower = op_cost(op, op_impl[op]) * (g == 2 ? 2 : 1);
+                                continue;
+                        }
+                        op_impl[op] = -1;
+                        best = 0;
+                        for (i = 0; i < KERNEL_IMPLS; ++i) {
+                                if (((kernels & kernel_impls[i].kernel) || !i) && impl_has(i, op)) {
+                                        double cost = op_cost(op, i);
+                                        if ((j == 0 || cost <= narrower) && (op_impl[op] < 0 || cost <= best)) {
+                                                op_impl[op] = (int)i;
+                                                best = cost;
+                                        }
+                                }
+                        }
+                        if (op_impl[op] >= 0) {
+                                narrower = best;
+                        }
+                }
+        }
+
+        install();
+}
+
+/** A string identifying the host and build, so that cached tuning results
+ * are discarded when either changes. */
+static void tuning_key(char key[128], unsigned kernels)
+{
+        uint32_t signature = 0;
+#if defined(HAVE_GETCPUID)
+        uint32_t ebx = 0, ecx = 0, edx = 0;
+        GetCPUID(1, 0, &signature, &ebx, &ecx, &edx);
+#endif
+#if defined(PACKAGE_VERSION)
+        sprintf(key, "libsha2-tune %s %x %x %lx", PACKAGE_VERSION, available_kernels, kernels, (unsigned long)signature);
+#else
+        sprintf(key, "libsha2-tune %x %x %lx", available_kernels, kernels, (unsigned long)signature);
+#endif
+}
+
+/** Read the tuning results cached in a file, returning zero if it is missing,
+ * malformed or stale. */
+static int load_tuning(const char* path, unsigned kernels)
+{
+        char key[128], line[160], name[32], kernel[32];
+        int impls[OPS];
+        int op, ok = 1;
+        FILE* f = fopen(path, "r");
+        if (!f) {
+                return 0;
+        }
+        tuning_key(key, kernels);
+        if (!fgets(line, sizeof(line), f) || strncmp(line, key, strlen(key)) || line[strlen(key)] != '\n') {
+                fclose(f);
+                return 0;
+        }
+        for (op = 0; op < OPS && ok; ++op) {
+                size_t i;
+                ok = fgets(line, sizeof(line), f) && sscanf(line, "%31s %31s", name, kernel) == 2 && !strcmp(name, op_names[op]);
+                impls[op] = -1;
+                for (i = 0; ok && i < KERNEL_IMPLS; ++i) {
+                        if (!strcmp(kernel, sha256_kernel_name(kernel_impls[i].kernel)) && impl_has(i, op)) {
+                                impls[op] = (int)i;
+                        }
+                }
+                if (impls[op] < 0 && (op == OP_TRANSFORM || op == OP_D64 || strcmp(kernel, "none"))) {
+                        ok = 0;
+                }
+        }
+        fclose(f);
+        if (ok) {
+                memcpy(op_impl, impls, sizeof(op_impl));
+                install();
+        }
+        return ok;
+}
+
+/** Cache the current tuning results in a file.  Failure is not an error.
+ * The results are written to a temporary file beside it and renamed into
+ * place, so that a concurrent load_tuning() never sees a partial file. */
+static void save_tuning(const char* path, unsigned kernels)
+{
+        char key[128];
+        char* tmp;
+        int op, ok;
+        FILE* f;
+        tmp = (char*)malloc(strlen(path) + 32);
+        if (!tmp) {
+                return;
+        }
+#if defined(HAVE_UNISTD_H)
+        sprintf(tmp, "%s.%lu.tmp", path, (unsigned long)getpid());
+#else
+        sprintf(tmp, "%s.tmp", path);
+#endif
+        /* Exclusive creation, so that an existing file or link is never
+         * followed and overwritten. */
+        f = fopen(tmp, "wx");
+        if (!f) {
+                free(tmp);
+                return;
+        }
+        tuning_key(key, kernels);
+        fprintf(f, "%s\n", key);
+        for (op = 0; op < OPS; ++op) {
+                fprintf(f, "%s %s\n", op_names[op], op_impl[op] < 0 ? "none" : sha256_kernel_name(kernel_impls[op_impl[op]].kernel));
+        }
+        ok = !ferror(f);
+        ok &= fclose(f) == 0;
+        if (!ok || rename(tmp, path)) {
+                remove(tmp);
+        }
+        free(tmp);
+}
+
+/** Calibrate among the given kernels, using and updating the cache file if a
+ * path is given.  Returns 1 if the cached results were used. */
+static int tune(unsigned kernels, const char* path)
+{
+        if (path && load_tuning(path, kernels)) {
+                assert(self_test());
+                return 1;
+        }
+        calibrate(kernels);
+        assert(self_test());
+        if (path) {
+                save_tuning(path, kernels);
+        }
+        return 0;
+}
+
+/** Select the best available kernels. */
+static void detect(void)
+{
+        unsigned kernels = available_kernels = probe();
+        if (kernels & SHA256_KERNEL_SHANI) {
+                /* Disable SSE4/AVX2 */
+                kernels &= ~(SHA256_KERNEL_SSE4 | SHA256_KERNEL_SSE41 | SHA256_KERNEL_AVX2);
+        }
+        if (kernels & (SHA256_KERNEL_SHANI | SHA256_KERNEL_ARMV8)) {
+                /* Hardware rounds beat the portable vectors even at 8 lanes */
+                kernels &= ~SHA256_KERNEL_VEC;
+        }
+        if (kernels & SHA256_KERNEL_SSE41) {
+                /* SSE4.1 at 4 lanes beats the SSE2 vectors even at 8 */
+                kernels &= ~SHA256_KERNEL_VEC;
+        }
+        bind(kernels);
+        assert(self_test());
+}
+
+/** Parse a comma-separated list of kernel names, returning 0 if any name is
+ * not recognized. */
+static unsigned parse_kernels(const char* str)
+{
+        unsigned kernels = 0;
+        while (*str) {
+                size_t len = strcspn(str, ",");
+                size_t i;
+                for (i = 0; i < sizeof(kernel_table) / sizeof(kernel_table[0]); ++i) {
+                        if (strlen(kernel_table[i].name) == len && !strncmp(kernel_table[i].name, str, len)) {
+                                kernels |= kernel_table[i].kernel;
+                                break;
+                        }
+                }
+                if (i == sizeof(kernel_table) / sizeof(kernel_table[0])) {
+                        return 0;
+                }
+                str += len;
+                if (*str == ',') {
+                        ++str;
+                }
+        }
+        return kernels;
+}
+
+/** Read an environment override.  A setuid or setgid program's environment
+ * belongs to its caller, so there the overrides are ignored. */
+static const char* env_override(const char* name)
+{
+#if defined(HAVE_SECURE_GETENV)
+        return secure_getenv(name);
+#elif defined(HAVE_ISSETUGID)
+        return issetugid() ? NULL : getenv(name);
+#else
+        return getenv(name);
+#endif
+}
+
+/** Apply the LIBSHA2_BACKEND and LIBSHA2_TUNE environment overrides, if any.
+ * Unknown or unavailable kernels leave the detected selection in place.  This
+ * runs at load time, so it only reads a tuning cache: benchmarking and
+ * writing the cache are left to an explicit sha256_calibrate(). */
+static void apply_env(void)
+{
+        const char* env = env_override("LIBSHA2_BACKEND");
+        const char* tune_path = env_override("LIBSHA2_TUNE");
+        unsigned kernels = available_kernels;
+        if (env && strcmp(env, "auto")) {
+                unsigned requested = parse_kernels(env);
+                if (requested && !(requested & ~available_kernels)) {
+                        kernels = requested;
+                        bind(kernels);
+                        assert(self_test());
+                }
+        }
+        if (tune_path && *tune_path && load_tuning(tune_path, kernels)) {
+                assert(self_test());
+        }
+}
+
+/** Set once detection has run, so that it runs only once. */
+static int detected = 0;
+
+/** Detect, then apply the environment override. */
+static void run_detect_env(void)
+{
+        if (!detected) {
+                detect();
+                apply_env();
+                detected = !0;
+        }
+}
+
+#if defined(HAVE_PTHREAD_ONCE)
+static pthread_once_t detect_once = PTHREAD_ONCE_INIT;
+#endif
+
+/** Make sure backend detection has completed, racing threads included. */
+static inline void sha256_init_once(void)
+{
+#if defined(HAVE_PTHREAD_ONCE)
+        pthread_once(&detect_once, run_detect_env);
+#else
+        run_detect_env();
+#endif
+}
+
+#if defined(__GNUC__)
+/** Detect and apply the environment override before main(), so that the
+ * once-guard in each entry point is normally already settled. */
+static void __attribute__((constructor)) sha256_load(void)
+{
+        sha256_init_once();
+}
+#endif
+
+const char* sha256_auto_detect(void)
+{
+        sha256_init_once();
+        return backend_name;
+}
+
+unsigned sha256_available_kernels(void)
+{
+        sha256_init_once();
+        return available_kernels;
+}
+
+unsigned sha256_selected_kernels(void)
+{
+        sha256_init_once();
+        return selected_kernels;
+}
+
+int sha256_select_backend(unsigned kernels)
+{
+        sha256_init_once();
+        if (!kernels) {
+                detect();
+                return 0;
+        }
+        if (kernels & ~available_kernels) {
+                return -1;
+        }
+        bind(kernels);
+        assert(self_test());
+        return 0;
+}
+
+int sha256_calibrate(const char* cache_path)
+{
+        sha256_init_once();
+        return tune(available_kernels, cache_path);
+}
+#endif /* SHA256_BACKEND_PINNED */
+
+/* Statistics */
+
+#if defined(SHA256_STATS)
+/** Each thread counts into its own node, so the hot path takes no locks.
+ * The nodes are linked together for sha256_stats_snapshot(), and folded into
+ * retired_stats when their thread exits.  The snapshot reads counters while
+ * their owners update them, so every access is a relaxed atomic one. */
+struct stats_node {
+        struct sha256_stats stats;
+        struct stats_node* next;
+};
+
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t stats_once = PTHREAD_ONCE_INIT;
+static pthread_key_t stats_key;
+static struct stats_node* stats_threads = NULL;
+static struct sha256_stats retired_stats;
+/* Shared by any threads whose node could not be allocated, or was already
+ * retired when a later thread-exit destructor hashed. */
+static struct stats_node stats_fallback;
+static __thread struct stats_node* stats_node = NULL;
+
+/** Add one set of counters to another, which the caller owns or guards with
+ * stats_lock.  The structure holds nothing but uint64_t arrays, so it is
+ * summed as one. */
+static void stats_add(struct sha256_stats* to, const struct sha256_stats* from)
+{
+        uint64_t* t = (uint64_t*)to;
+        const uint64_t* f = (const uint64_t*)from;
+        size_t i;
+        for (i = 0; i < sizeof(*to) / sizeof(uint64_t); ++i) {
+                t[i] += __atomic_load_n(&f[i], __ATOMIC_RELAXED);
+        }
+}
+
+static void stats_thread_exit(void* arg)
+{
+        struct stats_node* node = (struct stats_node*)arg;
+        struct stats_node** p;
+        pthread_mutex_lock(&stats_lock);
+        for (p = &stats_threads; *p; p = &(*p)->next) {
+                if (*p == node) {
+                        *p = node->next;
+                        break;
+                }
+        }
+        stats_add(&retired_stats, &node->stats);
+        pthread_mutex_unlock(&stats_lock);
+        /* Other destructors may still hash on this thread.  Registering
+         * again would set the key from within its own destructor, so count
+         * anything after this point in the shared fallback instead. */
+        stats_node = &stats_fallback;
+        free(node);
+}
+
+static void stats_create_key(void)
+{
+        pthread_key_create(&stats_key, stats_thread_exit);
+}
+
+/** Allocate and register the calling thread's counters. */
+static struct sha256_stats* stats_register(void)
+{
+        struct stats_node* node = (struct stats_node*)calloc(1, sizeof(struct stats_node));
+        if (!node) {
+                stats_node = &stats_fallback;
+                return &stats_fallback.stats;
+        }
+        pthread_once(&stats_once, stats_create_key);
+        pthread_setspecific(stats_key, node);
+        pthread_mutex_lock(&stats_lock);
+        node->next = stats_threads;
+        stats_threads = node;
+        pthread_mutex_unlock(&stats_lock);
+        stats_node = node;
+        return &node->stats;
+}
+
+/** The calling thread's counters. */
+static struct sha256_stats* stats_local(void)
+{
+        return stats_node ? &stats_node->stats : stats_register();
+}
+
+/** Add to one of the given counters.  Only its owning thread writes a
+ * node, so a relaxed load and store do, and cost the same as plain accesses;
+ * the shared fallback needs a real atomic add. */
+static inline void stats_bump(struct sha256_stats* stats, uint64_t* counter, uint64_t n)
+{
+        if (stats == &stats_fallback.stats) {
+                __atomic_fetch_add(counter, n, __ATOMIC_RELAXED);
+        } else {
+                __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + n, __ATOMIC_RELAXED);
+        }
+}
+
+#define STATS_LOCAL struct sha256_stats* stats = stats_local();
+#define STATS_API(api, len) (stats_bump(stats, &stats->api_calls[api], 1), stats_bump(stats, &stats->api_bytes[api], (len)))
+#define STATS_KERNEL(op, blocks) (stats_bump(stats, &stats->kernel_calls[op_kernel[op]], 1), stats_bump(stats, &stats->kernel_blocks[op_kernel[op]], (blocks)))
+#define STATS_LANES(hist, i) stats_bump(stats, &stats->hist[i], 1)
+#define STATS_LANES_N(hist, i, n) stats_bump(stats, &stats->hist[i], (n))
+#else
+#define STATS_LOCAL
+#define STATS_API(api, len) ((void)0)
+#define STATS_KERNEL(op, blocks) ((void)0)
+#define STATS_LANES(hist, i) ((void)0)
+#define STATS_LANES_N(hist, i, n) ((void)0)
+#endif
+
+int sha256_stats_snapshot(struct sha256_stats* stats)
+{
+        memset(stats, 0, sizeof(*stats));
+#if defined(SHA256_STATS)
+        {
+                const struct stats_node* node;
+                pthread_mutex_lock(&stats_lock);
+                stats_add(stats, &retired_stats);
+                stats_add(stats, &stats_fallback.stats);
+                for (node = stats_threads; node; node = node->next) {
+                        stats_add(stats, &node->stats);
+                }
+                pthread_mutex_unlock(&stats_lock);
+        }
+        return 0;
+#else
+        return -1;
+#endif
+}
+
+/* Tracing */
+
+/* With --enable-usdt, the entry points carry static probes in the libsha2
+ * provider, each with two arguments: the input size and the selected kernels
+ * (a mask of enum sha256_kernel values).
+ *
+ *   update    bytes passed to sha256_update()
+ *   done      total bytes hashed, for sha256_done() and sha256d_done()
+ *   double64  number of hashes passed to sha256_double64()
+ *   midstate  number of blocks passed to sha256_midstate()
+ *   hash64    number of hashes passed to sha256_hash64()
+ *
+ * For example: bpftrace -e 'usdt:libsha2.so:libsha2:double64 { @[arg0] = count(); }'
+ */
+#if defined(SHA256_USDT)
+#if defined(SHA256_BACKEND_PINNED)
+#define PROBE(name, size) DTRACE_PROBE2(libsha2, name, size, PINNED_KERNELS)
+#else
+#define PROBE(name, size) DTRACE_PROBE2(libsha2, name, size, selected_kernels)
+#endif
+#else
+#define PROBE(name, size) ((void)0)
+#endif
+
+/* SHA-256 */
+
+void sha256_init(struct sha256_ctx* ctx)
+{
+        assert(ctx);
+        ctx->bytes = 0;
+        Initialize(ctx->s);
+}
+
+/** The body of sha256_update(), also used internally. */
+static void sha256_absorb(struct sha256_ctx* ctx, const void *_data, size_t len)
+{
+        const unsigned char* data = (const unsigned char*)_data;
+        const unsigned char* end = data + len;
+        size_t bufsize = ctx->bytes % 64;
+        STATS_LOCAL
+        if (bufsize && bufsize + len >= 64) {
+                /* Fill the buffer, and process it. */
+                memcpy(ctx->buf.u8 + bufsize, data, 64 - bufsize);
+                ctx->bytes += 64 - bufsize;
+                data += 64 - bufsize;
+                transform(ctx->s, ctx->buf.u8, 1);
+                STATS_KERNEL(OP_TRANSFORM, 1);
+                bufsize = 0;
         }
         if (end - data >= 64) {
                 size_t blocks = (end - data) / 64;
                 transform(ctx->s, data, blocks);
+                STATS_KERNEL(OP_TRANSFORM, blocks);
                 data += 64 * blocks;
                 ctx->bytes += 64 * blocks;
         }
@@ -698,16 +2014,72 @@ void sha256_update(struct sha256_ctx* ctx, const void *_data, size_t len)
         }
 }
 
-void sha256_done(struct sha256* hash, struct sha256_ctx* ctx)
+static void sha256_update_impl(struct sha256_ctx* ctx, const void *data, size_t len)
+{
+        STATS_LOCAL
+        STATS_API(SHA256_API_UPDATE, len);
+        PROBE(update, len);
+        sha256_absorb(ctx, data, len);
+}
+
+#if defined(HAVE_THREAD_LOCAL)
+/** The padding-only final block schedule most recently used by this thread.
+ * Workloads that finish many equal-length messages, e.g. fixed-size pages,
+ * compute it once.  The schedule is only computed once a length repeats: on
+ * SHA-NI, whose own message schedule is nearly free, computing it for a
+ * single use is slower than a plain transform. */
+static __thread struct {
+        size_t bytes;
+        int valid;
+        uint32_t ks[64];
+} pad_cache;
+#endif
+
+/** Hash the padding and message length, leaving the final state in ctx->s. */
+static void sha256_pad(struct sha256_ctx* ctx)
 {
         static const unsigned char pad[64] = {0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
                                                  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
                                                  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
                                                  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
         unsigned char sizedesc[8];
+        size_t bufsize = ctx->bytes % 64;
+        STATS_LOCAL
+#if defined(HAVE_THREAD_LOCAL)
+        if (transform_ks && (bufsize == 0 || bufsize >= 56)) {
+                /* The final block contains only padding and the length, so its
+                 * message schedule depends on nothing but the length. */
+                if (pad_cache.bytes != ctx->bytes) {
+                        /* Remember the length, and hash this one plainly. */
+                        pad_cache.bytes = ctx->bytes;
+                        pad_cache.valid = 0;
+                } else {
+                        if (!pad_cache.valid) {
+                                pad_schedule(pad_cache.ks, ctx->bytes);
+                                pad_cache.valid = 1;
+                        }
+                        if (bufsize) {
+                                memcpy(ctx->buf.u8 + bufsize, pad, 64 - bufsize);
+                                transform(ctx->s, ctx->buf.u8, 1);
+                                STATS_KERNEL(OP_TRANSFORM, 1);
+                        }
+                        transform_ks(ctx->s, pad_cache.ks);
+                        STATS_KERNEL(OP_TRANSFORM, 1);
+                        return;
+                }
+        }
+#endif
         WriteBE64(sizedesc, ctx->bytes << 3);
-        sha256_update(ctx, pad, 1 + ((119 - (ctx->bytes % 64)) % 64));
-        sha256_update(ctx, sizedesc, 8);
+        sha256_absorb(ctx, pad, 1 + ((119 - bufsize) % 64));
+        sha256_absorb(ctx, sizedesc, 8);
+}
+
+static void sha256_done_impl(struct sha256* hash, struct sha256_ctx* ctx)
+{
+        STATS_LOCAL
+        STATS_API(SHA256_API_DONE, 0);
+        PROBE(done, ctx->bytes);
+        sha256_pad(ctx);
         WriteBE32(&hash->u8[0], ctx->s[0]);
         WriteBE32(&hash->u8[4], ctx->s[1]);
         WriteBE32(&hash->u8[8], ctx->s[2]);
@@ -718,11 +2090,104 @@ void sha256_done(struct sha256* hash, struct sha256_ctx* ctx)
         WriteBE32(&hash->u8[28], ctx->s[7]);
 }
 
-void sha256_double64(struct sha256 out[], const struct sha256 in[], size_t blocks)
+/** Pad a message of at most 119 bytes into one or two blocks on the stack and
+ * hash it from the initial state already in s, leaving the final state in s. */
+static void sha256_short(uint32_t s[8], const unsigned char* data, size_t len)
+{
+        unsigned char buf[128];
+        size_t blocks = len < 56 ? 1 : 2;
+        STATS_LOCAL
+        assert(len < 120);
+        if (len) {
+                memcpy(buf, data, len);
+        }
+        buf[len] = 0x80;
+        memset(buf + len + 1, 0, 64 * blocks - 9 - len);
+        WriteBE64(buf + 64 * blocks - 8, (uint64_t)len << 3);
+        transform(s, buf, blocks);
+        STATS_KERNEL(OP_TRANSFORM, blocks);
+}
+
+static void sha256_impl(struct sha256* hash, const void* data, size_t len)
+{
+        struct sha256_ctx ctx;
+        STATS_LOCAL
+        STATS_API(SHA256_API_ONESHOT, len);
+        if (len < 120) {
+                Initialize(ctx.s);
+                sha256_short(ctx.s, (const unsigned char*)data, len);
+        } else {
+                sha256_init(&ctx);
+                sha256_absorb(&ctx, data, len);
+                sha256_pad(&ctx);
+        }
+        WriteBE32(&hash->u8[0], ctx.s[0]);
+        WriteBE32(&hash->u8[4], ctx.s[1]);
+        WriteBE32(&hash->u8[8], ctx.s[2]);
+        WriteBE32(&hash->u8[12], ctx.s[3]);
+        WriteBE32(&hash->u8[16], ctx.s[4]);
+        WriteBE32(&hash->u8[20], ctx.s[5]);
+        WriteBE32(&hash->u8[24], ctx.s[6]);
+        WriteBE32(&hash->u8[28], ctx.s[7]);
+}
+
+/* Double SHA-256 */
+
+/** Hash the padding, then hash the resulting digest again. */
+static void sha256d_finish(struct sha256* hash, struct sha256_ctx* ctx)
+{
+        STATS_LOCAL
+        sha256_pad(ctx);
+        transform_d32(hash, ctx->s);
+        STATS_KERNEL(OP_TRANSFORM, 1);
+}
+
+static void sha256d_done_impl(struct sha256* hash, struct sha256_ctx* ctx)
 {
+        STATS_LOCAL
+        STATS_API(SHA256_API_DONE, 0);
+        PROBE(done, ctx->bytes);
+        sha256d_finish(hash, ctx);
+}
+
+static void sha256d_impl(struct sha256* hash, const void* data, size_t len)
+{
+        struct sha256_ctx ctx;
+        STATS_LOCAL
+        STATS_API(SHA256_API_DOUBLE, len);
+        if (len < 120) {
+                Initialize(ctx.s);
+                sha256_short(ctx.s, (const unsigned char*)data, len);
+                transform_d32(hash, ctx.s);
+                STATS_KERNEL(OP_TRANSFORM, 1);
+                return;
+        }
+        sha256_init(&ctx);
+        sha256_absorb(&ctx, data, len);
+        sha256d_finish(hash, &ctx);
+}
+
+static void sha256_double64_impl(struct sha256 out[], const struct sha256 in[], size_t blocks)
+{
+        STATS_LOCAL
+        STATS_API(SHA256_API_DOUBLE64, 64 * blocks);
+        PROBE(double64, blocks);
+        /* Each lane hashes the 64 bytes, their padding, then the digest. */
+        if (transform_d64_16way) {
+                while (blocks >= 16) {
+                        transform_d64_16way(out, in);
+                        STATS_KERNEL(OP_D64_16WAY, 48);
+                        STATS_LANES(double64_lanes, 4);
+                        out += 16;
+                        in += 32;
+                        blocks -= 16;
+                }
+        }
         if (transform_d64_8way) {
                 while (blocks >= 8) {
                         transform_d64_8way(out, in);
+                        STATS_KERNEL(OP_D64_8WAY, 24);
+                        STATS_LANES(double64_lanes, 3);
                         out += 8;
                         in += 16;
                         blocks -= 8;
@@ -731,6 +2196,8 @@ void sha256_double64(struct sha256 out[], const struct sha256 in[], size_t block
         if (transform_d64_4way) {
                 while (blocks >= 4) {
                         transform_d64_4way(out, in);
+                        STATS_KERNEL(OP_D64_4WAY, 12);
+                        STATS_LANES(double64_lanes, 2);
                         out += 4;
                         in += 8;
                         blocks -= 4;
@@ -739,6 +2206,8 @@ void sha256_double64(struct sha256 out[], const struct sha256 in[], size_t block
         if (transform_d64_2way) {
                 while (blocks >= 2) {
                         transform_d64_2way(out, in);
+                        STATS_KERNEL(OP_D64_2WAY, 6);
+                        STATS_LANES(double64_lanes, 1);
                         out += 2;
                         in += 4;
                         blocks -= 2;
@@ -746,17 +2215,31 @@ void sha256_double64(struct sha256 out[], const struct sha256 in[], size_t block
         }
         while (blocks) {
                 transform_d64(out, in);
+                STATS_KERNEL(OP_D64, 3);
+                STATS_LANES(double64_lanes, 0);
                 ++out;
                 in += 2;
                 --blocks;
         }
 }
 
-void sha256_midstate(struct sha256 out[], const uint32_t midstate[8], const unsigned char in[], size_t blocks)
+/** The body of sha256_midstate(), also used internally. */
+static void sha256_midstate_lanes(struct sha256 out[], const uint32_t midstate[8], const unsigned char in[], size_t blocks)
 {
+        STATS_LOCAL
+        if (transform_16way) {
+                while (blocks >= 16) {
+                        transform_16way(out, midstate, in);
+                        STATS_KERNEL(OP_MULTI_16WAY, 16);
+                        out += 16;
+                        in += 1024;
+                        blocks -= 16;
+                }
+        }
         if (transform_8way) {
                 while (blocks >= 8) {
                         transform_8way(out, midstate, in);
+                        STATS_KERNEL(OP_MULTI_8WAY, 8);
                         out += 8;
                         in += 512;
                         blocks -= 8;
@@ -765,6 +2248,7 @@ void sha256_midstate(struct sha256 out[], const uint32_t midstate[8], const unsi
         if (transform_4way) {
                 while (blocks >= 4) {
                         transform_4way(out, midstate, in);
+                        STATS_KERNEL(OP_MULTI_4WAY, 4);
                         out += 4;
                         in += 256;
                         blocks -= 4;
@@ -773,6 +2257,7 @@ void sha256_midstate(struct sha256 out[], const uint32_t midstate[8], const unsi
         if (transform_2way) {
                 while (blocks >= 2) {
                         transform_2way(out, midstate, in);
+                        STATS_KERNEL(OP_MULTI_2WAY, 2);
                         out += 2;
                         in += 128;
                         blocks -= 2;
@@ -784,6 +2269,7 @@ void sha256_midstate(struct sha256 out[], const uint32_t midstate[8], const unsi
                 int i;
                 memcpy(s, midstate, 8 * sizeof(uint32_t));
                 transform(s, in, 1);
+                STATS_KERNEL(OP_TRANSFORM, 1);
                 for (i = 0; i < 8; ++i) {
                         WriteBE32(_out, s[i]);
                         _out += 4;
@@ -794,5 +2280,731 @@ void sha256_midstate(struct sha256 out[], const uint32_t midstate[8], const unsi
         }
 }
 
+static void sha256_midstate_impl(struct sha256 out[], const uint32_t midstate[8], const unsigned char in[], size_t blocks)
+{
+        STATS_LOCAL
+        STATS_API(SHA256_API_MIDSTATE, 64 * blocks);
+        PROBE(midstate, blocks);
+#if defined(SHA256_STATS)
+        {
+                /* Counted here rather than in sha256_midstate_lanes(), which
+                 * HMAC, HKDF and sha224_batch() share, splitting the batch
+                 * the same way it does. */
+                size_t n = blocks;
+                if (transform_16way) {
+                        STATS_LANES_N(midstate_lanes, 4, n / 16);
+                        n %= 16;
+                }
+                if (transform_8way) {
+                        STATS_LANES_N(midstate_lanes, 3, n / 8);
+                        n %= 8;
+                }
+                if (transform_4way) {
+                        STATS_LANES_N(midstate_lanes, 2, n / 4);
+                        n %= 4;
+                }
+                if (transform_2way) {
+                        STATS_LANES_N(midstate_lanes, 1, n / 2);
+                        n %= 2;
+                }
+                STATS_LANES_N(midstate_lanes, 0, n);
+        }
+#endif
+        sha256_midstate_lanes(out, midstate, in, blocks);
+}
+
+static void sha256_hash64_impl(struct sha256 out[], const struct sha256 in[], size_t blocks)
+{
+        STATS_LOCAL
+        STATS_API(SHA256_API_HASH64, 64 * blocks);
+        PROBE(hash64, blocks);
+        /* Each lane hashes the 64 bytes, then their padding. */
+        if (transform_h64_16way) {
+                while (blocks >= 16) {
+                        transform_h64_16way(out, in);
+                        STATS_KERNEL(OP_H64_16WAY, 32);
+                        STATS_LANES(hash64_lanes, 4);
+                        out += 16;
+                        in += 32;
+                        blocks -= 16;
+                }
+        }
+        if (transform_h64_8way) {
+                while (blocks >= 8) {
+                        transform_h64_8way(out, in);
+                        STATS_KERNEL(OP_H64_8WAY, 16);
+                        STATS_LANES(hash64_lanes, 3);
+                        out += 8;
+                        in += 16;
+                        blocks -= 8;
+                }
+        }
+        if (transform_h64_4way) {
+                while (blocks >= 4) {
+                        transform_h64_4way(out, in);
+                        STATS_KERNEL(OP_H64_4WAY, 8);
+                        STATS_LANES(hash64_lanes, 2);
+                        out += 4;
+                        in += 8;
+                        blocks -= 4;
+                }
+        }
+        while (blocks) {
+                transform_h64_wrapper(out, in, transform);
+                STATS_KERNEL(OP_TRANSFORM, 2);
+                STATS_LANES(hash64_lanes, 0);
+                ++out;
+                in += 2;
+                --blocks;
+        }
+}
+
+/* SHA-224 */
+
+void sha224_init(struct sha256_ctx* ctx)
+{
+        assert(ctx);
+        ctx->bytes = 0;
+        Initialize224(ctx->s);
+}
+
+static void sha224_write(struct sha224* hash, const uint32_t s[8])
+{
+        WriteBE32(&hash->u8[0], s[0]);
+        WriteBE32(&hash->u8[4], s[1]);
+        WriteBE32(&hash->u8[8], s[2]);
+        WriteBE32(&hash->u8[12], s[3]);
+        WriteBE32(&hash->u8[16], s[4]);
+        WriteBE32(&hash->u8[20], s[5]);
+        WriteBE32(&hash->u8[24], s[6]);
+}
+
+static void sha224_done_impl(struct sha224* hash, struct sha256_ctx* ctx)
+{
+        STATS_LOCAL
+        STATS_API(SHA256_API_DONE, 0);
+        PROBE(done, ctx->bytes);
+        sha256_pad(ctx);
+        sha224_write(hash, ctx->s);
+}
+
+/** sha224(), without the statistics and probe. */
+static void sha224_oneshot(struct sha224* hash, const void* data, size_t len)
+{
+        struct sha256_ctx ctx;
+        if (len < 120) {
+                Initialize224(ctx.s);
+                sha256_short(ctx.s, (const unsigned char*)data, len);
+        } else {
+                sha224_init(&ctx);
+                sha256_absorb(&ctx, data, len);
+                sha256_pad(&ctx);
+        }
+        sha224_write(hash, ctx.s);
+}
+
+static void sha224_impl(struct sha224* hash, const void* data, size_t len)
+{
+        STATS_LOCAL
+        STATS_API(SHA256_API_ONESHOT, len);
+        sha224_oneshot(hash, data, len);
+}
+
+static void sha224_batch_impl(struct sha224 out[], const void* const msg[], const size_t len[], size_t n)
+{
+        unsigned char blocks[16 * 64];
+        struct sha256 hashes[16];
+        uint32_t iv[8];
+        size_t i = 0, j, k;
+        STATS_LOCAL
+        Initialize224(iv);
+        while (i < n) {
+                /* Pad the next run of single-block messages side by side. */
+                for (k = 0; k < 16 && i + k < n && len[i + k] < 56; ++k) {
+                        unsigned char* block = blocks + 64 * k;
+                        STATS_API(SHA256_API_ONESHOT, len[i + k]);
+                        if (len[i + k]) {
+                                memcpy(block, msg[i + k], len[i + k]);
+                        }
+                        block[len[i + k]] = 0x80;
+                        memset(block + len[i + k] + 1, 0, 55 - len[i + k]);
+                        WriteBE64(block + 56, (uint64_t)len[i + k] << 3);
+                }
+                if (!k) {
+                        STATS_API(SHA256_API_ONESHOT, len[i]);
+                        sha224_oneshot(&out[i], msg[i], len[i]);
+                        ++i;
+                        continue;
+                }
+                sha256_midstate_lanes(hashes, iv, blocks, k);
+                for (j = 0; j < k; ++j) {
+                        memcpy(out[i + j].u8, hashes[j].u8, 28);
+                }
+                i += k;
+        }
+}
+
+/* Per-lane states */
+
+static void sha256_write(struct sha256* hash, const uint32_t s[8])
+{
+        int i;
+        for (i = 0; i < 8; ++i) {
+                WriteBE32(&hash->u8[4 * i], s[i]);
+        }
+}
+
+/** Finish up to lanes messages side by side with a per-lane state kernel.
+ * Lane i resumes from the state s + 8 * i after offset bytes, a multiple of
+ * 64, hashes the headlen bytes at head, shared by all lanes and fewer than
+ * 64, then the len[i] bytes at msg[i], and writes its digest to out[i] once
+ * its last block is done.  Lanes past n repeat the first. */
+static void sha256_lanes(struct sha256 out[], uint32_t s[8 * 16], uint64_t offset, const unsigned char* head, size_t headlen, const void* const msg[], const size_t len[], size_t n, size_t lanes, transform_states_t states, int op)
+{
+        unsigned char tail[16][128];
+        unsigned char in[16 * 64];
+        size_t full[16], blocks[16];
+        size_t i, b, rounds = 0;
+        STATS_LOCAL
+        (void)op;
+        assert(headlen < 64);
+        for (i = 0; i < lanes; ++i) {
+                const unsigned char* m = (const unsigned char*)msg[i < n ? i : 0];
+                size_t l = headlen + len[i < n ? i : 0];
+                size_t rest = l % 64;
+                full[i] = l / 64;
+                blocks[i] = full[i] + (rest < 56 ? 1 : 2);
+                if (!full[i]) {
+                        if (headlen) {
+                                memcpy(tail[i], head, headlen);
+                        }
+                        if (rest > headlen) {
+                                memcpy(tail[i] + headlen, m, rest - headlen);
+                        }
+                } else if (rest) {
+                        memcpy(tail[i], m + 64 * full[i] - headlen, rest);
+                }
+                tail[i][rest] = 0x80;
+                memset(tail[i] + rest + 1, 0, 64 * (blocks[i] - full[i]) - 9 - rest);
+                WriteBE64(tail[i] + 64 * (blocks[i] - full[i]) - 8, (offset + l) << 3);
+                if (i >= n) {
+                        memcpy(s + 8 * i, s, 8 * sizeof(uint32_t));
+                        full[i] = 0;
+                } else if (blocks[i] > rounds) {
+                        rounds = blocks[i];
+                }
+        }
+        for (b = 0; b < rounds; ++b) {
+                for (i = 0; i < lanes; ++i) {
+                        if (b < full[i]) {
+                                const unsigned char* m = (const unsigned char*)msg[i];
+                                if (b) {
+                                        memcpy(in + 64 * i, m + 64 * b - headlen, 64);
+                                } else {
+                                        if (headlen) {
+                                                memcpy(in + 64 * i, head, headlen);
+                                        }
+                                        memcpy(in + 64 * i + headlen, m, 64 - headlen);
+                                }
+                        } else if (b < blocks[i]) {
+                                memcpy(in + 64 * i, tail[i] + 64 * (b - full[i]), 64);
+                        }
+                        /* Otherwise finished: the stale block will do. */
+                }
+                states(s, in);
+                STATS_KERNEL(op, lanes);
+                for (i = 0; i < n; ++i) {
+                        if (b + 1 == blocks[i]) {
+                                sha256_write(&out[i], s + 8 * i);
+                        }
+                }
+        }
+}
+
+/** Pick the widest per-lane state kernel with no more than n lanes, and
+ * return its lane count.  If there is none, *states is NULL and the count is
+ * one: the caller falls back to the single-block transform. */
+static size_t sha256_states_widest(size_t n, transform_states_t* states, int* op)
+{
+        if (transform_states_16way && n >= 16) {
+                *states = transform_states_16way;
+                *op = OP_STATES_16WAY;
+                return 16;
+        }
+        if (transform_states_8way && n >= 8) {
+                *states = transform_states_8way;
+                *op = OP_STATES_8WAY;
+                return 8;
+        }
+        if (transform_states_4way && n >= 4) {
+                *states = transform_states_4way;
+                *op = OP_STATES_4WAY;
+                return 4;
+        }
+        *states = NULL;
+        *op = OP_TRANSFORM;
+        return 1;
+}
+
+/** Finish n messages, message i resuming from the state init[i] after
+ * offset bytes and hashing the shared head before msg[i], as many at a time
+ * as the widest per-lane state kernel allows. */
+static void sha256_lanes_any(struct sha256 out[], const uint32_t* const init[], uint64_t offset, const unsigned char* head, size_t headlen, const void* const msg[], const size_t len[], size_t n)
+{
+        uint32_t s[8 * 16];
+        while (n) {
+                transform_states_t states;
+                int op;
+                size_t i, lanes = sha256_states_widest(n, &states, &op);
+                for (i = 0; i < lanes; ++i) {
+                        memcpy(s + 8 * i, init[i], 8 * sizeof(uint32_t));
+                }
+                if (states) {
+                        sha256_lanes(out, s, offset, head, headlen, msg, len, lanes, lanes, states, op);
+                } else {
+                        struct sha256_ctx ctx;
+                        memcpy(ctx.s, s, sizeof(ctx.s));
+                        ctx.bytes = offset;
+                        if (headlen) {
+                                sha256_absorb(&ctx, head, headlen);
+                        }
+                        sha256_absorb(&ctx, *msg, *len);
+                        sha256_pad(&ctx);
+                        sha256_write(out, ctx.s);
+                }
+                out += lanes;
+                init += lanes;
+                msg += lanes;
+                len += lanes;
+                n -= lanes;
+        }
+}
+
+/* Shared prefixes */
+
+static void sha256_finalize_suffixes_impl(struct sha256 out[], const struct sha256_ctx* prefix, const void* const suffix[], const size_t len[], size_t n)
+{
+        const uint32_t* init[16];
+        size_t i, bufsize = prefix->bytes % 64;
+        STATS_LOCAL
+        for (i = 0; i < 16; ++i) {
+                init[i] = prefix->s;
+        }
+        /* Each lane resumes from the prefix state, completing the buffered
+         * partial block with its own suffix. */
+        while (n) {
+                size_t k = n < 16 ? n : 16;
+                for (i = 0; i < k; ++i) {
+                        STATS_API(SHA256_API_SUFFIXES, len[i]);
+                }
+                sha256_lanes_any(out, init, prefix->bytes - bufsize, prefix->buf.u8, bufsize, suffix, len, k);
+                out += k;
+                suffix += k;
+                len += k;
+                n -= k;
+        }
+}
+
+/* HMAC-SHA256 */
+
+static void sha256_hmac_key_init_impl(struct sha256_hmac_key* key, const void* secret, size_t len)
+{
+        unsigned char block[64];
+        size_t i;
+        STATS_LOCAL
+        assert(key);
+        if (len > 64) {
+                /* Longer keys are replaced by their hash. */
+                struct sha256_ctx ctx;
+                sha256_init(&ctx);
+                sha256_absorb(&ctx, secret, len);
+                sha256_pad(&ctx);
+                for (i = 0; i < 8; ++i) {
+                        WriteBE32(block + 4 * i, ctx.s[i]);
+                }
+                len = 32;
+        } else if (len) {
+                memcpy(block, secret, len);
+        }
+        memset(block + len, 0, 64 - len);
+        for (i = 0; i < 64; ++i) {
+                block[i] ^= 0x36;
+        }
+        Initialize(key->inner);
+        transform(key->inner, block, 1);
+        for (i = 0; i < 64; ++i) {
+                block[i] ^= 0x36 ^ 0x5c;
+        }
+        Initialize(key->outer);
+        transform(key->outer, block, 1);
+        STATS_KERNEL(OP_TRANSFORM, 2);
+}
+
+/** Write the block the outer hash compresses after the key: the inner digest
+ * and the padding for a 96-byte message. */
+static void sha256_hmac_block(unsigned char block[64], const uint32_t s[8])
+{
+        int i;
+        for (i = 0; i < 8; ++i) {
+                WriteBE32(block + 4 * i, s[i]);
+        }
+        block[32] = 0x80;
+        memset(block + 33, 0, 23);
+        WriteBE64(block + 56, 96 << 3);
+}
+
+/** The body of sha256_hmac(), also used internally. */
+static void sha256_hmac_mac(struct sha256* hash, const struct sha256_hmac_key* key, const void* msg, size_t len)
+{
+        struct sha256_ctx ctx;
+        unsigned char block[64];
+        memcpy(ctx.s, key->inner, sizeof(ctx.s));
+        ctx.bytes = 64;
+        sha256_absorb(&ctx, msg, len);
+        sha256_pad(&ctx);
+        sha256_hmac_block(block, ctx.s);
+        sha256_midstate_lanes(hash, key->outer, block, 1);
+}
+
+static void sha256_hmac_impl(struct sha256* hash, const struct sha256_hmac_key* key, const void* msg, size_t len)
+{
+        STATS_LOCAL
+        STATS_API(SHA256_API_HMAC, len);
+        sha256_hmac_mac(hash, key, msg, len);
+}
+
+static void sha256_hmac_batch_impl(struct sha256 out[], const struct sha256_hmac_key* const key[], const void* const msg[], const size_t len[], size_t n)
+{
+        const uint32_t* init[16];
+        const void* inner[16];
+        size_t inner_len[16];
+        struct sha256 digest[16];
+        STATS_LOCAL
+        while (n) {
+                size_t i, k = n < 16 ? n : 16;
+                for (i = 0; i < k; ++i) {
+                        STATS_API(SHA256_API_HMAC, len[i]);
+                        init[i] = key[i]->inner;
+                }
+                sha256_lanes_any(digest, init, 64, NULL, 0, msg, len, k);
+                /* The outer messages are the 32-byte inner digests, each a
+                 * single block. */
+                for (i = 0; i < k; ++i) {
+                        init[i] = key[i]->outer;
+                        inner[i] = digest[i].u8;
+                        inner_len[i] = 32;
+                }
+                sha256_lanes_any(out, init, 64, NULL, 0, inner, inner_len, k);
+                out += k;
+                key += k;
+                msg += k;
+                len += k;
+                n -= k;
+        }
+}
+
+/* BIP340 tagged hashes */
+
+static void sha256_tag_init_impl(struct sha256_tag* tag, const void* name, size_t len)
+{
+        struct sha256_ctx ctx;
+        unsigned char block[64];
+        int i;
+        STATS_LOCAL
+        assert(tag);
+        sha256_init(&ctx);
+        sha256_absorb(&ctx, name, len);
+        sha256_pad(&ctx);
+        for (i = 0; i < 8; ++i) {
+                WriteBE32(block + 4 * i, ctx.s[i]);
+        }
+        memcpy(block + 32, block, 32);
+        Initialize(tag->s);
+        transform(tag->s, block, 1);
+        STATS_KERNEL(OP_TRANSFORM, 1);
+}
+
+static void sha256_tagged_impl(struct sha256* hash, const struct sha256_tag* tag, const void* msg, size_t len)
+{
+        struct sha256_ctx ctx;
+        STATS_LOCAL
+        STATS_API(SHA256_API_TAGGED, len);
+        memcpy(ctx.s, tag->s, sizeof(ctx.s));
+        ctx.bytes = 64;
+        sha256_absorb(&ctx, msg, len);
+        sha256_pad(&ctx);
+        sha256_write(hash, ctx.s);
+}
+
+static void sha256_tagged_batch_impl(struct sha256 out[], const struct sha256_tag* tag, const void* const msg[], const size_t len[], size_t n)
+{
+        const uint32_t* init[16];
+        size_t i;
+        STATS_LOCAL
+        for (i = 0; i < 16; ++i) {
+                init[i] = tag->s;
+        }
+        while (n) {
+                size_t k = n < 16 ? n : 16;
+                for (i = 0; i < k; ++i) {
+                        STATS_API(SHA256_API_TAGGED, len[i]);
+                }
+                sha256_lanes_any(out, init, 64, NULL, 0, msg, len, k);
+                out += k;
+                msg += k;
+                len += k;
+                n -= k;
+        }
+}
+
+/* HKDF-SHA256 */
+
+static void sha256_hkdf_extract_impl(struct sha256* prk, const void* salt, size_t saltlen, const void* ikm, size_t ikmlen)
+{
+        struct sha256_hmac_key key;
+        STATS_LOCAL
+        STATS_API(SHA256_API_HKDF, ikmlen);
+        /* An absent salt is 32 zero bytes, which pad to the same key block
+         * as no bytes at all. */
+        sha256_hmac_key_init_impl(&key, salt, saltlen);
+        sha256_hmac_mac(prk, &key, ikm, ikmlen);
+}
+
+static int sha256_hkdf_expand_impl(unsigned char* out, size_t outlen, const struct sha256_hmac_key* prk, const void* info, size_t infolen)
+{
+        unsigned char inner[64], outer[64];
+        struct sha256 t;
+        uint32_t s[8];
+        size_t i, blocks = (outlen + 31) / 32;
+        STATS_LOCAL
+        if (outlen > 255 * 32) {
+                /* The counter is a single byte. */
+                return -1;
+        }
+        STATS_API(SHA256_API_HKDF, outlen);
+        for (i = 1; i <= blocks; ++i) {
+                /* T(i) is the MAC of T(i - 1), which is empty for i = 1, the
+                 * info and the counter byte i. */
+                size_t prefix = i > 1 ? 32 : 0;
+                size_t len = prefix + infolen + 1;
+                if (len < 56) {
+                        /* The inner message fits one block after the key.
+                         * Its layout changes only from T(1) to T(2), after
+                         * which each step rewrites the leading T(i - 1) and
+                         * the counter. */
+                        if (i <= 2) {
+                                if (infolen) {
+                                        memcpy(inner + prefix, info, infolen);
+                                }
+                                inner[len] = 0x80;
+                                memset(inner + len + 1, 0, 55 - len);
+                                WriteBE64(inner + 56, (64 + len) << 3);
+                        }
+                        if (prefix) {
+                                memcpy(inner, t.u8, 32);
+                        }
+                        inner[len - 1] = (unsigned char)i;
+                        memcpy(s, prk->inner, sizeof(s));
+                        transform(s, inner, 1);
+                        STATS_KERNEL(OP_TRANSFORM, 1);
+                } else {
+                        struct sha256_ctx ctx;
+                        unsigned char counter = (unsigned char)i;
+                        memcpy(ctx.s, prk->inner, sizeof(ctx.s));
+                        ctx.bytes = 64;
+                        if (prefix) {
+                                sha256_absorb(&ctx, t.u8, 32);
+                        }
+                        sha256_absorb(&ctx, info, infolen);
+                        sha256_absorb(&ctx, &counter, 1);
+                        sha256_pad(&ctx);
+                        memcpy(s, ctx.s, sizeof(s));
+                }
+                sha256_hmac_block(outer, s);
+                sha256_midstate_lanes(&t, prk->outer, outer, 1);
+                memcpy(out + 32 * (i - 1), t.u8, outlen - 32 * (i - 1) < 32 ? outlen - 32 * (i - 1) : 32);
+        }
+        return 0;
+}
+
+/* PBKDF2-HMAC-SHA256 */
+
+/** Compute the first iterate of PBKDF2 output block index, counting from one:
+ * the HMAC of the salt followed by the big-endian block index. */
+static void sha256_pbkdf2_first(uint32_t u[8], const struct sha256_hmac_key* key, const void* salt, size_t saltlen, uint32_t index)
+{
+        struct sha256_ctx ctx;
+        unsigned char block[64];
+        STATS_LOCAL
+        memcpy(ctx.s, key->inner, sizeof(ctx.s));
+        ctx.bytes = 64;
+        sha256_absorb(&ctx, salt, saltlen);
+        WriteBE32(block, index);
+        sha256_absorb(&ctx, block, 4);
+        sha256_pad(&ctx);
+        sha256_hmac_block(block, ctx.s);
+        memcpy(u, key->outer, 8 * sizeof(uint32_t));
+        transform(u, block, 1);
+        STATS_KERNEL(OP_TRANSFORM, 1);
+}
+
+/** Run the remaining iterations of up to 16 PBKDF2 output blocks side by
+ * side.  Lane i starts from the first iterate u + 8 * i under key[i], and
+ * leaves the sum of all its iterates in t + 8 * i.  Every HMAC after the first
+ * hashes a 32-byte iterate, so it is exactly one inner and one outer
+ * compression from the key midstates.  Both blocks are 96-byte messages with
+ * the same padding, which is written once; each step only rewrites the
+ * leading digest. */
+static void sha256_pbkdf2_lanes(uint32_t t[8 * 16], const uint32_t u[8 * 16], const struct sha256_hmac_key key[], uint64_t iterations, size_t lanes, transform_states_t states, int op)
+{
+        uint32_t inner[8 * 16], outer[8 * 16], s[8 * 16];
+        unsigned char in[16 * 64];
+        size_t i, j;
+        STATS_LOCAL
+        (void)op;
+        for (i = 0; i < lanes; ++i) {
+                memcpy(inner + 8 * i, key[i].inner, 8 * sizeof(uint32_t));
+                memcpy(outer + 8 * i, key[i].outer, 8 * sizeof(uint32_t));
+                sha256_hmac_block(in + 64 * i, u + 8 * i);
+        }
+        memcpy(t, u, 8 * lanes * sizeof(uint32_t));
+        while (--iterations) {
+                memcpy(s, inner, 8 * lanes * sizeof(uint32_t));
+                if (states) {
+                        states(s, in);
+                } else {
+                        transform(s, in, 1);
+                }
+                STATS_KERNEL(op, lanes);
+                for (i = 0; i < lanes; ++i) {
+                        for (j = 0; j < 8; ++j) {
+                                WriteBE32(in + 64 * i + 4 * j, s[8 * i + j]);
+                        }
+                }
+                memcpy(s, outer, 8 * lanes * sizeof(uint32_t));
+                if (states) {
+                        states(s, in);
+                } else {
+                        transform(s, in, 1);
+                }
+                STATS_KERNEL(op, lanes);
+                for (i = 0; i < lanes; ++i) {
+                        for (j = 0; j < 8; ++j) {
+                                t[8 * i + j] ^= s[8 * i + j];
+                                WriteBE32(in + 64 * i + 4 * j, s[8 * i + j]);
+                        }
+                }
+        }
+}
+
+static int sha256_pbkdf2_batch_impl(unsigned char* const out[], size_t outlen, const void* const password[], const size_t pwlen[], const void* const salt[], const size_t saltlen[], size_t n, uint64_t iterations)
+{
+        struct sha256_hmac_key key[16];
+        uint32_t u[8 * 16], t[8 * 16];
+        struct sha256 block;
+        size_t blocks = (outlen + 31) / 32;
+        size_t i, job = 0;
+        STATS_LOCAL
+        if (!iterations) {
+                /* RFC 8018 requires a positive count, and the lanes would
+                 * count down from zero for 2^64 iterations. */
+                return -1;
+        }
+        if (outlen && (uint64_t)(outlen - 1) / 32 >= 0xffffffff) {
+                /* More than 2^32 - 1 blocks: RFC 8018 calls this "derived
+                 * key too long", and the 32-bit block index would wrap. */
+                return -1;
+        }
+        for (i = 0; i < n; ++i) {
+                STATS_API(SHA256_API_PBKDF2, outlen);
+        }
+        /* Job j is output block j % blocks of password j / blocks.  All jobs
+         * take the same number of iterations, so the lanes never idle. */
+        while (job < n * blocks) {
+                transform_states_t states;
+                int op;
+                size_t lanes = sha256_states_widest(n * blocks - job, &states, &op);
+                for (i = 0; i < lanes; ++i) {
+                        size_t p = (job + i) / blocks;
+                        if (i && (job + i - 1) / blocks == p) {
+                                key[i] = key[i - 1];
+                        } else {
+                                sha256_hmac_key_init_impl(&key[i], password[p], pwlen[p]);
+                        }
+                        sha256_pbkdf2_first(u + 8 * i, &key[i], salt[p], saltlen[p], (uint32_t)((job + i) % blocks + 1));
+                }
+                sha256_pbkdf2_lanes(t, u, key, iterations, lanes, states, op);
+                for (i = 0; i < lanes; ++i) {
+                        size_t p = (job + i) / blocks;
+                        size_t b = (job + i) % blocks;
+                        sha256_write(&block, t + 8 * i);
+                        memcpy(out[p] + 32 * b, block.u8, outlen - 32 * b < 32 ? outlen - 32 * b : 32);
+                }
+                job += lanes;
+        }
+        return 0;
+}
+
+static int sha256_pbkdf2_impl(unsigned char* out, size_t outlen, const void* password, size_t pwlen, const void* salt, size_t saltlen, uint64_t iterations)
+{
+        return sha256_pbkdf2_batch_impl(&out, outlen, &password, &pwlen, &salt, &saltlen, 1, iterations);
+}
+
+/* Dispatch */
+
+/* DISPATCH_INT is the same for entry points that return a status. */
+#if defined(SHA256_BACKEND_PINNED)
+/* There is nothing to detect, so the public entry points simply forward to
+ * their implementations, which the compiler is free to inline. */
+#define DISPATCH(name, params, args)                                          \
+        void name params                                                      \
+        {                                                                     \
+                name##_impl args;                                             \
+        }
+#define DISPATCH_INT(name, params, args)                                      \
+        int name params                                                       \
+        {                                                                     \
+                return name##_impl args;                                      \
+        }
+#else
+/* Each public entry point checks the once-guard, then calls its
+ * implementation, which reaches the kernels through the pointers above. */
+#define DISPATCH(name, params, args)                                          \
+        void name params                                                      \
+        {                                                                     \
+                sha256_init_once();                                           \
+                name##_impl args;                                             \
+        }
+#define DISPATCH_INT(name, params, args)                                      \
+        int name params                                                       \
+        {                                                                     \
+                sha256_init_once();                                           \
+                return name##_impl args;                                      \
+        }
+#endif
+
+DISPATCH(sha256_update, (struct sha256_ctx* ctx, const void* data, size_t len), (ctx, data, len))
+DISPATCH(sha256_done, (struct sha256* hash, struct sha256_ctx* ctx), (hash, ctx))
+DISPATCH(sha256, (struct sha256* hash, const void* data, size_t len), (hash, data, len))
+DISPATCH(sha256d_done, (struct sha256* hash, struct sha256_ctx* ctx), (hash, ctx))
+DISPATCH(sha256d, (struct sha256* hash, const void* data, size_t len), (hash, data, len))
+DISPATCH(sha256_double64, (struct sha256 out[], const struct sha256 in[], size_t blocks), (out, in, blocks))
+DISPATCH(sha256_midstate, (struct sha256 out[], const uint32_t midstate[8], const unsigned char in[], size_t blocks), (out, midstate, in, blocks))
+DISPATCH(sha256_hash64, (struct sha256 out[], const struct sha256 in[], size_t blocks), (out, in, blocks))
+DISPATCH(sha256_finalize_suffixes, (struct sha256 out[], const struct sha256_ctx* prefix, const void* const suffix[], const size_t len[], size_t n), (out, prefix, suffix, len, n))
+DISPATCH(sha224_done, (struct sha224* hash, struct sha256_ctx* ctx), (hash, ctx))
+DISPATCH(sha224, (struct sha224* hash, const void* data, size_t len), (hash, data, len))
+DISPATCH(sha224_batch, (struct sha224 out[], const void* const msg[], const size_t len[], size_t n), (out, msg, len, n))
+DISPATCH(sha256_hmac_key_init, (struct sha256_hmac_key* key, const void* secret, size_t len), (key, secret, len))
+DISPATCH(sha256_hmac, (struct sha256* hash, const struct sha256_hmac_key* key, const void* msg, size_t len), (hash, key, msg, len))
+DISPATCH(sha256_hmac_batch, (struct sha256 out[], const struct sha256_hmac_key* const key[], const void* const msg[], const size_t len[], size_t n), (out, key, msg, len, n))
+DISPATCH(sha256_tag_init, (struct sha256_tag* tag, const void* name, size_t len), (tag, name, len))
+DISPATCH(sha256_tagged, (struct sha256* hash, const struct sha256_tag* tag, const void* msg, size_t len), (hash, tag, msg, len))
+DISPATCH(sha256_tagged_batch, (struct sha256 out[], const struct sha256_tag* tag, const void* const msg[], const size_t len[], size_t n), (out, tag, msg, len, n))
+DISPATCH(sha256_hkdf_extract, (struct sha256* prk, const void* salt, size_t saltlen, const void* ikm, size_t ikmlen), (prk, salt, saltlen, ikm, ikmlen))
+DISPATCH_INT(sha256_hkdf_expand, (unsigned char* out, size_t outlen, const struct sha256_hmac_key* prk, const void* info, size_t infolen), (out, outlen, prk, info, infolen))
+DISPATCH_INT(sha256_pbkdf2, (unsigned char* out, size_t outlen, const void* password, size_t pwlen, const void* salt, size_t saltlen, uint64_t iterations), (out, outlen, password, pwlen, salt, saltlen, iterations))
+DISPATCH_INT(sha256_pbkdf2_batch, (unsigned char* const out[], size_t outlen, const void* const password[], const size_t pwlen[], const void* const salt[], const size_t saltlen[], size_t n, uint64_t iterations), (out, outlen, password, pwlen, salt, saltlen, n, iterations))
+
 /* End of File
  */
@@ -920,6 +920,181 @@ void transform_sha256d64_armv8_2way(struct sha256 out[2], const struct sha256 in
         vst1q_u8(&out[1].u8[16], vrev32q_u8(vreinterpretq_u8_u32(STATE1B)));
 }
 
+void transform_sha256d32_armv8(struct sha256 out[1], const uint32_t in[8])
+{
+        /* Initial state. */
+        static const __attribute__((aligned (16))) uint32_t INIT[8] = {
+                0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+        };
+
+        /* A few precomputed message schedule values. */
+        static const __attribute__((aligned (16))) uint32_t FINS[12] = {
+                0x5807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+                0x80000000, 0x00000000, 0x00000000, 0x00000000,
+                0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf274
+        };
+
+        /* Padding of a 32-byte message (byteswapped). */
+        static const __attribute__((aligned (16))) uint32_t FINAL[8] = {0x80000000, 0, 0, 0, 0, 0, 0, 0x100};
+
+        uint32x4_t STATE0, STATE1, MSG0, MSG1, MSG2, MSG3, TMP0, TMP2, TMP;
+
+        /* Load the digest words, which are already in host order */
+        MSG0 = vld1q_u32(&in[0]);
+        MSG1 = vld1q_u32(&in[4]);
+        MSG2 = vld1q_u32(&FINAL[0]);
+        MSG3 = vld1q_u32(&FINAL[4]);
+
+        /* Load state */
+        STATE0 = vld1q_u32(&INIT[0]);
+        STATE1 = vld1q_u32(&INIT[4]);
+
+        /* Rounds 1-4 */
+        TMP = vld1q_u32(&K[0]);
+        TMP0 = vaddq_u32(MSG0, TMP);
+        TMP2 = STATE0;
+        MSG0 = vsha256su0q_u32(MSG0, MSG1);
+        STATE0 = vsha256hq_u32(STATE0, STATE1, TMP0);
+        STATE1 = vsha256h2q_u32(STATE1, TMP2, TMP0);
+        MSG0 = vsha256su1q_u32(MSG0, MSG2, MSG3);
+
+        /* Rounds 5-8 */
+        TMP = vld1q_u32(&K[4]);
+        TMP0 = vaddq_u32(MSG1, TMP);
+        TMP2 = STATE0;
+        MSG1 = vsha256su0q_u32(MSG1, MSG2);
+        STATE0 = vsha256hq_u32(STATE0, STATE1, TMP0);
+        STATE1 = vsha256h2q_u32(STATE1, TMP2, TMP0);
+        MSG1 = vsha256su1q_u32(MSG1, MSG3, MSG0);
+
+        /* Rounds 9-12 */
+        TMP = vld1q_u32(&FINS[0]);
+        TMP2 = STATE0;
+        MSG2 = vld1q_u32(&FINS[4]);
+        STATE0 = vsha256hq_u32(STATE0, STATE1, TMP);
+        STATE1 = vsha256h2q_u32(STATE1, TMP2, TMP);
+        MSG2 = vsha256su1q_u32(MSG2, MSG0, MSG1);
+
+        /* Rounds 13-16 */
+        TMP = vld1q_u32(&FINS[8]);
+        TMP2 = STATE0;
+        MSG3 = vsha256su0q_u32(MSG3, MSG0);
+        STATE0 = vsha256hq_u32(STATE0, STATE1, TMP);
+        STATE1 = vsha256h2q_u32(STATE1, TMP2, TMP);
+        MSG3 = vsha256su1q_u32(MSG3, MSG1, MSG2);
+
+        /* Rounds 17-20 */
+        TMP = vld1q_u32(&K[16]);
+        TMP0 = vaddq_u32(MSG0, TMP);
+        TMP2 = STATE0;
+        MSG0 = vsha256su0q_u32(MSG0, MSG1);
+        STATE0 = vsha256hq_u32(STATE0, STATE1, TMP0);
+        STATE1 = vsha256h2q_u32(STATE1, TMP2, TMP0);
+        MSG0 = vsha256su1q_u32(MSG0, MSG2, MSG3);
+
+        /* Rounds 21-24 */
+        TMP = vld1q_u32(&K[20]);
+        TMP0 = vaddq_u32(MSG1, TMP);
+        TMP2 = STATE0;
+        MSG1 = vsha256su0q_u32(MSG1, MSG2);
+        STATE0 = vsha256hq_u32(STATE0, STATE1, TMP0);
+        STATE1 = vsha256h2q_u32(STATE1, TMP2, TMP0);
+        MSG1 = vsha256su1q_u32(MSG1, MSG3, MSG0);
+
+        /* Rounds 25-28 */
+        TMP = vld1q_u32(&K[24]);
+        TMP0 = vaddq_u32(MSG2, TMP);
+        TMP2 = STATE0;
+        MSG2 = vsha256su0q_u32(MSG2, MSG3);
+        STATE0 = vsha256hq_u32(STATE0, STATE1, TMP0);
+        STATE1 = vsha256h2q_u32(STATE1, TMP2, TMP0);
+        MSG2 = vsha256su1q_u32(MSG2, MSG0, MSG1);
+
+        /* Rounds 29-32 */
+        TMP = vld1q_u32(&K[28]);
+        TMP0 = vaddq_u32(MSG3, TMP);
+        TMP2 = STATE0;
+        MSG3 = vsha256su0q_u32(MSG3, MSG0);
+        STATE0 = vsha256hq_u32(STATE0, STATE1, TMP0);
+        STATE1 = vsha256h2q_u32(STATE1, TMP2, TMP0);
+        MSG3 = vsha256su1q_u32(MSG3, MSG1, MSG2);
+
+        /* Rounds 33-36 */
+        TMP = vld1q_u32(&K[32]);
+        TMP0 = vaddq_u32(MSG0, TMP);
+        TMP2 = STATE0;
+        MSG0 = vsha256su0q_u32(MSG0, MSG1);
+        STATE0 = vsha256hq_u32(STATE0, STATE1, TMP0);
+        STATE1 = vsha256h2q_u32(STATE1, TMP2, TMP0);
+        MSG0 = vsha256su1q_u32(MSG0, MSG2, MSG3);
+
+        /* Rounds 37-40 */
+        TMP = vld1q_u32(&K[36]);
+        TMP0 = vaddq_u32(MSG1, TMP);
+        TMP2 = STATE0;
+        MSG1 = vsha256su0q_u32(MSG1, MSG2);
+        STATE0 = vsha256hq_u32(STATE0, STATE1, TMP0);
+        STATE1 = vsha256h2q_u32(STATE1, TMP2, TMP0);
+        MSG1 = vsha256su1q_u32(MSG1, MSG3, MSG0);
+
+        /* Rounds 41-44 */
+        TMP = vld1q_u32(&K[40]);
+        TMP0 = vaddq_u32(MSG2, TMP);
+        TMP2 = STATE0;
+        MSG2 = vsha256su0q_u32(MSG2, MSG3);
+        STATE0 = vsha256hq_u32(STATE0, STATE1, TMP0);
+        STATE1 = vsha256h2q_u32(STATE1, TMP2, TMP0);
+        MSG2 = vsha256su1q_u32(MSG2, MSG0, MSG1);
+
+        /* Rounds 45-48 */
+        TMP = vld1q_u32(&K[44]);
+        TMP0 = vaddq_u32(MSG3, TMP);
+        TMP2 = STATE0;
+        MSG3 = vsha256su0q_u32(MSG3, MSG0);
+        STATE0 = vsha256hq_u32(STATE0, STATE1, TMP0);
+        STATE1 = vsha256h2q_u32(STATE1, TMP2, TMP0);
+        MSG3 = vsha256su1q_u32(MSG3, MSG1, MSG2);
+
+        /* Rounds 49-52 */
+        TMP = vld1q_u32(&K[48]);
+        TMP0 = vaddq_u32(MSG0, TMP);
+        TMP2 = STATE0;
+        STATE0 = vsha256hq_u32(STATE0, STATE1, TMP0);
+        STATE1 = vsha256h2q_u32(STATE1, TMP2, TMP0);
+
+        /* Rounds 53-56 */
+        TMP = vld1q_u32(&K[52]);
+        TMP0 = vaddq_u32(MSG1, TMP);
+        TMP2 = STATE0;
+        STATE0 = vsha256hq_u32(STATE0, STATE1, TMP0);
+        STATE1 = vsha256h2q_u32(STATE1, TMP2, TMP0);
+
+        /* Rounds 57-60 */
+        TMP = vld1q_u32(&K[56]);
+        TMP0 = vaddq_u32(MSG2, TMP);
+        TMP2 = STATE0;
+        STATE0 = vsha256hq_u32(STATE0, STATE1, TMP0);
+        STATE1 = vsha256h2q_u32(STATE1, TMP2, TMP0);
+
+        /* Rounds 61-64 */
+        TMP = vld1q_u32(&K[60]);
+        TMP0 = vaddq_u32(MSG3, TMP);
+        TMP2 = STATE0;
+        STATE0 = vsha256hq_u32(STATE0, STATE1, TMP0);
+        STATE1 = vsha256h2q_u32(STATE1, TMP2, TMP0);
+
+        /* Update state */
+        TMP = vld1q_u32(&INIT[0]);
+        STATE0 = vaddq_u32(STATE0, TMP);
+        TMP = vld1q_u32(&INIT[4]);
+        STATE1 = vaddq_u32(STATE1, TMP);
+
+        /* Store result */
+        vst1q_u8(&out[0].u8[0], vrev32q_u8(vreinterpretq_u8_u32(STATE0)));
+        vst1q_u8(&out[0].u8[16], vrev32q_u8(vreinterpretq_u8_u32(STATE1)));
+}
+
 #else
 /* -Wempty-translation-unit
  * ISO C requires a translation unit to contain at least one declaration
@@ -0,0 +1,97 @@
+/* Copyright (c) 2018-2019 The Bitcoin Core developers
+ * Copyright (c) 2022 Mark Friedenbach
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#if (defined(__x86_64__) || defined(__amd64__)) && defined(__AVX512F__)
+
+#include <sha2/sha256.h>
+#include "sha256_internal.h"
+
+#include <stdint.h> /* for uint32_t */
+#include <immintrin.h> /* for assembly intrinsics */
+
+#include "common.h"
+
+/* Only AVX-512F is assumed.  Rotations and the three-input boolean functions
+ * each take a single instruction, and the sixteen lanes are read and written
+ * with a gather and a scatter at a stride of one block or one digest. */
+
+#define VEC __m512i
+#define NWAY_LANES 16
+#define NWAY_SUFFIX avx512
+#define NWAY_MULTI transform_sha256multi_avx512_16way
+#define NWAY_D64 transform_sha256d64_avx512_16way
+#define NWAY_H64 transform_sha256h64_avx512_16way
+#define NWAY_STATES transform_sha256states_avx512_16way
+#define K(x) _mm512_set1_epi32(x)
+#define Add(x, y) _mm512_add_epi32((x), (y))
+#define Xor(x, y) _mm512_xor_si512((x), (y))
+#define Or(x, y) _mm512_or_si512((x), (y))
+#define And(x, y) _mm512_and_si512((x), (y))
+#define ShR(x, n) _mm512_srli_epi32((x), (n))
+#define ShL(x, n) _mm512_slli_epi32((x), (n))
+#define Rotr(x, n) _mm512_ror_epi32((x), (n))
+#define Xor3(x, y, z) _mm512_ternarylogic_epi32((x), (y), (z), 0x96)
+#define Ch(x, y, z) _mm512_ternarylogic_epi32((x), (y), (z), 0xca)
+#define Maj(x, y, z) _mm512_ternarylogic_epi32((x), (y), (z), 0xe8)
+#define ReadN Read16
+#define WriteN Write16
+#define LoadN Load16
+#define StoreN Store16
+
+/** Reverse the bytes of each lane, without needing AVX-512BW's vpshufb. */
+static inline __attribute__((always_inline)) __m512i ByteSwap16(__m512i v)
+{
+        return _mm512_ternarylogic_epi32(
+                _mm512_rol_epi32(v, 8),
+                _mm512_ror_epi32(v, 8),
+                _mm512_set1_epi32(0x00FF00FFUL), 0xe4);
+}
+
+static inline __attribute__((always_inline)) __m512i Read16(const unsigned char* chunk)
+{
+        const __m512i offsets = _mm512_set_epi32(
+                960, 896, 832, 768, 704, 640, 576, 512,
+                448, 384, 320, 256, 192, 128, 64, 0);
+        return ByteSwap16(_mm512_i32gather_epi32(offsets, chunk, 1));
+}
+
+static inline __attribute__((always_inline)) void Write16(unsigned char *out, __m512i v)
+{
+        const __m512i offsets = _mm512_set_epi32(
+                480, 448, 416, 384, 352, 320, 288, 256,
+                224, 192, 160, 128, 96, 64, 32, 0);
+        _mm512_i32scatter_epi32(out, offsets, ByteSwap16(v), 1);
+}
+
+static inline __attribute__((always_inline)) __m512i Load16(const uint32_t* s, int j)
+{
+        const __m512i index = _mm512_set_epi32(
+                120, 112, 104, 96, 88, 80, 72, 64,
+                56, 48, 40, 32, 24, 16, 8, 0);
+        return _mm512_i32gather_epi32(index, s + j, 4);
+}
+
+static inline __attribute__((always_inline)) void Store16(uint32_t* s, int j, __m512i v)
+{
+        const __m512i index = _mm512_set_epi32(
+                120, 112, 104, 96, 88, 80, 72, 64,
+                56, 48, 40, 32, 24, 16, 8, 0);
+        _mm512_i32scatter_epi32(s + j, index, v, 4);
+}
+
+#include "sha256_nway.h"
+
+#else
+/* -Wempty-translation-unit
+ * ISO C requires a translation unit to contain at least one declaration
+ */
+typedef int make_iso_compilers_happy;
+#endif
+
+/* End of File
+ */
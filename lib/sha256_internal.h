@@ -13,19 +13,43 @@
 
 #if defined(__x86_64__) || defined(__amd64__) || defined(__i386__)
 extern void transform_sha256_sse4(uint32_t* s, const unsigned char* chunk, size_t blocks);
+extern void transform_sha256ks_sse4(uint32_t* s, const uint32_t* ks);
 
 extern void transform_sha256multi_sse41_4way(struct sha256* out, const uint32_t* s, const unsigned char* in);
 extern void transform_sha256d64_sse41_4way(struct sha256 out[4], const struct sha256 in[8]);
+extern void transform_sha256h64_sse41_4way(struct sha256 out[4], const struct sha256 in[8]);
+extern void transform_sha256states_sse41_4way(uint32_t s[32], const unsigned char in[256]);
 
 extern void transform_sha256multi_avx2_8way(struct sha256* out, const uint32_t* s, const unsigned char* in);
 extern void transform_sha256d64_avx2_8way(struct sha256 out[8], const struct sha256 in[16]);
+extern void transform_sha256h64_avx2_8way(struct sha256 out[8], const struct sha256 in[16]);
+extern void transform_sha256states_avx2_8way(uint32_t s[64], const unsigned char in[512]);
+
+extern void transform_sha256multi_avx512_16way(struct sha256* out, const uint32_t* s, const unsigned char* in);
+extern void transform_sha256d64_avx512_16way(struct sha256 out[16], const struct sha256 in[32]);
+extern void transform_sha256h64_avx512_16way(struct sha256 out[16], const struct sha256 in[32]);
+extern void transform_sha256states_avx512_16way(uint32_t s[128], const unsigned char in[1024]);
 
 extern void transform_sha256_shani(uint32_t* s, const unsigned char* chunk, size_t blocks);
 extern void transform_sha256d64_shani_2way(struct sha256 out[2], const struct sha256 in[4]);
+extern void transform_sha256d32_shani(struct sha256 out[1], const uint32_t in[8]);
+extern void transform_sha256ks_shani(uint32_t* s, const uint32_t* ks);
 #endif
 #if defined(__arm__) || defined(__aarch32__) || defined(__arm64__) || defined(__aarch64__) || defined(_M_ARM)
 extern void transform_sha256_armv8(uint32_t* s, const unsigned char* chunk, size_t blocks);
 extern void transform_sha256d64_armv8_2way(struct sha256 out[2], const struct sha256 in[4]);
+extern void transform_sha256d32_armv8(struct sha256 out[1], const uint32_t in[8]);
+#endif
+
+#if defined(__GNUC__)
+extern void transform_sha256multi_vec_4way(struct sha256* out, const uint32_t* s, const unsigned char* in);
+extern void transform_sha256d64_vec_4way(struct sha256 out[4], const struct sha256 in[8]);
+extern void transform_sha256h64_vec_4way(struct sha256 out[4], const struct sha256 in[8]);
+extern void transform_sha256states_vec_4way(uint32_t s[32], const unsigned char in[256]);
+extern void transform_sha256multi_vec_8way(struct sha256* out, const uint32_t* s, const unsigned char* in);
+extern void transform_sha256d64_vec_8way(struct sha256 out[8], const struct sha256 in[16]);
+extern void transform_sha256h64_vec_8way(struct sha256 out[8], const struct sha256 in[16]);
+extern void transform_sha256states_vec_8way(uint32_t s[64], const unsigned char in[512]);
 #endif
 
 #endif /* SHA2__SHA256_INTERNAL_H */
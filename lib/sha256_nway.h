@@ -0,0 +1,647 @@
+/* Copyright (c) 2018-2019 The Bitcoin Core developers
+ * Copyright (c) 2022 Mark Friedenbach
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/* Multi-lane SHA-256 kernels, written once for any vector width.  This file
+ * has no include guard: it is included once per instruction set and lane
+ * count, after defining
+ *
+ *   VEC          a vector of 32-bit lanes
+ *   NWAY_LANES   the number of lanes in VEC
+ *   NWAY_SUFFIX  a token that makes the helper function names unique
+ *   NWAY_MULTI   the name of the midstate kernel to define
+ *   NWAY_D64     the name of the double-SHA256 kernel to define
+ *   NWAY_H64     the name of the single-SHA256 kernel to define
+ *   NWAY_STATES  the name of the per-lane state kernel to define
+ *   K(x)         a vector with every lane set to x
+ *   Add(x, y), Xor(x, y), Or(x, y), And(x, y)
+ *   ShR(x, n), ShL(x, n)  per-lane shifts by a constant
+ *   ReadN(p)     load big-endian words p, p + 64, p + 128, ... into the lanes
+ *   WriteN(p, v) store the lanes big-endian at p, p + 32, p + 64, ...
+ *   LoadN(s, j)  load the words s[j], s[8 + j], s[16 + j], ... into the lanes
+ *   StoreN(s, j, v)  store the lanes back to the same words
+ *
+ * and optionally Rotr(x, n), Xor3(x, y, z), Ch(x, y, z) and Maj(x, y, z), for
+ * instruction sets with a faster way to compute them than the shift and
+ * bitwise defaults below.
+ *
+ * Lane i of NWAY_MULTI hashes the 64-byte block at in + 64 * i from the
+ * midstate s.  Lane i of NWAY_D64 and NWAY_H64 hashes the 64-byte message
+ * in[2 * i], in[2 * i + 1], twice or once.  Lane i of NWAY_STATES compresses
+ * the block at in + 64 * i into the state s + 8 * i, so unlike NWAY_MULTI
+ * each lane may be at a different point of a different message.  The lanes
+ * of ReadN, WriteN, LoadN and StoreN must be in the same order.  All of the
+ * above except VEC, NWAY_LANES and NWAY_SUFFIX are undefined again at the
+ * end.
+ */
+
+#define NWAY_CAT2(a, b) a##_##b
+#define NWAY_CAT(a, b) NWAY_CAT2(a, b)
+#define NWAY_FN(name) NWAY_CAT(name, NWAY_SUFFIX)
+
+#define Inc NWAY_FN(Inc)
+#define Inc3 NWAY_FN(Inc3)
+#define Inc4 NWAY_FN(Inc4)
+#define Sigma0 NWAY_FN(Sigma0)
+#define Sigma1 NWAY_FN(Sigma1)
+#define sigma0 NWAY_FN(sigma0)
+#define sigma1 NWAY_FN(sigma1)
+#define Round NWAY_FN(Round)
+#define Hash64 NWAY_FN(Hash64)
+
+#define Add3(x, y, z) Add(Add((x), (y)), (z))
+#define Add4(x, y, z, w) Add(Add((x), (y)), Add((z), (w)))
+#define Add5(x, y, z, w, v) Add(Add3((x), (y), (z)), Add((w), (v)))
+static inline __attribute__((always_inline)) VEC Inc(VEC *x, VEC y) { *x = Add(*x, y); return *x; }
+static inline __attribute__((always_inline)) VEC Inc3(VEC *x, VEC y, VEC z) { *x = Add3(*x, y, z); return *x; }
+static inline __attribute__((always_inline)) VEC Inc4(VEC *x, VEC y, VEC z, VEC w) { *x = Add4(*x, y, z, w); return *x; }
+#if !defined(Xor3)
+#define Xor3(x, y, z) Xor(Xor((x), (y)), (z))
+#endif
+#if !defined(Rotr)
+#define Rotr(x, n) Or(ShR((x), (n)), ShL((x), 32 - (n)))
+#endif
+
+#if !defined(Ch)
+#define Ch NWAY_FN(Ch)
+static inline __attribute__((always_inline)) VEC Ch(VEC x, VEC y, VEC z) { return Xor(z, And(x, Xor(y, z))); }
+#endif
+#if !defined(Maj)
+#define Maj NWAY_FN(Maj)
+static inline __attribute__((always_inline)) VEC Maj(VEC x, VEC y, VEC z) { return Or(And(x, y), And(z, Or(x, y))); }
+#endif
+static inline __attribute__((always_inline)) VEC Sigma0(VEC x) { return Xor3(Rotr(x, 2), Rotr(x, 13), Rotr(x, 22)); }
+static inline __attribute__((always_inline)) VEC Sigma1(VEC x) { return Xor3(Rotr(x, 6), Rotr(x, 11), Rotr(x, 25)); }
+static inline __attribute__((always_inline)) VEC sigma0(VEC x) { return Xor3(Rotr(x, 7), Rotr(x, 18), ShR(x, 3)); }
+static inline __attribute__((always_inline)) VEC sigma1(VEC x) { return Xor3(Rotr(x, 17), Rotr(x, 19), ShR(x, 10)); }
+
+/** One round of SHA-256. */
+static inline __attribute__((always_inline)) void Round(VEC a, VEC b, VEC c, VEC *d, VEC e, VEC f, VEC g, VEC *h, VEC k)
+{
+        VEC t1 = Add4(*h, Sigma1(e), Ch(e, f, g), k);
+        VEC t2 = Add(Sigma0(a), Maj(a, b, c));
+        *d = Add(*d, t1);
+        *h = Add(t1, t2);
+}
+
+void NWAY_MULTI(struct sha256* out, const uint32_t* s, const unsigned char* in)
+{
+        /* Transform 1 */
+        VEC a = K(s[0]);
+        VEC b = K(s[1]);
+        VEC c = K(s[2]);
+        VEC d = K(s[3]);
+        VEC e = K(s[4]);
+        VEC f = K(s[5]);
+        VEC g = K(s[6]);
+        VEC h = K(s[7]);
+
+        VEC w0 = ReadN(in + 0),
+                w1 = ReadN(in + 4),
+                w2 = ReadN(in + 8),
+                w3 = ReadN(in + 12),
+                w4 = ReadN(in + 16),
+                w5 = ReadN(in + 20),
+                w6 = ReadN(in + 24),
+                w7 = ReadN(in + 28),
+                w8 = ReadN(in + 32),
+                w9 = ReadN(in + 36),
+                w10 = ReadN(in + 40),
+                w11 = ReadN(in + 44),
+                w12 = ReadN(in + 48),
+                w13 = ReadN(in + 52),
+                w14 = ReadN(in + 56),
+                w15 = ReadN(in + 60);
+
+        Round(a, b, c, &d, e, f, g, &h, Add(K(0x428a2f98ul), w0));
+        Round(h, a, b, &c, d, e, f, &g, Add(K(0x71374491ul), w1));
+        Round(g, h, a, &b, c, d, e, &f, Add(K(0xb5c0fbcful), w2));
+        Round(f, g, h, &a, b, c, d, &e, Add(K(0xe9b5dba5ul), w3));
+        Round(e, f, g, &h, a, b, c, &d, Add(K(0x3956c25bul), w4));
+        Round(d, e, f, &g, h, a, b, &c, Add(K(0x59f111f1ul), w5));
+        Round(c, d, e, &f, g, h, a, &b, Add(K(0x923f82a4ul), w6));
+        Round(b, c, d, &e, f, g, h, &a, Add(K(0xab1c5ed5ul), w7));
+        Round(a, b, c, &d, e, f, g, &h, Add(K(0xd807aa98ul), w8));
+        Round(h, a, b, &c, d, e, f, &g, Add(K(0x12835b01ul), w9));
+        Round(g, h, a, &b, c, d, e, &f, Add(K(0x243185beul), w10));
+        Round(f, g, h, &a, b, c, d, &e, Add(K(0x550c7dc3ul), w11));
+        Round(e, f, g, &h, a, b, c, &d, Add(K(0x72be5d74ul), w12));
+        Round(d, e, f, &g, h, a, b, &c, Add(K(0x80deb1feul), w13));
+        Round(c, d, e, &f, g, h, a, &b, Add(K(0x9bdc06a7ul), w14));
+        Round(b, c, d, &e, f, g, h, &a, Add(K(0xc19bf174ul), w15));
+        Round(a, b, c, &d, e, f, g, &h, Add(K(0xe49b69c1ul), Inc4(&w0, sigma1(w14), w9, sigma0(w1))));
+        Round(h, a, b, &c, d, e, f, &g, Add(K(0xefbe4786ul), Inc4(&w1, sigma1(w15), w10, sigma0(w2))));
+        Round(g, h, a, &b, c, d, e, &f, Add(K(0x0fc19dc6ul), Inc4(&w2, sigma1(w0), w11, sigma0(w3))));
+        Round(f, g, h, &a, b, c, d, &e, Add(K(0x240ca1ccul), Inc4(&w3, sigma1(w1), w12, sigma0(w4))));
+        Round(e, f, g, &h, a, b, c, &d, Add(K(0x2de92c6ful), Inc4(&w4, sigma1(w2), w13, sigma0(w5))));
+        Round(d, e, f, &g, h, a, b, &c, Add(K(0x4a7484aaul), Inc4(&w5, sigma1(w3), w14, sigma0(w6))));
+        Round(c, d, e, &f, g, h, a, &b, Add(K(0x5cb0a9dcul), Inc4(&w6, sigma1(w4), w15, sigma0(w7))));
+        Round(b, c, d, &e, f, g, h, &a, Add(K(0x76f988daul), Inc4(&w7, sigma1(w5), w0, sigma0(w8))));
+        Round(a, b, c, &d, e, f, g, &h, Add(K(0x983e5152ul), Inc4(&w8, sigma1(w6), w1, sigma0(w9))));
+        Round(h, a, b, &c, d, e, f, &g, Add(K(0xa831c66dul), Inc4(&w9, sigma1(w7), w2, sigma0(w10))));
+        Round(g, h, a, &b, c, d, e, &f, Add(K(0xb00327c8ul), Inc4(&w10, sigma1(w8), w3, sigma0(w11))));
+        Round(f, g, h, &a, b, c, d, &e, Add(K(0xbf597fc7ul), Inc4(&w11, sigma1(w9), w4, sigma0(w12))));
+        Round(e, f, g, &h, a, b, c, &d, Add(K(0xc6e00bf3ul), Inc4(&w12, sigma1(w10), w5, sigma0(w13))));
+        Round(d, e, f, &g, h, a, b, &c, Add(K(0xd5a79147ul), Inc4(&w13, sigma1(w11), w6, sigma0(w14))));
+        Round(c, d, e, &f, g, h, a, &b, Add(K(0x06ca6351ul), Inc4(&w14, sigma1(w12), w7, sigma0(w15))));
+        Round(b, c, d, &e, f, g, h, &a, Add(K(0x14292967ul), Inc4(&w15, sigma1(w13), w8, sigma0(w0))));
+        Round(a, b, c, &d, e, f, g, &h, Add(K(0x27b70a85ul), Inc4(&w0, sigma1(w14), w9, sigma0(w1))));
+        Round(h, a, b, &c, d, e, f, &g, Add(K(0x2e1b2138ul), Inc4(&w1, sigma1(w15), w10, sigma0(w2))));
+        Round(g, h, a, &b, c, d, e, &f, Add(K(0x4d2c6dfcul), Inc4(&w2, sigma1(w0), w11, sigma0(w3))));
+        Round(f, g, h, &a, b, c, d, &e, Add(K(0x53380d13ul), Inc4(&w3, sigma1(w1), w12, sigma0(w4))));
+        Round(e, f, g, &h, a, b, c, &d, Add(K(0x650a7354ul), Inc4(&w4, sigma1(w2), w13, sigma0(w5))));
+        Round(d, e, f, &g, h, a, b, &c, Add(K(0x766a0abbul), Inc4(&w5, sigma1(w3), w14, sigma0(w6))));
+        Round(c, d, e, &f, g, h, a, &b, Add(K(0x81c2c92eul), Inc4(&w6, sigma1(w4), w15, sigma0(w7))));
+        Round(b, c, d, &e, f, g, h, &a, Add(K(0x92722c85ul), Inc4(&w7, sigma1(w5), w0, sigma0(w8))));
+        Round(a, b, c, &d, e, f, g, &h, Add(K(0xa2bfe8a1ul), Inc4(&w8, sigma1(w6), w1, sigma0(w9))));
+        Round(h, a, b, &c, d, e, f, &g, Add(K(0xa81a664bul), Inc4(&w9, sigma1(w7), w2, sigma0(w10))));
+        Round(g, h, a, &b, c, d, e, &f, Add(K(0xc24b8b70ul), Inc4(&w10, sigma1(w8), w3, sigma0(w11))));
+        Round(f, g, h, &a, b, c, d, &e, Add(K(0xc76c51a3ul), Inc4(&w11, sigma1(w9), w4, sigma0(w12))));
+        Round(e, f, g, &h, a, b, c, &d, Add(K(0xd192e819ul), Inc4(&w12, sigma1(w10), w5, sigma0(w13))));
+        Round(d, e, f, &g, h, a, b, &c, Add(K(0xd6990624ul), Inc4(&w13, sigma1(w11), w6, sigma0(w14))));
+        Round(c, d, e, &f, g, h, a, &b, Add(K(0xf40e3585ul), Inc4(&w14, sigma1(w12), w7, sigma0(w15))));
+        Round(b, c, d, &e, f, g, h, &a, Add(K(0x106aa070ul), Inc4(&w15, sigma1(w13), w8, sigma0(w0))));
+        Round(a, b, c, &d, e, f, g, &h, Add(K(0x19a4c116ul), Inc4(&w0, sigma1(w14), w9, sigma0(w1))));
+        Round(h, a, b, &c, d, e, f, &g, Add(K(0x1e376c08ul), Inc4(&w1, sigma1(w15), w10, sigma0(w2))));
+        Round(g, h, a, &b, c, d, e, &f, Add(K(0x2748774cul), Inc4(&w2, sigma1(w0), w11, sigma0(w3))));
+        Round(f, g, h, &a, b, c, d, &e, Add(K(0x34b0bcb5ul), Inc4(&w3, sigma1(w1), w12, sigma0(w4))));
+        Round(e, f, g, &h, a, b, c, &d, Add(K(0x391c0cb3ul), Inc4(&w4, sigma1(w2), w13, sigma0(w5))));
+        Round(d, e, f, &g, h, a, b, &c, Add(K(0x4ed8aa4aul), Inc4(&w5, sigma1(w3), w14, sigma0(w6))));
+        Round(c, d, e, &f, g, h, a, &b, Add(K(0x5b9cca4ful), Inc4(&w6, sigma1(w4), w15, sigma0(w7))));
+        Round(b, c, d, &e, f, g, h, &a, Add(K(0x682e6ff3ul), Inc4(&w7, sigma1(w5), w0, sigma0(w8))));
+        Round(a, b, c, &d, e, f, g, &h, Add(K(0x748f82eeul), Inc4(&w8, sigma1(w6), w1, sigma0(w9))));
+        Round(h, a, b, &c, d, e, f, &g, Add(K(0x78a5636ful), Inc4(&w9, sigma1(w7), w2, sigma0(w10))));
+        Round(g, h, a, &b, c, d, e, &f, Add(K(0x84c87814ul), Inc4(&w10, sigma1(w8), w3, sigma0(w11))));
+        Round(f, g, h, &a, b, c, d, &e, Add(K(0x8cc70208ul), Inc4(&w11, sigma1(w9), w4, sigma0(w12))));
+        Round(e, f, g, &h, a, b, c, &d, Add(K(0x90befffaul), Inc4(&w12, sigma1(w10), w5, sigma0(w13))));
+        Round(d, e, f, &g, h, a, b, &c, Add(K(0xa4506cebul), Inc4(&w13, sigma1(w11), w6, sigma0(w14))));
+        Round(c, d, e, &f, g, h, a, &b, Add(K(0xbef9a3f7ul), Inc4(&w14, sigma1(w12), w7, sigma0(w15))));
+        Round(b, c, d, &e, f, g, h, &a, Add(K(0xc67178f2ul), Inc4(&w15, sigma1(w13), w8, sigma0(w0))));
+
+        /* Output */
+        WriteN(&out->u8[0], Add(a, K(s[0])));
+        WriteN(&out->u8[4], Add(b, K(s[1])));
+        WriteN(&out->u8[8], Add(c, K(s[2])));
+        WriteN(&out->u8[12], Add(d, K(s[3])));
+        WriteN(&out->u8[16], Add(e, K(s[4])));
+        WriteN(&out->u8[20], Add(f, K(s[5])));
+        WriteN(&out->u8[24], Add(g, K(s[6])));
+        WriteN(&out->u8[28], Add(h, K(s[7])));
+}
+
+void NWAY_STATES(uint32_t s[8 * NWAY_LANES], const unsigned char in[64 * NWAY_LANES])
+{
+        VEC a = LoadN(s, 0);
+        VEC b = LoadN(s, 1);
+        VEC c = LoadN(s, 2);
+        VEC d = LoadN(s, 3);
+        VEC e = LoadN(s, 4);
+        VEC f = LoadN(s, 5);
+        VEC g = LoadN(s, 6);
+        VEC h = LoadN(s, 7);
+
+        VEC w0 = ReadN(in + 0),
+                w1 = ReadN(in + 4),
+                w2 = ReadN(in + 8),
+                w3 = ReadN(in + 12),
+                w4 = ReadN(in + 16),
+                w5 = ReadN(in + 20),
+                w6 = ReadN(in + 24),
+                w7 = ReadN(in + 28),
+                w8 = ReadN(in + 32),
+                w9 = ReadN(in + 36),
+                w10 = ReadN(in + 40),
+                w11 = ReadN(in + 44),
+                w12 = ReadN(in + 48),
+                w13 = ReadN(in + 52),
+                w14 = ReadN(in + 56),
+                w15 = ReadN(in + 60);
+
+        Round(a, b, c, &d, e, f, g, &h, Add(K(0x428a2f98ul), w0));
+        Round(h, a, b, &c, d, e, f, &g, Add(K(0x71374491ul), w1));
+        Round(g, h, a, &b, c, d, e, &f, Add(K(0xb5c0fbcful), w2));
+        Round(f, g, h, &a, b, c, d, &e, Add(K(0xe9b5dba5ul), w3));
+        Round(e, f, g, &h, a, b, c, &d, Add(K(0x3956c25bul), w4));
+        Round(d, e, f, &g, h, a, b, &c, Add(K(0x59f111f1ul), w5));
+        Round(c, d, e, &f, g, h, a, &b, Add(K(0x923f82a4ul), w6));
+        Round(b, c, d, &e, f, g, h, &a, Add(K(0xab1c5ed5ul), w7));
+        Round(a, b, c, &d, e, f, g, &h, Add(K(0xd807aa98ul), w8));
+        Round(h, a, b, &c, d, e, f, &g, Add(K(0x12835b01ul), w9));
+        Round(g, h, a, &b, c, d, e, &f, Add(K(0x243185beul), w10));
+        Round(f, g, h, &a, b, c, d, &e, Add(K(0x550c7dc3ul), w11));
+        Round(e, f, g, &h, a, b, c, &d, Add(K(0x72be5d74ul), w12));
+        Round(d, e, f, &g, h, a, b, &c, Add(K(0x80deb1feul), w13));
+        Round(c, d, e, &f, g, h, a, &b, Add(K(0x9bdc06a7ul), w14));
+        Round(b, c, d, &e, f, g, h, &a, Add(K(0xc19bf174ul), w15));
+        Round(a, b, c, &d, e, f, g, &h, Add(K(0xe49b69c1ul), Inc4(&w0, sigma1(w14), w9, sigma0(w1))));
+        Round(h, a, b, &c, d, e, f, &g, Add(K(0xefbe4786ul), Inc4(&w1, sigma1(w15), w10, sigma0(w2))));
+        Round(g, h, a, &b, c, d, e, &f, Add(K(0x0fc19dc6ul), Inc4(&w2, sigma1(w0), w11, sigma0(w3))));
+        Round(f, g, h, &a, b, c, d, &e, Add(K(0x240ca1ccul), Inc4(&w3, sigma1(w1), w12, sigma0(w4))));
+        Round(e, f, g, &h, a, b, c, &d, Add(K(0x2de92c6ful), Inc4(&w4, sigma1(w2), w13, sigma0(w5))));
+        Round(d, e, f, &g, h, a, b, &c, Add(K(0x4a7484aaul), Inc4(&w5, sigma1(w3), w14, sigma0(w6))));
+        Round(c, d, e, &f, g, h, a, &b, Add(K(0x5cb0a9dcul), Inc4(&w6, sigma1(w4), w15, sigma0(w7))));
+        Round(b, c, d, &e, f, g, h, &a, Add(K(0x76f988daul), Inc4(&w7, sigma1(w5), w0, sigma0(w8))));
+        Round(a, b, c, &d, e, f, g, &h, Add(K(0x983e5152ul), Inc4(&w8, sigma1(w6), w1, sigma0(w9))));
+        Round(h, a, b, &c, d, e, f, &g, Add(K(0xa831c66dul), Inc4(&w9, sigma1(w7), w2, sigma0(w10))));
+        Round(g, h, a, &b, c, d, e, &f, Add(K(0xb00327c8ul), Inc4(&w10, sigma1(w8), w3, sigma0(w11))));
+        Round(f, g, h, &a, b, c, d, &e, Add(K(0xbf597fc7ul), Inc4(&w11, sigma1(w9), w4, sigma0(w12))));
+        Round(e, f, g, &h, a, b, c, &d, Add(K(0xc6e00bf3ul), Inc4(&w12, sigma1(w10), w5, sigma0(w13))));
+        Round(d, e, f, &g, h, a, b, &c, Add(K(0xd5a79147ul), Inc4(&w13, sigma1(w11), w6, sigma0(w14))));
+        Round(c, d, e, &f, g, h, a, &b, Add(K(0x06ca6351ul), Inc4(&w14, sigma1(w12), w7, sigma0(w15))));
+        Round(b, c, d, &e, f, g, h, &a, Add(K(0x14292967ul), Inc4(&w15, sigma1(w13), w8, sigma0(w0))));
+        Round(a, b, c, &d, e, f, g, &h, Add(K(0x27b70a85ul), Inc4(&w0, sigma1(w14), w9, sigma0(w1))));
+        Round(h, a, b, &c, d, e, f, &g, Add(K(0x2e1b2138ul), Inc4(&w1, sigma1(w15), w10, sigma0(w2))));
+        Round(g, h, a, &b, c, d, e, &f, Add(K(0x4d2c6dfcul), Inc4(&w2, sigma1(w0), w11, sigma0(w3))));
+        Round(f, g, h, &a, b, c, d, &e, Add(K(0x53380d13ul), Inc4(&w3, sigma1(w1), w12, sigma0(w4))));
+        Round(e, f, g, &h, a, b, c, &d, Add(K(0x650a7354ul), Inc4(&w4, sigma1(w2), w13, sigma0(w5))));
+        Round(d, e, f, &g, h, a, b, &c, Add(K(0x766a0abbul), Inc4(&w5, sigma1(w3), w14, sigma0(w6))));
+        Round(c, d, e, &f, g, h, a, &b, Add(K(0x81c2c92eul), Inc4(&w6, sigma1(w4), w15, sigma0(w7))));
+        Round(b, c, d, &e, f, g, h, &a, Add(K(0x92722c85ul), Inc4(&w7, sigma1(w5), w0, sigma0(w8))));
+        Round(a, b, c, &d, e, f, g, &h, Add(K(0xa2bfe8a1ul), Inc4(&w8, sigma1(w6), w1, sigma0(w9))));
+        Round(h, a, b, &c, d, e, f, &g, Add(K(0xa81a664bul), Inc4(&w9, sigma1(w7), w2, sigma0(w10))));
+        Round(g, h, a, &b, c, d, e, &f, Add(K(0xc24b8b70ul), Inc4(&w10, sigma1(w8), w3, sigma0(w11))));
+        Round(f, g, h, &a, b, c, d, &e, Add(K(0xc76c51a3ul), Inc4(&w11, sigma1(w9), w4, sigma0(w12))));
+        Round(e, f, g, &h, a, b, c, &d, Add(K(0xd192e819ul), Inc4(&w12, sigma1(w10), w5, sigma0(w13))));
+        Round(d, e, f, &g, h, a, b, &c, Add(K(0xd6990624ul), Inc4(&w13, sigma1(w11), w6, sigma0(w14))));
+        Round(c, d, e, &f, g, h, a, &b, Add(K(0xf40e3585ul), Inc4(&w14, sigma1(w12), w7, sigma0(w15))));
+        Round(b, c, d, &e, f, g, h, &a, Add(K(0x106aa070ul), Inc4(&w15, sigma1(w13), w8, sigma0(w0))));
+        Round(a, b, c, &d, e, f, g, &h, Add(K(0x19a4c116ul), Inc4(&w0, sigma1(w14), w9, sigma0(w1))));
+        Round(h, a, b, &c, d, e, f, &g, Add(K(0x1e376c08ul), Inc4(&w1, sigma1(w15), w10, sigma0(w2))));
+        Round(g, h, a, &b, c, d, e, &f, Add(K(0x2748774cul), Inc4(&w2, sigma1(w0), w11, sigma0(w3))));
+        Round(f, g, h, &a, b, c, d, &e, Add(K(0x34b0bcb5ul), Inc4(&w3, sigma1(w1), w12, sigma0(w4))));
+        Round(e, f, g, &h, a, b, c, &d, Add(K(0x391c0cb3ul), Inc4(&w4, sigma1(w2), w13, sigma0(w5))));
+        Round(d, e, f, &g, h, a, b, &c, Add(K(0x4ed8aa4aul), Inc4(&w5, sigma1(w3), w14, sigma0(w6))));
+        Round(c, d, e, &f, g, h, a, &b, Add(K(0x5b9cca4ful), Inc4(&w6, sigma1(w4), w15, sigma0(w7))));
+        Round(b, c, d, &e, f, g, h, &a, Add(K(0x682e6ff3ul), Inc4(&w7, sigma1(w5), w0, sigma0(w8))));
+        Round(a, b, c, &d, e, f, g, &h, Add(K(0x748f82eeul), Inc4(&w8, sigma1(w6), w1, sigma0(w9))));
+        Round(h, a, b, &c, d, e, f, &g, Add(K(0x78a5636ful), Inc4(&w9, sigma1(w7), w2, sigma0(w10))));
+        Round(g, h, a, &b, c, d, e, &f, Add(K(0x84c87814ul), Inc4(&w10, sigma1(w8), w3, sigma0(w11))));
+        Round(f, g, h, &a, b, c, d, &e, Add(K(0x8cc70208ul), Inc4(&w11, sigma1(w9), w4, sigma0(w12))));
+        Round(e, f, g, &h, a, b, c, &d, Add(K(0x90befffaul), Inc4(&w12, sigma1(w10), w5, sigma0(w13))));
+        Round(d, e, f, &g, h, a, b, &c, Add(K(0xa4506cebul), Inc4(&w13, sigma1(w11), w6, sigma0(w14))));
+        Round(c, d, e, &f, g, h, a, &b, Add(K(0xbef9a3f7ul), Inc4(&w14, sigma1(w12), w7, sigma0(w15))));
+        Round(b, c, d, &e, f, g, h, &a, Add(K(0xc67178f2ul), Inc4(&w15, sigma1(w13), w8, sigma0(w0))));
+
+
+        StoreN(s, 0, Add(a, LoadN(s, 0)));
+        StoreN(s, 1, Add(b, LoadN(s, 1)));
+        StoreN(s, 2, Add(c, LoadN(s, 2)));
+        StoreN(s, 3, Add(d, LoadN(s, 3)));
+        StoreN(s, 4, Add(e, LoadN(s, 4)));
+        StoreN(s, 5, Add(f, LoadN(s, 5)));
+        StoreN(s, 6, Add(g, LoadN(s, 6)));
+        StoreN(s, 7, Add(h, LoadN(s, 7)));
+}
+
+/** SHA256 of one 64-byte message per lane (in[2 * i] and in[2 * i + 1] in
+ * lane i), leaving the digest words in the lanes of digest[0..7]. */
+static inline __attribute__((always_inline)) void Hash64(VEC digest[8], const struct sha256 in[])
+{
+        /* Transform 1 */
+        VEC a = K(0x6a09e667ul);
+        VEC b = K(0xbb67ae85ul);
+        VEC c = K(0x3c6ef372ul);
+        VEC d = K(0xa54ff53aul);
+        VEC e = K(0x510e527ful);
+        VEC f = K(0x9b05688cul);
+        VEC g = K(0x1f83d9abul);
+        VEC h = K(0x5be0cd19ul);
+
+        VEC w0 = ReadN(&in[0].u8[0]),
+                w1 = ReadN(&in[0].u8[4]),
+                w2 = ReadN(&in[0].u8[8]),
+                w3 = ReadN(&in[0].u8[12]),
+                w4 = ReadN(&in[0].u8[16]),
+                w5 = ReadN(&in[0].u8[20]),
+                w6 = ReadN(&in[0].u8[24]),
+                w7 = ReadN(&in[0].u8[28]),
+                w8 = ReadN(&in[1].u8[0]),
+                w9 = ReadN(&in[1].u8[4]),
+                w10 = ReadN(&in[1].u8[8]),
+                w11 = ReadN(&in[1].u8[12]),
+                w12 = ReadN(&in[1].u8[16]),
+                w13 = ReadN(&in[1].u8[20]),
+                w14 = ReadN(&in[1].u8[24]),
+                w15 = ReadN(&in[1].u8[28]);
+
+        VEC t0, t1, t2, t3, t4, t5, t6, t7;
+
+        Round(a, b, c, &d, e, f, g, &h, Add(K(0x428a2f98ul), w0));
+        Round(h, a, b, &c, d, e, f, &g, Add(K(0x71374491ul), w1));
+        Round(g, h, a, &b, c, d, e, &f, Add(K(0xb5c0fbcful), w2));
+        Round(f, g, h, &a, b, c, d, &e, Add(K(0xe9b5dba5ul), w3));
+        Round(e, f, g, &h, a, b, c, &d, Add(K(0x3956c25bul), w4));
+        Round(d, e, f, &g, h, a, b, &c, Add(K(0x59f111f1ul), w5));
+        Round(c, d, e, &f, g, h, a, &b, Add(K(0x923f82a4ul), w6));
+        Round(b, c, d, &e, f, g, h, &a, Add(K(0xab1c5ed5ul), w7));
+        Round(a, b, c, &d, e, f, g, &h, Add(K(0xd807aa98ul), w8));
+        Round(h, a, b, &c, d, e, f, &g, Add(K(0x12835b01ul), w9));
+        Round(g, h, a, &b, c, d, e, &f, Add(K(0x243185beul), w10));
+        Round(f, g, h, &a, b, c, d, &e, Add(K(0x550c7dc3ul), w11));
+        Round(e, f, g, &h, a, b, c, &d, Add(K(0x72be5d74ul), w12));
+        Round(d, e, f, &g, h, a, b, &c, Add(K(0x80deb1feul), w13));
+        Round(c, d, e, &f, g, h, a, &b, Add(K(0x9bdc06a7ul), w14));
+        Round(b, c, d, &e, f, g, h, &a, Add(K(0xc19bf174ul), w15));
+        Round(a, b, c, &d, e, f, g, &h, Add(K(0xe49b69c1ul), Inc4(&w0, sigma1(w14), w9, sigma0(w1))));
+        Round(h, a, b, &c, d, e, f, &g, Add(K(0xefbe4786ul), Inc4(&w1, sigma1(w15), w10, sigma0(w2))));
+        Round(g, h, a, &b, c, d, e, &f, Add(K(0x0fc19dc6ul), Inc4(&w2, sigma1(w0), w11, sigma0(w3))));
+        Round(f, g, h, &a, b, c, d, &e, Add(K(0x240ca1ccul), Inc4(&w3, sigma1(w1), w12, sigma0(w4))));
+        Round(e, f, g, &h, a, b, c, &d, Add(K(0x2de92c6ful), Inc4(&w4, sigma1(w2), w13, sigma0(w5))));
+        Round(d, e, f, &g, h, a, b, &c, Add(K(0x4a7484aaul), Inc4(&w5, sigma1(w3), w14, sigma0(w6))));
+        Round(c, d, e, &f, g, h, a, &b, Add(K(0x5cb0a9dcul), Inc4(&w6, sigma1(w4), w15, sigma0(w7))));
+        Round(b, c, d, &e, f, g, h, &a, Add(K(0x76f988daul), Inc4(&w7, sigma1(w5), w0, sigma0(w8))));
+        Round(a, b, c, &d, e, f, g, &h, Add(K(0x983e5152ul), Inc4(&w8, sigma1(w6), w1, sigma0(w9))));
+        Round(h, a, b, &c, d, e, f, &g, Add(K(0xa831c66dul), Inc4(&w9, sigma1(w7), w2, sigma0(w10))));
+        Round(g, h, a, &b, c, d, e, &f, Add(K(0xb00327c8ul), Inc4(&w10, sigma1(w8), w3, sigma0(w11))));
+        Round(f, g, h, &a, b, c, d, &e, Add(K(0xbf597fc7ul), Inc4(&w11, sigma1(w9), w4, sigma0(w12))));
+        Round(e, f, g, &h, a, b, c, &d, Add(K(0xc6e00bf3ul), Inc4(&w12, sigma1(w10), w5, sigma0(w13))));
+        Round(d, e, f, &g, h, a, b, &c, Add(K(0xd5a79147ul), Inc4(&w13, sigma1(w11), w6, sigma0(w14))));
+        Round(c, d, e, &f, g, h, a, &b, Add(K(0x06ca6351ul), Inc4(&w14, sigma1(w12), w7, sigma0(w15))));
+        Round(b, c, d, &e, f, g, h, &a, Add(K(0x14292967ul), Inc4(&w15, sigma1(w13), w8, sigma0(w0))));
+        Round(a, b, c, &d, e, f, g, &h, Add(K(0x27b70a85ul), Inc4(&w0, sigma1(w14), w9, sigma0(w1))));
+        Round(h, a, b, &c, d, e, f, &g, Add(K(0x2e1b2138ul), Inc4(&w1, sigma1(w15), w10, sigma0(w2))));
+        Round(g, h, a, &b, c, d, e, &f, Add(K(0x4d2c6dfcul), Inc4(&w2, sigma1(w0), w11, sigma0(w3))));
+        Round(f, g, h, &a, b, c, d, &e, Add(K(0x53380d13ul), Inc4(&w3, sigma1(w1), w12, sigma0(w4))));
+        Round(e, f, g, &h, a, b, c, &d, Add(K(0x650a7354ul), Inc4(&w4, sigma1(w2), w13, sigma0(w5))));
+        Round(d, e, f, &g, h, a, b, &c, Add(K(0x766a0abbul), Inc4(&w5, sigma1(w3), w14, sigma0(w6))));
+        Round(c, d, e, &f, g, h, a, &b, Add(K(0x81c2c92eul), Inc4(&w6, sigma1(w4), w15, sigma0(w7))));
+        Round(b, c, d, &e, f, g, h, &a, Add(K(0x92722c85ul), Inc4(&w7, sigma1(w5), w0, sigma0(w8))));
+        Round(a, b, c, &d, e, f, g, &h, Add(K(0xa2bfe8a1ul), Inc4(&w8, sigma1(w6), w1, sigma0(w9))));
+        Round(h, a, b, &c, d, e, f, &g, Add(K(0xa81a664bul), Inc4(&w9, sigma1(w7), w2, sigma0(w10))));
+        Round(g, h, a, &b, c, d, e, &f, Add(K(0xc24b8b70ul), Inc4(&w10, sigma1(w8), w3, sigma0(w11))));
+        Round(f, g, h, &a, b, c, d, &e, Add(K(0xc76c51a3ul), Inc4(&w11, sigma1(w9), w4, sigma0(w12))));
+        Round(e, f, g, &h, a, b, c, &d, Add(K(0xd192e819ul), Inc4(&w12, sigma1(w10), w5, sigma0(w13))));
+        Round(d, e, f, &g, h, a, b, &c, Add(K(0xd6990624ul), Inc4(&w13, sigma1(w11), w6, sigma0(w14))));
+        Round(c, d, e, &f, g, h, a, &b, Add(K(0xf40e3585ul), Inc4(&w14, sigma1(w12), w7, sigma0(w15))));
+        Round(b, c, d, &e, f, g, h, &a, Add(K(0x106aa070ul), Inc4(&w15, sigma1(w13), w8, sigma0(w0))));
+        Round(a, b, c, &d, e, f, g, &h, Add(K(0x19a4c116ul), Inc4(&w0, sigma1(w14), w9, sigma0(w1))));
+        Round(h, a, b, &c, d, e, f, &g, Add(K(0x1e376c08ul), Inc4(&w1, sigma1(w15), w10, sigma0(w2))));
+        Round(g, h, a, &b, c, d, e, &f, Add(K(0x2748774cul), Inc4(&w2, sigma1(w0), w11, sigma0(w3))));
+        Round(f, g, h, &a, b, c, d, &e, Add(K(0x34b0bcb5ul), Inc4(&w3, sigma1(w1), w12, sigma0(w4))));
+        Round(e, f, g, &h, a, b, c, &d, Add(K(0x391c0cb3ul), Inc4(&w4, sigma1(w2), w13, sigma0(w5))));
+        Round(d, e, f, &g, h, a, b, &c, Add(K(0x4ed8aa4aul), Inc4(&w5, sigma1(w3), w14, sigma0(w6))));
+        Round(c, d, e, &f, g, h, a, &b, Add(K(0x5b9cca4ful), Inc4(&w6, sigma1(w4), w15, sigma0(w7))));
+        Round(b, c, d, &e, f, g, h, &a, Add(K(0x682e6ff3ul), Inc4(&w7, sigma1(w5), w0, sigma0(w8))));
+        Round(a, b, c, &d, e, f, g, &h, Add(K(0x748f82eeul), Inc4(&w8, sigma1(w6), w1, sigma0(w9))));
+        Round(h, a, b, &c, d, e, f, &g, Add(K(0x78a5636ful), Inc4(&w9, sigma1(w7), w2, sigma0(w10))));
+        Round(g, h, a, &b, c, d, e, &f, Add(K(0x84c87814ul), Inc4(&w10, sigma1(w8), w3, sigma0(w11))));
+        Round(f, g, h, &a, b, c, d, &e, Add(K(0x8cc70208ul), Inc4(&w11, sigma1(w9), w4, sigma0(w12))));
+        Round(e, f, g, &h, a, b, c, &d, Add(K(0x90befffaul), Inc4(&w12, sigma1(w10), w5, sigma0(w13))));
+        Round(d, e, f, &g, h, a, b, &c, Add(K(0xa4506cebul), Inc4(&w13, sigma1(w11), w6, sigma0(w14))));
+        Round(c, d, e, &f, g, h, a, &b, Add(K(0xbef9a3f7ul), Inc4(&w14, sigma1(w12), w7, sigma0(w15))));
+        Round(b, c, d, &e, f, g, h, &a, Add(K(0xc67178f2ul), Inc4(&w15, sigma1(w13), w8, sigma0(w0))));
+
+        t0 = a = Add(a, K(0x6a09e667ul));
+        t1 = b = Add(b, K(0xbb67ae85ul));
+        t2 = c = Add(c, K(0x3c6ef372ul));
+        t3 = d = Add(d, K(0xa54ff53aul));
+        t4 = e = Add(e, K(0x510e527ful));
+        t5 = f = Add(f, K(0x9b05688cul));
+        t6 = g = Add(g, K(0x1f83d9abul));
+        t7 = h = Add(h, K(0x5be0cd19ul));
+
+        /* Transform 2 */
+        Round(a, b, c, &d, e, f, g, &h, K(0xc28a2f98ul));
+        Round(h, a, b, &c, d, e, f, &g, K(0x71374491ul));
+        Round(g, h, a, &b, c, d, e, &f, K(0xb5c0fbcful));
+        Round(f, g, h, &a, b, c, d, &e, K(0xe9b5dba5ul));
+        Round(e, f, g, &h, a, b, c, &d, K(0x3956c25bul));
+        Round(d, e, f, &g, h, a, b, &c, K(0x59f111f1ul));
+        Round(c, d, e, &f, g, h, a, &b, K(0x923f82a4ul));
+        Round(b, c, d, &e, f, g, h, &a, K(0xab1c5ed5ul));
+        Round(a, b, c, &d, e, f, g, &h, K(0xd807aa98ul));
+        Round(h, a, b, &c, d, e, f, &g, K(0x12835b01ul));
+        Round(g, h, a, &b, c, d, e, &f, K(0x243185beul));
+        Round(f, g, h, &a, b, c, d, &e, K(0x550c7dc3ul));
+        Round(e, f, g, &h, a, b, c, &d, K(0x72be5d74ul));
+        Round(d, e, f, &g, h, a, b, &c, K(0x80deb1feul));
+        Round(c, d, e, &f, g, h, a, &b, K(0x9bdc06a7ul));
+        Round(b, c, d, &e, f, g, h, &a, K(0xc19bf374ul));
+        Round(a, b, c, &d, e, f, g, &h, K(0x649b69c1ul));
+        Round(h, a, b, &c, d, e, f, &g, K(0xf0fe4786ul));
+        Round(g, h, a, &b, c, d, e, &f, K(0x0fe1edc6ul));
+        Round(f, g, h, &a, b, c, d, &e, K(0x240cf254ul));
+        Round(e, f, g, &h, a, b, c, &d, K(0x4fe9346ful));
+        Round(d, e, f, &g, h, a, b, &c, K(0x6cc984beul));
+        Round(c, d, e, &f, g, h, a, &b, K(0x61b9411eul));
+        Round(b, c, d, &e, f, g, h, &a, K(0x16f988faul));
+        Round(a, b, c, &d, e, f, g, &h, K(0xf2c65152ul));
+        Round(h, a, b, &c, d, e, f, &g, K(0xa88e5a6dul));
+        Round(g, h, a, &b, c, d, e, &f, K(0xb019fc65ul));
+        Round(f, g, h, &a, b, c, d, &e, K(0xb9d99ec7ul));
+        Round(e, f, g, &h, a, b, c, &d, K(0x9a1231c3ul));
+        Round(d, e, f, &g, h, a, b, &c, K(0xe70eeaa0ul));
+        Round(c, d, e, &f, g, h, a, &b, K(0xfdb1232bul));
+        Round(b, c, d, &e, f, g, h, &a, K(0xc7353eb0ul));
+        Round(a, b, c, &d, e, f, g, &h, K(0x3069bad5ul));
+        Round(h, a, b, &c, d, e, f, &g, K(0xcb976d5ful));
+        Round(g, h, a, &b, c, d, e, &f, K(0x5a0f118ful));
+        Round(f, g, h, &a, b, c, d, &e, K(0xdc1eeefdul));
+        Round(e, f, g, &h, a, b, c, &d, K(0x0a35b689ul));
+        Round(d, e, f, &g, h, a, b, &c, K(0xde0b7a04ul));
+        Round(c, d, e, &f, g, h, a, &b, K(0x58f4ca9dul));
+        Round(b, c, d, &e, f, g, h, &a, K(0xe15d5b16ul));
+        Round(a, b, c, &d, e, f, g, &h, K(0x007f3e86ul));
+        Round(h, a, b, &c, d, e, f, &g, K(0x37088980ul));
+        Round(g, h, a, &b, c, d, e, &f, K(0xa507ea32ul));
+        Round(f, g, h, &a, b, c, d, &e, K(0x6fab9537ul));
+        Round(e, f, g, &h, a, b, c, &d, K(0x17406110ul));
+        Round(d, e, f, &g, h, a, b, &c, K(0x0d8cd6f1ul));
+        Round(c, d, e, &f, g, h, a, &b, K(0xcdaa3b6dul));
+        Round(b, c, d, &e, f, g, h, &a, K(0xc0bbbe37ul));
+        Round(a, b, c, &d, e, f, g, &h, K(0x83613bdaul));
+        Round(h, a, b, &c, d, e, f, &g, K(0xdb48a363ul));
+        Round(g, h, a, &b, c, d, e, &f, K(0x0b02e931ul));
+        Round(f, g, h, &a, b, c, d, &e, K(0x6fd15ca7ul));
+        Round(e, f, g, &h, a, b, c, &d, K(0x521afacaul));
+        Round(d, e, f, &g, h, a, b, &c, K(0x31338431ul));
+        Round(c, d, e, &f, g, h, a, &b, K(0x6ed41a95ul));
+        Round(b, c, d, &e, f, g, h, &a, K(0x6d437890ul));
+        Round(a, b, c, &d, e, f, g, &h, K(0xc39c91f2ul));
+        Round(h, a, b, &c, d, e, f, &g, K(0x9eccabbdul));
+        Round(g, h, a, &b, c, d, e, &f, K(0xb5c9a0e6ul));
+        Round(f, g, h, &a, b, c, d, &e, K(0x532fb63cul));
+        Round(e, f, g, &h, a, b, c, &d, K(0xd2c741c6ul));
+        Round(d, e, f, &g, h, a, b, &c, K(0x07237ea3ul));
+        Round(c, d, e, &f, g, h, a, &b, K(0xa4954b68ul));
+        Round(b, c, d, &e, f, g, h, &a, K(0x4c191d76ul));
+
+        digest[0] = Add(t0, a);
+        digest[1] = Add(t1, b);
+        digest[2] = Add(t2, c);
+        digest[3] = Add(t3, d);
+        digest[4] = Add(t4, e);
+        digest[5] = Add(t5, f);
+        digest[6] = Add(t6, g);
+        digest[7] = Add(t7, h);
+}
+
+void NWAY_D64(struct sha256 out[NWAY_LANES], const struct sha256 in[2 * NWAY_LANES])
+{
+        VEC digest[8];
+        VEC a, b, c, d, e, f, g, h;
+        VEC w0, w1, w2, w3, w4, w5, w6, w7, w8, w9, w10, w11, w12, w13, w14, w15;
+
+        /* Transforms 1 and 2 */
+        Hash64(digest, in);
+        w0 = digest[0];
+        w1 = digest[1];
+        w2 = digest[2];
+        w3 = digest[3];
+        w4 = digest[4];
+        w5 = digest[5];
+        w6 = digest[6];
+        w7 = digest[7];
+
+        /* Transform 3 */
+        a = K(0x6a09e667ul);
+        b = K(0xbb67ae85ul);
+        c = K(0x3c6ef372ul);
+        d = K(0xa54ff53aul);
+        e = K(0x510e527ful);
+        f = K(0x9b05688cul);
+        g = K(0x1f83d9abul);
+        h = K(0x5be0cd19ul);
+
+        Round(a, b, c, &d, e, f, g, &h, Add(K(0x428a2f98ul), w0));
+        Round(h, a, b, &c, d, e, f, &g, Add(K(0x71374491ul), w1));
+        Round(g, h, a, &b, c, d, e, &f, Add(K(0xb5c0fbcful), w2));
+        Round(f, g, h, &a, b, c, d, &e, Add(K(0xe9b5dba5ul), w3));
+        Round(e, f, g, &h, a, b, c, &d, Add(K(0x3956c25bul), w4));
+        Round(d, e, f, &g, h, a, b, &c, Add(K(0x59f111f1ul), w5));
+        Round(c, d, e, &f, g, h, a, &b, Add(K(0x923f82a4ul), w6));
+        Round(b, c, d, &e, f, g, h, &a, Add(K(0xab1c5ed5ul), w7));
+        Round(a, b, c, &d, e, f, g, &h, K(0x5807aa98ul));
+        Round(h, a, b, &c, d, e, f, &g, K(0x12835b01ul));
+        Round(g, h, a, &b, c, d, e, &f, K(0x243185beul));
+        Round(f, g, h, &a, b, c, d, &e, K(0x550c7dc3ul));
+        Round(e, f, g, &h, a, b, c, &d, K(0x72be5d74ul));
+        Round(d, e, f, &g, h, a, b, &c, K(0x80deb1feul));
+        Round(c, d, e, &f, g, h, a, &b, K(0x9bdc06a7ul));
+        Round(b, c, d, &e, f, g, h, &a, K(0xc19bf274ul));
+        Round(a, b, c, &d, e, f, g, &h, Add(K(0xe49b69c1ul), Inc(&w0, sigma0(w1))));
+        Round(h, a, b, &c, d, e, f, &g, Add(K(0xefbe4786ul), Inc3(&w1, K(0xa00000ul), sigma0(w2))));
+        Round(g, h, a, &b, c, d, e, &f, Add(K(0x0fc19dc6ul), Inc3(&w2, sigma1(w0), sigma0(w3))));
+        Round(f, g, h, &a, b, c, d, &e, Add(K(0x240ca1ccul), Inc3(&w3, sigma1(w1), sigma0(w4))));
+        Round(e, f, g, &h, a, b, c, &d, Add(K(0x2de92c6ful), Inc3(&w4, sigma1(w2), sigma0(w5))));
+        Round(d, e, f, &g, h, a, b, &c, Add(K(0x4a7484aaul), Inc3(&w5, sigma1(w3), sigma0(w6))));
+        Round(c, d, e, &f, g, h, a, &b, Add(K(0x5cb0a9dcul), Inc4(&w6, sigma1(w4), K(0x100ul), sigma0(w7))));
+        Round(b, c, d, &e, f, g, h, &a, Add(K(0x76f988daul), Inc4(&w7, sigma1(w5), w0, K(0x11002000ul))));
+        w8 = Add3(K(0x80000000ul), sigma1(w6), w1);
+        Round(a, b, c, &d, e, f, g, &h, Add(K(0x983e5152ul), w8));
+        w9 = Add(sigma1(w7), w2);
+        Round(h, a, b, &c, d, e, f, &g, Add(K(0xa831c66dul), w9));
+        w10 = Add(sigma1(w8), w3);
+        Round(g, h, a, &b, c, d, e, &f, Add(K(0xb00327c8ul), w10));
+        w11 = Add(sigma1(w9), w4);
+        Round(f, g, h, &a, b, c, d, &e, Add(K(0xbf597fc7ul), w11));
+        w12 = Add(sigma1(w10), w5);
+        Round(e, f, g, &h, a, b, c, &d, Add(K(0xc6e00bf3ul), w12));
+        w13 = Add(sigma1(w11), w6);
+        Round(d, e, f, &g, h, a, b, &c, Add(K(0xd5a79147ul), w13));
+        w14 = Add3(sigma1(w12), w7, K(0x400022ul));
+        Round(c, d, e, &f, g, h, a, &b, Add(K(0x06ca6351ul), w14));
+        w15 = Add4(K(0x100ul), sigma1(w13), w8, sigma0(w0));
+        Round(b, c, d, &e, f, g, h, &a, Add(K(0x14292967ul), w15));
+        Round(a, b, c, &d, e, f, g, &h, Add(K(0x27b70a85ul), Inc4(&w0, sigma1(w14), w9, sigma0(w1))));
+        Round(h, a, b, &c, d, e, f, &g, Add(K(0x2e1b2138ul), Inc4(&w1, sigma1(w15), w10, sigma0(w2))));
+        Round(g, h, a, &b, c, d, e, &f, Add(K(0x4d2c6dfcul), Inc4(&w2, sigma1(w0), w11, sigma0(w3))));
+        Round(f, g, h, &a, b, c, d, &e, Add(K(0x53380d13ul), Inc4(&w3, sigma1(w1), w12, sigma0(w4))));
+        Round(e, f, g, &h, a, b, c, &d, Add(K(0x650a7354ul), Inc4(&w4, sigma1(w2), w13, sigma0(w5))));
+        Round(d, e, f, &g, h, a, b, &c, Add(K(0x766a0abbul), Inc4(&w5, sigma1(w3), w14, sigma0(w6))));
+        Round(c, d, e, &f, g, h, a, &b, Add(K(0x81c2c92eul), Inc4(&w6, sigma1(w4), w15, sigma0(w7))));
+        Round(b, c, d, &e, f, g, h, &a, Add(K(0x92722c85ul), Inc4(&w7, sigma1(w5), w0, sigma0(w8))));
+        Round(a, b, c, &d, e, f, g, &h, Add(K(0xa2bfe8a1ul), Inc4(&w8, sigma1(w6), w1, sigma0(w9))));
+        Round(h, a, b, &c, d, e, f, &g, Add(K(0xa81a664bul), Inc4(&w9, sigma1(w7), w2, sigma0(w10))));
+        Round(g, h, a, &b, c, d, e, &f, Add(K(0xc24b8b70ul), Inc4(&w10, sigma1(w8), w3, sigma0(w11))));
+        Round(f, g, h, &a, b, c, d, &e, Add(K(0xc76c51a3ul), Inc4(&w11, sigma1(w9), w4, sigma0(w12))));
+        Round(e, f, g, &h, a, b, c, &d, Add(K(0xd192e819ul), Inc4(&w12, sigma1(w10), w5, sigma0(w13))));
+        Round(d, e, f, &g, h, a, b, &c, Add(K(0xd6990624ul), Inc4(&w13, sigma1(w11), w6, sigma0(w14))));
+        Round(c, d, e, &f, g, h, a, &b, Add(K(0xf40e3585ul), Inc4(&w14, sigma1(w12), w7, sigma0(w15))));
+        Round(b, c, d, &e, f, g, h, &a, Add(K(0x106aa070ul), Inc4(&w15, sigma1(w13), w8, sigma0(w0))));
+        Round(a, b, c, &d, e, f, g, &h, Add(K(0x19a4c116ul), Inc4(&w0, sigma1(w14), w9, sigma0(w1))));
+        Round(h, a, b, &c, d, e, f, &g, Add(K(0x1e376c08ul), Inc4(&w1, sigma1(w15), w10, sigma0(w2))));
+        Round(g, h, a, &b, c, d, e, &f, Add(K(0x2748774cul), Inc4(&w2, sigma1(w0), w11, sigma0(w3))));
+        Round(f, g, h, &a, b, c, d, &e, Add(K(0x34b0bcb5ul), Inc4(&w3, sigma1(w1), w12, sigma0(w4))));
+        Round(e, f, g, &h, a, b, c, &d, Add(K(0x391c0cb3ul), Inc4(&w4, sigma1(w2), w13, sigma0(w5))));
+        Round(d, e, f, &g, h, a, b, &c, Add(K(0x4ed8aa4aul), Inc4(&w5, sigma1(w3), w14, sigma0(w6))));
+        Round(c, d, e, &f, g, h, a, &b, Add(K(0x5b9cca4ful), Inc4(&w6, sigma1(w4), w15, sigma0(w7))));
+        Round(b, c, d, &e, f, g, h, &a, Add(K(0x682e6ff3ul), Inc4(&w7, sigma1(w5), w0, sigma0(w8))));
+        Round(a, b, c, &d, e, f, g, &h, Add(K(0x748f82eeul), Inc4(&w8, sigma1(w6), w1, sigma0(w9))));
+        Round(h, a, b, &c, d, e, f, &g, Add(K(0x78a5636ful), Inc4(&w9, sigma1(w7), w2, sigma0(w10))));
+        Round(g, h, a, &b, c, d, e, &f, Add(K(0x84c87814ul), Inc4(&w10, sigma1(w8), w3, sigma0(w11))));
+        Round(f, g, h, &a, b, c, d, &e, Add(K(0x8cc70208ul), Inc4(&w11, sigma1(w9), w4, sigma0(w12))));
+        Round(e, f, g, &h, a, b, c, &d, Add(K(0x90befffaul), Inc4(&w12, sigma1(w10), w5, sigma0(w13))));
+        Round(d, e, f, &g, h, a, b, &c, Add(K(0xa4506cebul), Inc4(&w13, sigma1(w11), w6, sigma0(w14))));
+        Round(c, d, e, &f, g, h, a, &b, Add5(K(0xbef9a3f7ul), w14, sigma1(w12), w7, sigma0(w15)));
+        Round(b, c, d, &e, f, g, h, &a, Add5(K(0xc67178f2ul), w15, sigma1(w13), w8, sigma0(w0)));
+
+        /* Output */
+        WriteN(&out->u8[0], Add(a, K(0x6a09e667ul)));
+        WriteN(&out->u8[4], Add(b, K(0xbb67ae85ul)));
+        WriteN(&out->u8[8], Add(c, K(0x3c6ef372ul)));
+        WriteN(&out->u8[12], Add(d, K(0xa54ff53aul)));
+        WriteN(&out->u8[16], Add(e, K(0x510e527ful)));
+        WriteN(&out->u8[20], Add(f, K(0x9b05688cul)));
+        WriteN(&out->u8[24], Add(g, K(0x1f83d9abul)));
+        WriteN(&out->u8[28], Add(h, K(0x5be0cd19ul)));
+}
+
+void NWAY_H64(struct sha256 out[NWAY_LANES], const struct sha256 in[2 * NWAY_LANES])
+{
+        VEC digest[8];
+
+        Hash64(digest, in);
+
+        /* Output */
+        WriteN(&out->u8[0], digest[0]);
+        WriteN(&out->u8[4], digest[1]);
+        WriteN(&out->u8[8], digest[2]);
+        WriteN(&out->u8[12], digest[3]);
+        WriteN(&out->u8[16], digest[4]);
+        WriteN(&out->u8[20], digest[5]);
+        WriteN(&out->u8[24], digest[6]);
+        WriteN(&out->u8[28], digest[7]);
+}
+
+#undef Inc
+#undef Inc3
+#undef Inc4
+#undef Ch
+#undef Maj
+#undef Sigma0
+#undef Sigma1
+#undef sigma0
+#undef sigma1
+#undef Round
+#undef Hash64
+#undef Rotr
+#undef Add3
+#undef Add4
+#undef Add5
+#undef Xor3
+#undef NWAY_FN
+#undef NWAY_CAT
+#undef NWAY_CAT2
+#undef NWAY_MULTI
+#undef NWAY_D64
+#undef NWAY_H64
+#undef NWAY_STATES
+#undef K
+#undef Add
+#undef Xor
+#undef Or
+#undef And
+#undef ShR
+#undef ShL
+#undef ReadN
+#undef WriteN
+#undef LoadN
+#undef StoreN
+
+/* End of File
+ */
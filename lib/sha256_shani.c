@@ -397,6 +397,95 @@ void transform_sha256d64_shani_2way(struct sha256 out[2], const struct sha256 in
         Save(&out[1].u8[16], bs1);
 }
 
+void transform_sha256d32_shani(struct sha256 out[1], const uint32_t in[8])
+{
+        __m128i m0, m1, m2, m3, s0, s1;
+
+        /* The digest words are already in host order, so they are loaded
+         * into the message schedule as-is.  See the comment in
+         * transform_sha256_shani() about unnecessary copying. */
+        __m128i m;
+        memcpy(&m, in, sizeof(m));
+        m0 = _mm_loadu_si128(&m);
+        memcpy(&m, in + 4, sizeof(m));
+        m1 = _mm_loadu_si128(&m);
+
+        s0 = _mm_load_si128((const __m128i*)INIT0);
+        s1 = _mm_load_si128((const __m128i*)INIT1);
+        QuadRound2(&s0, &s1, m0, 0xe9b5dba5B5c0fbcfull, 0x71374491428a2f98ull);
+        QuadRound2(&s0, &s1, m1, 0xab1c5ed5923f82a4ull, 0x59f111f13956c25bull);
+        ShiftMessageA(&m0, m1);
+        m2 = _mm_set_epi64x(0x0ull, 0x80000000ull);
+        QuadRound(&s0, &s1, 0x550c7dc3243185beull, 0x12835b015807aa98ull);
+        ShiftMessageA(&m1, m2);
+        m3 = _mm_set_epi64x(0x10000000000ull, 0x0ull);
+        QuadRound(&s0, &s1, 0xc19bf2749bdc06a7ull, 0x80deb1fe72be5d74ull);
+        ShiftMessageB(&m2, m3, &m0);
+        QuadRound2(&s0, &s1, m0, 0x240ca1cc0fc19dc6ull, 0xefbe4786e49b69c1ull);
+        ShiftMessageB(&m3, m0, &m1);
+        QuadRound2(&s0, &s1, m1, 0x76f988da5cb0a9dcull, 0x4a7484aa2de92c6full);
+        ShiftMessageB(&m0, m1, &m2);
+        QuadRound2(&s0, &s1, m2, 0xbf597fc7b00327c8ull, 0xa831c66d983e5152ull);
+        ShiftMessageB(&m1, m2, &m3);
+        QuadRound2(&s0, &s1, m3, 0x1429296706ca6351ull, 0xd5a79147c6e00bf3ull);
+        ShiftMessageB(&m2, m3, &m0);
+        QuadRound2(&s0, &s1, m0, 0x53380d134d2c6dfcull, 0x2e1b213827b70a85ull);
+        ShiftMessageB(&m3, m0, &m1);
+        QuadRound2(&s0, &s1, m1, 0x92722c8581c2c92eull, 0x766a0abb650a7354ull);
+        ShiftMessageB(&m0, m1, &m2);
+        QuadRound2(&s0, &s1, m2, 0xc76c51a3c24b8b70ull, 0xa81a664ba2bfe8A1ull);
+        ShiftMessageB(&m1, m2, &m3);
+        QuadRound2(&s0, &s1, m3, 0x106aa070f40e3585ull, 0xd6990624d192e819ull);
+        ShiftMessageB(&m2, m3, &m0);
+        QuadRound2(&s0, &s1, m0, 0x34b0bcb52748774cull, 0x1e376c0819a4c116ull);
+        ShiftMessageB(&m3, m0, &m1);
+        QuadRound2(&s0, &s1, m1, 0x682e6ff35b9cca4full, 0x4ed8aa4a391c0cb3ull);
+        ShiftMessageC(&m0, m1, &m2);
+        QuadRound2(&s0, &s1, m2, 0x8cc7020884c87814ull, 0x78a5636f748f82eeull);
+        ShiftMessageC(&m1, m2, &m3);
+        QuadRound2(&s0, &s1, m3, 0xc67178f2bef9a3f7ull, 0xa4506ceb90befffaull);
+        s0 = _mm_add_epi32(s0, _mm_load_si128((const __m128i*)INIT0));
+        s1 = _mm_add_epi32(s1, _mm_load_si128((const __m128i*)INIT1));
+
+        /* Extract hash into out */
+        Unshuffle(&s0, &s1);
+        Save(&out[0].u8[0], s0);
+        Save(&out[0].u8[16], s1);
+}
+
+void transform_sha256ks_shani(uint32_t* s, const uint32_t* ks)
+{
+        __m128i s0, s1, so0, so1, k;
+        int i;
+
+        /* See comment in transform_sha256_shani() about unnecessary copying. */
+        __m128i m;
+        memcpy(&m, s, sizeof(m));
+        s0 = _mm_loadu_si128(&m);
+        memcpy(&m, s + 4, sizeof(m));
+        s1 = _mm_loadu_si128(&m);
+        Shuffle(&s0, &s1);
+        so0 = s0;
+        so1 = s1;
+
+        /* The round constants are already added into the schedule, so
+         * there is no message expansion left to do. */
+        for (i = 0; i < 64; i += 4) {
+                memcpy(&m, ks + i, sizeof(m));
+                k = _mm_loadu_si128(&m);
+                s1 = _mm_sha256rnds2_epu32(s1, s0, k);
+                s0 = _mm_sha256rnds2_epu32(s0, s1, _mm_shuffle_epi32(k, 0x0e));
+        }
+
+        s0 = _mm_add_epi32(s0, so0);
+        s1 = _mm_add_epi32(s1, so1);
+        Unshuffle(&s0, &s1);
+        _mm_storeu_si128(&m, s0);
+        memcpy(s, &m, sizeof(m));
+        _mm_storeu_si128(&m, s1);
+        memcpy(s + 4, &m, sizeof(m));
+}
+
 #else
 /* -Wempty-translation-unit
  * ISO C requires a translation unit to contain at least one declaration
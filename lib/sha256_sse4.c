@@ -962,6 +962,276 @@ void transform_sha256_sse4(uint32_t* s, const unsigned char* chunk, size_t block
         );
 }
 
+void transform_sha256ks_sse4(uint32_t* s, const uint32_t* ks)
+{
+        uint32_t a, b, c, d, f, g, h, y0, y1, y2;
+        uint64_t e, n;
+
+        /* The rounds of transform_sha256_sse4(), reading the message schedule
+         * with the round constants already added from ks instead of computing
+         * it with SSE. */
+        __asm__ __volatile__(
+                "mov    (%0),%3;"
+                "mov    0x4(%0),%4;"
+                "mov    0x8(%0),%5;"
+                "mov    0xc(%0),%6;"
+                "mov    0x10(%0),%k2;"
+                "mov    0x14(%0),%7;"
+                "mov    0x18(%0),%8;"
+                "mov    0x1c(%0),%9;"
+                "mov    $0x8,%1;"
+
+                "Lloop_%=:"
+                "mov    %k2,%10;"
+                "ror    $0xe,%10;"
+                "mov    %3,%11;"
+                "xor    %k2,%10;"
+                "ror    $0x9,%11;"
+                "mov    %7,%12;"
+                "xor    %3,%11;"
+                "ror    $0x5,%10;"
+                "xor    %8,%12;"
+                "xor    %k2,%10;"
+                "ror    $0xb,%11;"
+                "and    %k2,%12;"
+                "xor    %3,%11;"
+                "ror    $0x6,%10;"
+                "xor    %8,%12;"
+                "add    %10,%12;"
+                "ror    $0x2,%11;"
+                "add    0(%13),%12;"
+                "mov    %3,%10;"
+                "add    %12,%9;"
+                "mov    %3,%12;"
+                "or     %5,%10;"
+                "add    %9,%6;"
+                "and    %5,%12;"
+                "and    %4,%10;"
+                "add    %11,%9;"
+                "or     %12,%10;"
+                "add    %10,%9;"
+                "mov    %6,%10;"
+                "ror    $0xe,%10;"
+                "mov    %9,%11;"
+                "xor    %6,%10;"
+                "ror    $0x9,%11;"
+                "mov    %k2,%12;"
+                "xor    %9,%11;"
+                "ror    $0x5,%10;"
+                "xor    %7,%12;"
+                "xor    %6,%10;"
+                "ror    $0xb,%11;"
+                "and    %6,%12;"
+                "xor    %9,%11;"
+                "ror    $0x6,%10;"
+                "xor    %7,%12;"
+                "add    %10,%12;"
+                "ror    $0x2,%11;"
+                "add    4(%13),%12;"
+                "mov    %9,%10;"
+                "add    %12,%8;"
+                "mov    %9,%12;"
+                "or     %4,%10;"
+                "add    %8,%5;"
+                "and    %4,%12;"
+                "and    %3,%10;"
+                "add    %11,%8;"
+                "or     %12,%10;"
+                "add    %10,%8;"
+                "mov    %5,%10;"
+                "ror    $0xe,%10;"
+                "mov    %8,%11;"
+                "xor    %5,%10;"
+                "ror    $0x9,%11;"
+                "mov    %6,%12;"
+                "xor    %8,%11;"
+                "ror    $0x5,%10;"
+                "xor    %k2,%12;"
+                "xor    %5,%10;"
+                "ror    $0xb,%11;"
+                "and    %5,%12;"
+                "xor    %8,%11;"
+                "ror    $0x6,%10;"
+                "xor    %k2,%12;"
+                "add    %10,%12;"
+                "ror    $0x2,%11;"
+                "add    8(%13),%12;"
+                "mov    %8,%10;"
+                "add    %12,%7;"
+                "mov    %8,%12;"
+                "or     %3,%10;"
+                "add    %7,%4;"
+                "and    %3,%12;"
+                "and    %9,%10;"
+                "add    %11,%7;"
+                "or     %12,%10;"
+                "add    %10,%7;"
+                "mov    %4,%10;"
+                "ror    $0xe,%10;"
+                "mov    %7,%11;"
+                "xor    %4,%10;"
+                "ror    $0x9,%11;"
+                "mov    %5,%12;"
+                "xor    %7,%11;"
+                "ror    $0x5,%10;"
+                "xor    %6,%12;"
+                "xor    %4,%10;"
+                "ror    $0xb,%11;"
+                "and    %4,%12;"
+                "xor    %7,%11;"
+                "ror    $0x6,%10;"
+                "xor    %6,%12;"
+                "add    %10,%12;"
+                "ror    $0x2,%11;"
+                "add    12(%13),%12;"
+                "mov    %7,%10;"
+                "add    %12,%k2;"
+                "mov    %7,%12;"
+                "or     %9,%10;"
+                "add    %k2,%3;"
+                "and    %9,%12;"
+                "and    %8,%10;"
+                "add    %11,%k2;"
+                "or     %12,%10;"
+                "add    %10,%k2;"
+                "mov    %3,%10;"
+                "ror    $0xe,%10;"
+                "mov    %k2,%11;"
+                "xor    %3,%10;"
+                "ror    $0x9,%11;"
+                "mov    %4,%12;"
+                "xor    %k2,%11;"
+                "ror    $0x5,%10;"
+                "xor    %5,%12;"
+                "xor    %3,%10;"
+                "ror    $0xb,%11;"
+                "and    %3,%12;"
+                "xor    %k2,%11;"
+                "ror    $0x6,%10;"
+                "xor    %5,%12;"
+                "add    %10,%12;"
+                "ror    $0x2,%11;"
+                "add    16(%13),%12;"
+                "mov    %k2,%10;"
+                "add    %12,%6;"
+                "mov    %k2,%12;"
+                "or     %8,%10;"
+                "add    %6,%9;"
+                "and    %8,%12;"
+                "and    %7,%10;"
+                "add    %11,%6;"
+                "or     %12,%10;"
+                "add    %10,%6;"
+                "mov    %9,%10;"
+                "ror    $0xe,%10;"
+                "mov    %6,%11;"
+                "xor    %9,%10;"
+                "ror    $0x9,%11;"
+                "mov    %3,%12;"
+                "xor    %6,%11;"
+                "ror    $0x5,%10;"
+                "xor    %4,%12;"
+                "xor    %9,%10;"
+                "ror    $0xb,%11;"
+                "and    %9,%12;"
+                "xor    %6,%11;"
+                "ror    $0x6,%10;"
+                "xor    %4,%12;"
+                "add    %10,%12;"
+                "ror    $0x2,%11;"
+                "add    20(%13),%12;"
+                "mov    %6,%10;"
+                "add    %12,%5;"
+                "mov    %6,%12;"
+                "or     %7,%10;"
+                "add    %5,%8;"
+                "and    %7,%12;"
+                "and    %k2,%10;"
+                "add    %11,%5;"
+                "or     %12,%10;"
+                "add    %10,%5;"
+                "mov    %8,%10;"
+                "ror    $0xe,%10;"
+                "mov    %5,%11;"
+                "xor    %8,%10;"
+                "ror    $0x9,%11;"
+                "mov    %9,%12;"
+                "xor    %5,%11;"
+                "ror    $0x5,%10;"
+                "xor    %3,%12;"
+                "xor    %8,%10;"
+                "ror    $0xb,%11;"
+                "and    %8,%12;"
+                "xor    %5,%11;"
+                "ror    $0x6,%10;"
+                "xor    %3,%12;"
+                "add    %10,%12;"
+                "ror    $0x2,%11;"
+                "add    24(%13),%12;"
+                "mov    %5,%10;"
+                "add    %12,%4;"
+                "mov    %5,%12;"
+                "or     %k2,%10;"
+                "add    %4,%7;"
+                "and    %k2,%12;"
+                "and    %6,%10;"
+                "add    %11,%4;"
+                "or     %12,%10;"
+                "add    %10,%4;"
+                "mov    %7,%10;"
+                "ror    $0xe,%10;"
+                "mov    %4,%11;"
+                "xor    %7,%10;"
+                "ror    $0x9,%11;"
+                "mov    %8,%12;"
+                "xor    %4,%11;"
+                "ror    $0x5,%10;"
+                "xor    %9,%12;"
+                "xor    %7,%10;"
+                "ror    $0xb,%11;"
+                "and    %7,%12;"
+                "xor    %4,%11;"
+                "ror    $0x6,%10;"
+                "xor    %9,%12;"
+                "add    %10,%12;"
+                "ror    $0x2,%11;"
+                "add    28(%13),%12;"
+                "mov    %4,%10;"
+                "add    %12,%3;"
+                "mov    %4,%12;"
+                "or     %6,%10;"
+                "add    %3,%k2;"
+                "and    %6,%12;"
+                "and    %5,%10;"
+                "add    %11,%3;"
+                "or     %12,%10;"
+                "add    %10,%3;"
+                "add    $0x20,%13;"
+                "sub    $0x1,%1;"
+                "jne    Lloop_%=;"
+                "add    (%0),%3;"
+                "mov    %3,(%0);"
+                "add    0x4(%0),%4;"
+                "mov    %4,0x4(%0);"
+                "add    0x8(%0),%5;"
+                "mov    %5,0x8(%0);"
+                "add    0xc(%0),%6;"
+                "mov    %6,0xc(%0);"
+                "add    0x10(%0),%k2;"
+                "mov    %k2,0x10(%0);"
+                "add    0x14(%0),%7;"
+                "mov    %7,0x14(%0);"
+                "add    0x18(%0),%8;"
+                "mov    %8,0x18(%0);"
+                "add    0x1c(%0),%9;"
+                "mov    %9,0x1c(%0);"
+
+                : "+r"(s), "=r"(n), "=r"(e), "=r"(a), "=r"(b), "=r"(c), "=r"(d), "=r"(f), "=r"(g), "=r"(h), "=r"(y0), "=r"(y1), "=r"(y2), "+r"(ks)
+                :
+                : "cc", "memory"
+        );
+}
+
 /*
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
 ; Copyright (c) 2012, Intel Corporation 
@@ -0,0 +1,151 @@
+/* Copyright (c) 2018-2019 The Bitcoin Core developers
+ * Copyright (c) 2022 Mark Friedenbach
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/* Multi-lane kernels written with the GCC/clang generic vector extension
+ * rather than with target intrinsics.  The compiler lowers the vector types
+ * to whatever the baseline instruction set of the target provides (SSE2 on
+ * x86-64, NEON on AArch64, VSX or AltiVec on POWER, and so on), or to scalar
+ * code where there is none.  This file is built without the per-extension
+ * CFLAGS used for the rest of the library, so these kernels are safe to run
+ * on any CPU of the architecture and need no runtime detection.
+ */
+
+#if defined(__GNUC__)
+
+#include <sha2/sha256.h>
+#include "sha256_internal.h"
+
+#include <stdint.h> /* for uint32_t */
+
+#include "common.h"
+
+#if !defined(__clang__)
+/* Only inlined helpers pass vec8 by value, so the note that this would be
+ * passed differently with AVX enabled is of no concern. */
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+typedef uint32_t vec4 __attribute__((vector_size(16)));
+typedef uint32_t vec8 __attribute__((vector_size(32)));
+
+static const vec4 zero4 = { 0 };
+static const vec8 zero8 = { 0 };
+
+static inline __attribute__((always_inline)) vec4 Read4(const unsigned char* chunk) {
+        vec4 v;
+        int i;
+        for (i = 0; i < 4; ++i)
+                v[i] = ReadBE32(chunk + 64 * i);
+        return v;
+}
+
+static inline __attribute__((always_inline)) void Write4(unsigned char *out, vec4 v) {
+        int i;
+        for (i = 0; i < 4; ++i)
+                WriteBE32(out + 32 * i, v[i]);
+}
+
+static inline __attribute__((always_inline)) vec4 Load4(const uint32_t* s, int j) {
+        vec4 v;
+        int i;
+        for (i = 0; i < 4; ++i)
+                v[i] = s[8 * i + j];
+        return v;
+}
+
+static inline __attribute__((always_inline)) void Store4(uint32_t* s, int j, vec4 v) {
+        int i;
+        for (i = 0; i < 4; ++i)
+                s[8 * i + j] = v[i];
+}
+
+static inline __attribute__((always_inline)) vec8 Read8(const unsigned char* chunk) {
+        vec8 v;
+        int i;
+        for (i = 0; i < 8; ++i)
+                v[i] = ReadBE32(chunk + 64 * i);
+        return v;
+}
+
+static inline __attribute__((always_inline)) void Write8(unsigned char *out, vec8 v) {
+        int i;
+        for (i = 0; i < 8; ++i)
+                WriteBE32(out + 32 * i, v[i]);
+}
+
+static inline __attribute__((always_inline)) vec8 Load8(const uint32_t* s, int j) {
+        vec8 v;
+        int i;
+        for (i = 0; i < 8; ++i)
+                v[i] = s[8 * i + j];
+        return v;
+}
+
+static inline __attribute__((always_inline)) void Store8(uint32_t* s, int j, vec8 v) {
+        int i;
+        for (i = 0; i < 8; ++i)
+                s[8 * i + j] = v[i];
+}
+
+/* 4-way */
+#define VEC vec4
+#define NWAY_LANES 4
+#define NWAY_SUFFIX vec4
+#define NWAY_MULTI transform_sha256multi_vec_4way
+#define NWAY_D64 transform_sha256d64_vec_4way
+#define NWAY_H64 transform_sha256h64_vec_4way
+#define NWAY_STATES transform_sha256states_vec_4way
+#define K(x) (zero4 + (uint32_t)(x))
+#define Add(x, y) ((x) + (y))
+#define Xor(x, y) ((x) ^ (y))
+#define Or(x, y) ((x) | (y))
+#define And(x, y) ((x) & (y))
+#define ShR(x, n) ((x) >> (n))
+#define ShL(x, n) ((x) << (n))
+#define ReadN Read4
+#define WriteN Write4
+#define LoadN Load4
+#define StoreN Store4
+#include "sha256_nway.h"
+#undef NWAY_SUFFIX
+#undef NWAY_LANES
+#undef VEC
+
+/* 8-way */
+#define VEC vec8
+#define NWAY_LANES 8
+#define NWAY_SUFFIX vec8
+#define NWAY_MULTI transform_sha256multi_vec_8way
+#define NWAY_D64 transform_sha256d64_vec_8way
+#define NWAY_H64 transform_sha256h64_vec_8way
+#define NWAY_STATES transform_sha256states_vec_8way
+#define K(x) (zero8 + (uint32_t)(x))
+#define Add(x, y) ((x) + (y))
+#define Xor(x, y) ((x) ^ (y))
+#define Or(x, y) ((x) | (y))
+#define And(x, y) ((x) & (y))
+#define ShR(x, n) ((x) >> (n))
+#define ShL(x, n) ((x) << (n))
+#define ReadN Read8
+#define WriteN Write8
+#define LoadN Load8
+#define StoreN Store8
+#include "sha256_nway.h"
+#undef NWAY_SUFFIX
+#undef NWAY_LANES
+#undef VEC
+
+#else
+/* -Wempty-translation-unit
+ * ISO C requires a translation unit to contain at least one declaration
+ */
+typedef int make_iso_compilers_happy;
+#endif
+
+/* End of File
+ */
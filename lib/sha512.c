@@ -0,0 +1,757 @@
+/* Copyright (c) 2014-2019 The Bitcoin Core developers
+ * Copyright (c) 2022 Mark Friedenbach
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <sha2/sha512.h>
+#include "common.h"
+
+#include <assert.h>
+#include <string.h>
+
+#if defined(HAVE_PTHREAD_ONCE)
+#include <pthread.h>
+#endif
+
+#include "compat/cpuid.h"
+
+#include "sha512_internal.h"
+
+static inline __attribute__((always_inline)) uint64_t Ch(uint64_t x, uint64_t y, uint64_t z) { return z ^ (x & (y ^ z)); }
+static inline __attribute__((always_inline)) uint64_t Maj(uint64_t x, uint64_t y, uint64_t z) { return (x & y) | (z & (x | y)); }
+static inline __attribute__((always_inline)) uint64_t Sigma0(uint64_t x) { return (x >> 28 | x << 36) ^ (x >> 34 | x << 30) ^ (x >> 39 | x << 25); }
+static inline __attribute__((always_inline)) uint64_t Sigma1(uint64_t x) { return (x >> 14 | x << 50) ^ (x >> 18 | x << 46) ^ (x >> 41 | x << 23); }
+static inline __attribute__((always_inline)) uint64_t sigma0(uint64_t x) { return (x >> 1 | x << 63) ^ (x >> 8 | x << 56) ^ (x >> 7); }
+static inline __attribute__((always_inline)) uint64_t sigma1(uint64_t x) { return (x >> 19 | x << 45) ^ (x >> 61 | x << 3) ^ (x >> 6); }
+
+/** One round of SHA-512. */
+static inline __attribute__((always_inline)) void Round(uint64_t a, uint64_t b, uint64_t c, uint64_t* d, uint64_t e, uint64_t f, uint64_t g, uint64_t* h, uint64_t k)
+{
+        uint64_t t1 = *h + Sigma1(e) + Ch(e, f, g) + k;
+        uint64_t t2 = Sigma0(a) + Maj(a, b, c);
+        *d += t1;
+        *h = t1 + t2;
+}
+
+const uint64_t sha512_K[80] = {
+        0x428a2f98d728ae22ull, 0x7137449123ef65cdull, 0xb5c0fbcfec4d3b2full,
+        0xe9b5dba58189dbbcull, 0x3956c25bf348b538ull, 0x59f111f1b605d019ull,
+        0x923f82a4af194f9bull, 0xab1c5ed5da6d8118ull, 0xd807aa98a3030242ull,
+        0x12835b0145706fbeull, 0x243185be4ee4b28cull, 0x550c7dc3d5ffb4e2ull,
+        0x72be5d74f27b896full, 0x80deb1fe3b1696b1ull, 0x9bdc06a725c71235ull,
+        0xc19bf174cf692694ull, 0xe49b69c19ef14ad2ull, 0xefbe4786384f25e3ull,
+        0x0fc19dc68b8cd5b5ull, 0x240ca1cc77ac9c65ull, 0x2de92c6f592b0275ull,
+        0x4a7484aa6ea6e483ull, 0x5cb0a9dcbd41fbd4ull, 0x76f988da831153b5ull,
+        0x983e5152ee66dfabull, 0xa831c66d2db43210ull, 0xb00327c898fb213full,
+        0xbf597fc7beef0ee4ull, 0xc6e00bf33da88fc2ull, 0xd5a79147930aa725ull,
+        0x06ca6351e003826full, 0x142929670a0e6e70ull, 0x27b70a8546d22ffcull,
+        0x2e1b21385c26c926ull, 0x4d2c6dfc5ac42aedull, 0x53380d139d95b3dfull,
+        0x650a73548baf63deull, 0x766a0abb3c77b2a8ull, 0x81c2c92e47edaee6ull,
+        0x92722c851482353bull, 0xa2bfe8a14cf10364ull, 0xa81a664bbc423001ull,
+        0xc24b8b70d0f89791ull, 0xc76c51a30654be30ull, 0xd192e819d6ef5218ull,
+        0xd69906245565a910ull, 0xf40e35855771202aull, 0x106aa07032bbd1b8ull,
+        0x19a4c116b8d2d0c8ull, 0x1e376c085141ab53ull, 0x2748774cdf8eeb99ull,
+        0x34b0bcb5e19b48a8ull, 0x391c0cb3c5c95a63ull, 0x4ed8aa4ae3418acbull,
+        0x5b9cca4f7763e373ull, 0x682e6ff3d6b2b8a3ull, 0x748f82ee5defb2fcull,
+        0x78a5636f43172f60ull, 0x84c87814a1f0ab72ull, 0x8cc702081a6439ecull,
+        0x90befffa23631e28ull, 0xa4506cebde82bde9ull, 0xbef9a3f7b2c67915ull,
+        0xc67178f2e372532bull, 0xca273eceea26619cull, 0xd186b8c721c0c207ull,
+        0xeada7dd6cde0eb1eull, 0xf57d4f7fee6ed178ull, 0x06f067aa72176fbaull,
+        0x0a637dc5a2c898a6ull, 0x113f9804bef90daeull, 0x1b710b35131c471bull,
+        0x28db77f523047d84ull, 0x32caab7b40c72493ull, 0x3c9ebe0a15c9bebcull,
+        0x431d67c49c100d4cull, 0x4cc5d4becb3e42b6ull, 0x597f299cfc657e2aull,
+        0x5fcb6fab3ad6faecull, 0x6c44198c4a475817ull,
+};
+
+/** Perform a number of SHA-512 transformations, processing 128-byte chunks. */
+static void transform_noasm(uint64_t* s, const unsigned char* chunk, size_t blocks)
+{
+        while (blocks--) {
+                uint64_t a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+                uint64_t w[16];
+                int i, j;
+
+                for (j = 0; j < 16; ++j) {
+                        w[j] = ReadBE64(chunk + 8 * j);
+                }
+
+                for (i = 0; i < 80; i += 16) {
+                        if (i) {
+                                /* Expand the next 16 words of the message
+                                 * schedule in place. */
+                                for (j = 0; j < 16; ++j) {
+                                        w[j] += sigma1(w[(j + 14) & 15]) + w[(j + 9) & 15] + sigma0(w[(j + 1) & 15]);
+                                }
+                        }
+                        Round(a, b, c, &d, e, f, g, &h, sha512_K[i + 0] + w[0]);
+                        Round(h, a, b, &c, d, e, f, &g, sha512_K[i + 1] + w[1]);
+                        Round(g, h, a, &b, c, d, e, &f, sha512_K[i + 2] + w[2]);
+                        Round(f, g, h, &a, b, c, d, &e, sha512_K[i + 3] + w[3]);
+                        Round(e, f, g, &h, a, b, c, &d, sha512_K[i + 4] + w[4]);
+                        Round(d, e, f, &g, h, a, b, &c, sha512_K[i + 5] + w[5]);
+                        Round(c, d, e, &f, g, h, a, &b, sha512_K[i + 6] + w[6]);
+                        Round(b, c, d, &e, f, g, h, &a, sha512_K[i + 7] + w[7]);
+                        Round(a, b, c, &d, e, f, g, &h, sha512_K[i + 8] + w[8]);
+                        Round(h, a, b, &c, d, e, f, &g, sha512_K[i + 9] + w[9]);
+                        Round(g, h, a, &b, c, d, e, &f, sha512_K[i + 10] + w[10]);
+                        Round(f, g, h, &a, b, c, d, &e, sha512_K[i + 11] + w[11]);
+                        Round(e, f, g, &h, a, b, c, &d, sha512_K[i + 12] + w[12]);
+                        Round(d, e, f, &g, h, a, b, &c, sha512_K[i + 13] + w[13]);
+                        Round(c, d, e, &f, g, h, a, &b, sha512_K[i + 14] + w[14]);
+                        Round(b, c, d, &e, f, g, h, &a, sha512_K[i + 15] + w[15]);
+                }
+
+                s[0] += a;
+                s[1] += b;
+                s[2] += c;
+                s[3] += d;
+                s[4] += e;
+                s[5] += f;
+                s[6] += g;
+                s[7] += h;
+                chunk += 128;
+        }
+}
+
+typedef void (*transform512_t)(uint64_t*, const unsigned char*, size_t);
+typedef void (*transform512_multi_t)(uint64_t*, const unsigned char* const*);
+
+/** The widest multi-lane kernel. */
+#define MAX_LANES 8
+
+/* Kernel selection */
+
+#if defined(SHA256_BACKEND_AVX2) && defined(ENABLE_BMI2)
+#define SHA512_BACKEND_NAME "avx2(1way,4way)"
+static const transform512_t transform = transform_sha512_avx2;
+static const transform512_multi_t transform_4way = transform_sha512multi_avx2_4way;
+static const transform512_multi_t transform_8way = NULL;
+#elif defined(SHA256_BACKEND_PINNED)
+/* The other pinned backends have no SHA-512 instructions to pin. */
+#define SHA512_BACKEND_NAME "standard"
+static const transform512_t transform = transform_noasm;
+static const transform512_multi_t transform_4way = NULL;
+static const transform512_multi_t transform_8way = NULL;
+#else
+static const char* backend_name = "standard";
+static transform512_t transform = transform_noasm;
+static transform512_multi_t transform_4way = NULL;
+static transform512_multi_t transform_8way = NULL;
+#endif
+
+#ifndef NDEBUG
+/** Check a multi-lane kernel against the portable code, with a different
+ * state and block in every lane. */
+static int self_test_multi(transform512_multi_t multi, const unsigned char data[256], int lanes)
+{
+        uint64_t expected[8 * MAX_LANES], got[8 * MAX_LANES];
+        const unsigned char* in[MAX_LANES];
+        int i;
+        for (i = 0; i < 8 * lanes; ++i) {
+                expected[i] = got[i] = sha512_K[i];
+        }
+        for (i = 0; i < lanes; ++i) {
+                in[i] = data + 13 * i;
+                transform_noasm(expected + 8 * i, in[i], 1);
+        }
+        multi(got, in);
+        return memcmp(expected, got, 64 * lanes) == 0;
+}
+
+/** Check the selected kernels against the portable code. */
+static int self_test(void)
+{
+        unsigned char data[256];
+        uint64_t expected[8], got[8];
+        int i;
+        for (i = 0; i < 256; ++i) {
+                data[i] = (unsigned char)(i * 7 + 1);
+        }
+        for (i = 0; i < 8; ++i) {
+                expected[i] = got[i] = sha512_K[i];
+        }
+        transform_noasm(expected, data, 2);
+        transform(got, data, 2);
+        if (memcmp(expected, got, sizeof(got))) {
+                return 0;
+        }
+        if (transform_4way && !self_test_multi(transform_4way, data, 4)) {
+                return 0;
+        }
+        if (transform_8way && !self_test_multi(transform_8way, data, 8)) {
+                return 0;
+        }
+        return 1;
+}
+#endif /* NDEBUG */
+
+#if defined(SHA256_BACKEND_PINNED)
+const char* sha512_auto_detect(void)
+{
+        assert(self_test());
+        return SHA512_BACKEND_NAME;
+}
+#else /* SHA256_BACKEND_PINNED */
+#if defined(HAVE_GETCPUID) && (defined(__x86_64__) || defined(__amd64__))
+/** Check whether the OS has enabled AVX registers, and AVX-512 registers as
+ * well if mask is 0xe6. */
+static int XCR0Enabled(uint32_t mask)
+{
+        uint32_t a, d;
+        __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+        return (a & mask) == mask;
+}
+#endif
+
+/** Pick the fastest kernels the host supports. */
+static void detect(void)
+{
+#if defined(HAVE_GETCPUID) && (defined(__x86_64__) || defined(__amd64__))
+        uint32_t eax = 0, ebx = 0, ecx = 0, edx = 0;
+        int have_avx = 0;
+        int have_avx2 = 0;
+        int have_bmi2 = 0;
+        int have_avx512 = 0;
+
+        (void)have_avx2;
+        (void)have_bmi2;
+        (void)have_avx512;
+
+        GetCPUID(1, 0, &eax, &ebx, &ecx, &edx);
+        have_avx = ((ecx >> 27) & 1) && ((ecx >> 28) & 1) && XCR0Enabled(6);
+        if (have_avx) {
+                GetCPUID(7, 0, &eax, &ebx, &ecx, &edx);
+                have_avx2 = (ebx >> 5) & 1;
+                have_bmi2 = (ebx >> 8) & 1;
+                have_avx512 = ((ebx >> 16) & 1) && XCR0Enabled(0xe6);
+        }
+
+#if defined(ENABLE_AVX2) && defined(ENABLE_BMI2)
+        if (have_avx2 && have_bmi2) {
+                transform = transform_sha512_avx2;
+                transform_4way = transform_sha512multi_avx2_4way;
+                backend_name = "avx2(1way,4way)";
+        }
+#endif
+#if defined(ENABLE_AVX512)
+        if (have_avx512) {
+                transform_8way = transform_sha512multi_avx512_8way;
+                backend_name = transform_4way ? "avx2(1way,4way),avx512(8way)" : "standard,avx512(8way)";
+        }
+#endif
+#endif
+        assert(self_test());
+}
+
+static int detected = 0;
+
+static void run_detect(void)
+{
+        if (!detected) {
+                detect();
+                detected = !0;
+        }
+}
+
+#if defined(HAVE_PTHREAD_ONCE)
+static pthread_once_t detect_once = PTHREAD_ONCE_INIT;
+#endif
+
+/** Make sure backend detection has completed, racing threads included. */
+static inline void sha512_init_once(void)
+{
+#if defined(HAVE_PTHREAD_ONCE)
+        pthread_once(&detect_once, run_detect);
+#else
+        run_detect();
+#endif
+}
+
+#if defined(__GNUC__)
+/** Detect before main(), as sha256_load() does. */
+static void __attribute__((constructor)) sha512_load(void)
+{
+        sha512_init_once();
+}
+#endif
+
+const char* sha512_auto_detect(void)
+{
+        sha512_init_once();
+        return backend_name;
+}
+#endif /* SHA256_BACKEND_PINNED */
+
+/* SHA-512 */
+
+static const struct sha512_ctx sha512_initial = SHA512_INIT;
+static const struct sha512_ctx sha384_initial = SHA384_INIT;
+static const struct sha512_ctx sha512_256_initial = SHA512_256_INIT;
+static const struct sha512_ctx sha512_224_initial = SHA512_224_INIT;
+
+void sha512_init(struct sha512_ctx* ctx)
+{
+        assert(ctx);
+        *ctx = sha512_initial;
+}
+
+void sha384_init(struct sha512_ctx* ctx)
+{
+        assert(ctx);
+        *ctx = sha384_initial;
+}
+
+void sha512_256_init(struct sha512_ctx* ctx)
+{
+        assert(ctx);
+        *ctx = sha512_256_initial;
+}
+
+void sha512_224_init(struct sha512_ctx* ctx)
+{
+        assert(ctx);
+        *ctx = sha512_224_initial;
+}
+
+static void sha512_update_impl(struct sha512_ctx* ctx, const void *_data, size_t len)
+{
+        const unsigned char* data = (const unsigned char*)_data;
+        const unsigned char* end = data + len;
+        size_t bufsize = ctx->bytes % 128;
+        if (bufsize && bufsize + len >= 128) {
+                /* Fill the buffer, and process it. */
+                memcpy(ctx->buf.u8 + bufsize, data, 128 - bufsize);
+                ctx->bytes += 128 - bufsize;
+                data += 128 - bufsize;
+                transform(ctx->s, ctx->buf.u8, 1);
+                bufsize = 0;
+        }
+        if (end - data >= 128) {
+                size_t blocks = (end - data) / 128;
+                transform(ctx->s, data, blocks);
+                data += 128 * blocks;
+                ctx->bytes += 128 * blocks;
+        }
+        if (end > data) {
+                /* Fill the buffer with what remains. */
+                memcpy(ctx->buf.u8 + bufsize, data, end - data);
+                ctx->bytes += end - data;
+        }
+}
+
+/** Hash the padding and the 128-bit message length, leaving the final state
+ * in ctx->s. */
+static void sha512_pad(struct sha512_ctx* ctx)
+{
+        size_t bufsize = ctx->bytes % 128;
+        ctx->buf.u8[bufsize] = 0x80;
+        if (bufsize >= 112) {
+                memset(ctx->buf.u8 + bufsize + 1, 0, 127 - bufsize);
+                transform(ctx->s, ctx->buf.u8, 1);
+                bufsize = 0;
+        } else {
+                ++bufsize;
+        }
+        memset(ctx->buf.u8 + bufsize, 0, 112 - bufsize);
+        WriteBE64(ctx->buf.u8 + 112, (uint64_t)ctx->bytes >> 61);
+        WriteBE64(ctx->buf.u8 + 120, (uint64_t)ctx->bytes << 3);
+        transform(ctx->s, ctx->buf.u8, 1);
+}
+
+/** Write the first size bytes of the big-endian digest of state s. */
+static void sha512_write(unsigned char* out, const uint64_t s[8], size_t size)
+{
+        unsigned char digest[64];
+        int i;
+        for (i = 0; i < 8; ++i) {
+                WriteBE64(digest + 8 * i, s[i]);
+        }
+        memcpy(out, digest, size);
+}
+
+/** Pad a message of at most 239 bytes into one or two blocks on the stack and
+ * hash it from the initial state in s, leaving the final state in s. */
+static void sha512_short(uint64_t s[8], const unsigned char* data, size_t len)
+{
+        unsigned char buf[256];
+        size_t blocks = len < 112 ? 1 : 2;
+        assert(len < 240);
+        if (len) {
+                memcpy(buf, data, len);
+        }
+        buf[len] = 0x80;
+        memset(buf + len + 1, 0, 128 * blocks - 9 - len);
+        WriteBE64(buf + 128 * blocks - 8, (uint64_t)len << 3);
+        transform(s, buf, blocks);
+}
+
+static void sha512_done_impl(struct sha512* hash, struct sha512_ctx* ctx)
+{
+        sha512_pad(ctx);
+        sha512_write(hash->u8, ctx->s, 64);
+}
+
+static void sha384_done_impl(struct sha384* hash, struct sha512_ctx* ctx)
+{
+        sha512_pad(ctx);
+        sha512_write(hash->u8, ctx->s, 48);
+}
+
+static void sha512_256_done_impl(struct sha512_256* hash, struct sha512_ctx* ctx)
+{
+        sha512_pad(ctx);
+        sha512_write(hash->u8, ctx->s, 32);
+}
+
+static void sha512_224_done_impl(struct sha512_224* hash, struct sha512_ctx* ctx)
+{
+        sha512_pad(ctx);
+        sha512_write(hash->u8, ctx->s, 28);
+}
+
+/** Hash a message from the initial state in init, and write the first size
+ * bytes of its digest. */
+static void sha512_oneshot(unsigned char* out, size_t size, const struct sha512_ctx* init, const void* data, size_t len)
+{
+        struct sha512_ctx ctx = *init;
+        if (len < 240) {
+                sha512_short(ctx.s, (const unsigned char*)data, len);
+        } else {
+                sha512_update_impl(&ctx, data, len);
+                sha512_pad(&ctx);
+        }
+        sha512_write(out, ctx.s, size);
+}
+
+static void sha512_impl(struct sha512* hash, const void* data, size_t len)
+{
+        sha512_oneshot(hash->u8, 64, &sha512_initial, data, len);
+}
+
+static void sha384_impl(struct sha384* hash, const void* data, size_t len)
+{
+        sha512_oneshot(hash->u8, 48, &sha384_initial, data, len);
+}
+
+static void sha512_256_impl(struct sha512_256* hash, const void* data, size_t len)
+{
+        sha512_oneshot(hash->u8, 32, &sha512_256_initial, data, len);
+}
+
+static void sha512_224_impl(struct sha512_224* hash, const void* data, size_t len)
+{
+        sha512_oneshot(hash->u8, 28, &sha512_224_initial, data, len);
+}
+
+/* Batches */
+
+/** Hash up to lanes messages side by side with a multi-lane kernel, all from
+ * the initial state in init, and write the first size bytes of each digest
+ * to out + size * i.  The full blocks are read in place; only the last one
+ * or two blocks of each message are copied, to be padded. */
+static void sha512_lanes(unsigned char* out, size_t size, const struct sha512_ctx* init, const void* const msg[], const size_t len[], size_t n, size_t lanes, transform512_multi_t multi)
+{
+        unsigned char tail[MAX_LANES][256];
+        uint64_t s[8 * MAX_LANES];
+        const unsigned char* in[MAX_LANES];
+        size_t full[MAX_LANES], blocks[MAX_LANES];
+        size_t i, b, rounds = 0;
+        for (i = 0; i < lanes; ++i) {
+                size_t l = i < n ? len[i] : 0;
+                size_t rest = l % 128;
+                full[i] = l / 128;
+                blocks[i] = full[i] + (rest < 112 ? 1 : 2);
+                if (rest) {
+                        memcpy(tail[i], (const unsigned char*)msg[i] + 128 * full[i], rest);
+                }
+                tail[i][rest] = 0x80;
+                memset(tail[i] + rest + 1, 0, 128 * (blocks[i] - full[i]) - 9 - rest);
+                WriteBE64(tail[i] + 128 * (blocks[i] - full[i]) - 8, (uint64_t)l << 3);
+                memcpy(s + 8 * i, init->s, sizeof(init->s));
+                if (i < n && blocks[i] > rounds) {
+                        rounds = blocks[i];
+                }
+        }
+        for (b = 0; b < rounds; ++b) {
+                for (i = 0; i < lanes; ++i) {
+                        if (b < full[i]) {
+                                in[i] = (const unsigned char*)msg[i] + 128 * b;
+                        } else if (b < blocks[i]) {
+                                in[i] = tail[i] + 128 * (b - full[i]);
+                        } else {
+                                /* Finished or unused: any block will do. */
+                                in[i] = tail[i];
+                        }
+                }
+                multi(s, in);
+                for (i = 0; i < n; ++i) {
+                        if (b + 1 == blocks[i]) {
+                                sha512_write(out + size * i, s + 8 * i, size);
+                        }
+                }
+        }
+}
+
+/** Hash n messages, as many at a time as the widest kernel allows. */
+static void sha512_batch_any(unsigned char* out, size_t size, const struct sha512_ctx* init, const void* const msg[], const size_t len[], size_t n)
+{
+        if (transform_8way) {
+                while (n >= 8) {
+                        sha512_lanes(out, size, init, msg, len, 8, 8, transform_8way);
+                        out += 8 * size;
+                        msg += 8;
+                        len += 8;
+                        n -= 8;
+                }
+        }
+        if (transform_4way) {
+                while (n >= 4) {
+                        sha512_lanes(out, size, init, msg, len, 4, 4, transform_4way);
+                        out += 4 * size;
+                        msg += 4;
+                        len += 4;
+                        n -= 4;
+                }
+        }
+        while (n) {
+                sha512_oneshot(out, size, init, *msg, *len);
+                out += size;
+                ++msg;
+                ++len;
+                --n;
+        }
+}
+
+static void sha512_batch_impl(struct sha512 out[], const void* const msg[], const size_t len[], size_t n)
+{
+        sha512_batch_any(out->u8, 64, &sha512_initial, msg, len, n);
+}
+
+static void sha384_batch_impl(struct sha384 out[], const void* const msg[], const size_t len[], size_t n)
+{
+        sha512_batch_any(out->u8, 48, &sha384_initial, msg, len, n);
+}
+
+static void sha512_256_batch_impl(struct sha512_256 out[], const void* const msg[], const size_t len[], size_t n)
+{
+        sha512_batch_any(out->u8, 32, &sha512_256_initial, msg, len, n);
+}
+
+static void sha512_224_batch_impl(struct sha512_224 out[], const void* const msg[], const size_t len[], size_t n)
+{
+        sha512_batch_any(out->u8, 28, &sha512_224_initial, msg, len, n);
+}
+
+/* HMAC-SHA512 */
+
+static void sha512_hmac_key_init_impl(struct sha512_hmac_key* key, const void* secret, size_t len)
+{
+        unsigned char block[128];
+        size_t i;
+        assert(key);
+        if (len > 128) {
+                /* Longer keys are replaced by their hash. */
+                sha512_oneshot(block, 64, &sha512_initial, secret, len);
+                len = 64;
+        } else if (len) {
+                memcpy(block, secret, len);
+        }
+        memset(block + len, 0, 128 - len);
+        for (i = 0; i < 128; ++i) {
+                block[i] ^= 0x36;
+        }
+        memcpy(key->inner, sha512_initial.s, sizeof(key->inner));
+        transform(key->inner, block, 1);
+        for (i = 0; i < 128; ++i) {
+                block[i] ^= 0x36 ^ 0x5c;
+        }
+        memcpy(key->outer, sha512_initial.s, sizeof(key->outer));
+        transform(key->outer, block, 1);
+}
+
+/** Write the block the outer hash compresses after the key: the inner digest
+ * and the padding for a 192-byte message. */
+static void sha512_hmac_block(unsigned char block[128], const uint64_t s[8])
+{
+        int i;
+        for (i = 0; i < 8; ++i) {
+                WriteBE64(block + 8 * i, s[i]);
+        }
+        block[64] = 0x80;
+        memset(block + 65, 0, 55);
+        WriteBE64(block + 120, 192 << 3);
+}
+
+static void sha512_hmac_impl(struct sha512* hash, const struct sha512_hmac_key* key, const void* msg, size_t len)
+{
+        struct sha512_ctx ctx;
+        memcpy(ctx.s, key->inner, sizeof(ctx.s));
+        ctx.bytes = 128;
+        sha512_update_impl(&ctx, msg, len);
+        sha512_pad(&ctx);
+        sha512_hmac_block(ctx.buf.u8, ctx.s);
+        memcpy(ctx.s, key->outer, sizeof(ctx.s));
+        transform(ctx.s, ctx.buf.u8, 1);
+        sha512_write(hash->u8, ctx.s, 64);
+}
+
+/* PBKDF2-HMAC-SHA512 */
+
+/** Run the remaining iterations of up to MAX_LANES PBKDF2 output blocks side
+ * by side, as sha256_pbkdf2_lanes() does for SHA256.  Lane i starts from the
+ * first iterate u + 8 * i under key[i], and leaves the sum of all its iterates
+ * in t + 8 * i.  The inner and outer blocks are both 192-byte messages with
+ * the same padding, so each step only rewrites the leading digest. */
+static void sha512_pbkdf2_lanes(uint64_t t[8 * MAX_LANES], const uint64_t u[8 * MAX_LANES], const struct sha512_hmac_key key[], uint64_t iterations, size_t lanes, transform512_multi_t multi)
+{
+        unsigned char block[MAX_LANES][128];
+        const unsigned char* in[MAX_LANES];
+        uint64_t s[8 * MAX_LANES];
+        size_t i, j;
+        for (i = 0; i < lanes; ++i) {
+                sha512_hmac_block(block[i], u + 8 * i);
+                in[i] = block[i];
+        }
+        memcpy(t, u, 8 * lanes * sizeof(uint64_t));
+        while (--iterations) {
+                for (i = 0; i < lanes; ++i) {
+                        memcpy(s + 8 * i, key[i].inner, sizeof(key[i].inner));
+                }
+                if (multi) {
+                        multi(s, in);
+                } else {
+                        transform(s, block[0], 1);
+                }
+                for (i = 0; i < lanes; ++i) {
+                        for (j = 0; j < 8; ++j) {
+                                WriteBE64(block[i] + 8 * j, s[8 * i + j]);
+                        }
+                        memcpy(s + 8 * i, key[i].outer, sizeof(key[i].outer));
+                }
+                if (multi) {
+                        multi(s, in);
+                } else {
+                        transform(s, block[0], 1);
+                }
+                for (i = 0; i < lanes; ++i) {
+                        for (j = 0; j < 8; ++j) {
+                                t[8 * i + j] ^= s[8 * i + j];
+                                WriteBE64(block[i] + 8 * j, s[8 * i + j]);
+                        }
+                }
+        }
+}
+
+static int sha512_pbkdf2_batch_impl(unsigned char* const out[], size_t outlen, const void* const password[], const size_t pwlen[], const void* const salt[], const size_t saltlen[], size_t n, uint64_t iterations)
+{
+        struct sha512_hmac_key key[MAX_LANES];
+        uint64_t u[8 * MAX_LANES], t[8 * MAX_LANES];
+        size_t blocks = (outlen + 63) / 64;
+        size_t i, job = 0;
+        if (!iterations) {
+                /* As for SHA-256: RFC 8018 requires a positive count. */
+                return -1;
+        }
+        if (outlen && (uint64_t)(outlen - 1) / 64 >= 0xffffffff) {
+                /* Nor may the 32-bit block index wrap. */
+                return -1;
+        }
+        /* Job j is output block j % blocks of password j / blocks. */
+        while (job < n * blocks) {
+                transform512_multi_t multi = NULL;
+                size_t lanes = 1;
+                if (transform_8way && n * blocks - job >= 8) {
+                        multi = transform_8way;
+                        lanes = 8;
+                } else if (transform_4way && n * blocks - job >= 4) {
+                        multi = transform_4way;
+                        lanes = 4;
+                }
+                for (i = 0; i < lanes; ++i) {
+                        size_t p = (job + i) / blocks;
+                        unsigned char index[4];
+                        struct sha512_ctx ctx;
+                        if (i && (job + i - 1) / blocks == p) {
+                                key[i] = key[i - 1];
+                        } else {
+                                sha512_hmac_key_init_impl(&key[i], password[p], pwlen[p]);
+                        }
+                        /* The first iterate is the HMAC of the salt and the
+                         * big-endian block index, counting from one. */
+                        memcpy(ctx.s, key[i].inner, sizeof(ctx.s));
+                        ctx.bytes = 128;
+                        sha512_update_impl(&ctx, salt[p], saltlen[p]);
+                        WriteBE32(index, (uint32_t)((job + i) % blocks + 1));
+                        sha512_update_impl(&ctx, index, 4);
+                        sha512_pad(&ctx);
+                        sha512_hmac_block(ctx.buf.u8, ctx.s);
+                        memcpy(u + 8 * i, key[i].outer, sizeof(key[i].outer));
+                        transform(u + 8 * i, ctx.buf.u8, 1);
+                }
+                sha512_pbkdf2_lanes(t, u, key, iterations, lanes, multi);
+                for (i = 0; i < lanes; ++i) {
+                        size_t p = (job + i) / blocks;
+                        size_t b = (job + i) % blocks;
+                        sha512_write(out[p] + 64 * b, t + 8 * i, outlen - 64 * b < 64 ? outlen - 64 * b : 64);
+                }
+                job += lanes;
+        }
+        return 0;
+}
+
+static int sha512_pbkdf2_impl(unsigned char* out, size_t outlen, const void* password, size_t pwlen, const void* salt, size_t saltlen, uint64_t iterations)
+{
+        return sha512_pbkdf2_batch_impl(&out, outlen, &password, &pwlen, &salt, &saltlen, 1, iterations);
+}
+
+/* Dispatch */
+
+#if defined(SHA256_BACKEND_PINNED)
+#define DISPATCH(name, params, args)                                          \
+        void name params                                                      \
+        {                                                                     \
+                name##_impl args;                                             \
+        }
+#define DISPATCH_INT(name, params, args)                                      \
+        int name params                                                       \
+        {                                                                     \
+                return name##_impl args;                                      \
+        }
+#else
+#define DISPATCH(name, params, args)                                          \
+        void name params                                                      \
+        {                                                                     \
+                sha512_init_once();                                           \
+                name##_impl args;                                             \
+        }
+#define DISPATCH_INT(name, params, args)                                      \
+        int name params                                                       \
+        {                                                                     \
+                sha512_init_once();                                           \
+                return name##_impl args;                                      \
+        }
+#endif
+
+DISPATCH(sha512_update, (struct sha512_ctx* ctx, const void* data, size_t len), (ctx, data, len))
+DISPATCH(sha512_done, (struct sha512* hash, struct sha512_ctx* ctx), (hash, ctx))
+DISPATCH(sha512, (struct sha512* hash, const void* data, size_t len), (hash, data, len))
+DISPATCH(sha384_done, (struct sha384* hash, struct sha512_ctx* ctx), (hash, ctx))
+DISPATCH(sha384, (struct sha384* hash, const void* data, size_t len), (hash, data, len))
+DISPATCH(sha512_batch, (struct sha512 out[], const void* const msg[], const size_t len[], size_t n), (out, msg, len, n))
+DISPATCH(sha384_batch, (struct sha384 out[], const void* const msg[], const size_t len[], size_t n), (out, msg, len, n))
+DISPATCH(sha512_256_done, (struct sha512_256* hash, struct sha512_ctx* ctx), (hash, ctx))
+DISPATCH(sha512_256, (struct sha512_256* hash, const void* data, size_t len), (hash, data, len))
+DISPATCH(sha512_224_done, (struct sha512_224* hash, struct sha512_ctx* ctx), (hash, ctx))
+DISPATCH(sha512_224, (struct sha512_224* hash, const void* data, size_t len), (hash, data, len))
+DISPATCH(sha512_256_batch, (struct sha512_256 out[], const void* const msg[], const size_t len[], size_t n), (out, msg, len, n))
+DISPATCH(sha512_224_batch, (struct sha512_224 out[], const void* const msg[], const size_t len[], size_t n), (out, msg, len, n))
+DISPATCH(sha512_hmac_key_init, (struct sha512_hmac_key* key, const void* secret, size_t len), (key, secret, len))
+DISPATCH(sha512_hmac, (struct sha512* hash, const struct sha512_hmac_key* key, const void* msg, size_t len), (hash, key, msg, len))
+DISPATCH_INT(sha512_pbkdf2, (unsigned char* out, size_t outlen, const void* password, size_t pwlen, const void* salt, size_t saltlen, uint64_t iterations), (out, outlen, password, pwlen, salt, saltlen, iterations))
+DISPATCH_INT(sha512_pbkdf2_batch, (unsigned char* const out[], size_t outlen, const void* const password[], const size_t pwlen[], const void* const salt[], const size_t saltlen[], size_t n, uint64_t iterations), (out, outlen, password, pwlen, salt, saltlen, n, iterations))
+
+/* End of File
+ */
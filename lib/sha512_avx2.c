@@ -0,0 +1,171 @@
+/* Copyright (c) 2022 Mark Friedenbach
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#if (defined(__x86_64__) || defined(__amd64__)) && defined(__AVX2__) && defined(__BMI2__)
+
+#include <sha2/sha512.h>
+#include "sha512_internal.h"
+
+#include <stdint.h> /* for uint64_t */
+#include <immintrin.h> /* for assembly intrinsics */
+
+#include "common.h"
+
+/* A single SHA-512 stream: the message schedule is computed four words at a
+ * time in AVX2 registers, and the rounds run on the scalar unit, where BMI2
+ * lets the compiler use the flag-free rorx for every rotate. */
+
+static inline __attribute__((always_inline)) uint64_t Ch(uint64_t x, uint64_t y, uint64_t z) { return z ^ (x & (y ^ z)); }
+static inline __attribute__((always_inline)) uint64_t Maj(uint64_t x, uint64_t y, uint64_t z) { return (x & y) | (z & (x | y)); }
+static inline __attribute__((always_inline)) uint64_t Sigma0(uint64_t x) { return (x >> 28 | x << 36) ^ (x >> 34 | x << 30) ^ (x >> 39 | x << 25); }
+static inline __attribute__((always_inline)) uint64_t Sigma1(uint64_t x) { return (x >> 14 | x << 50) ^ (x >> 18 | x << 46) ^ (x >> 41 | x << 23); }
+
+/** One round of SHA-512. */
+static inline __attribute__((always_inline)) void Round(uint64_t a, uint64_t b, uint64_t c, uint64_t* d, uint64_t e, uint64_t f, uint64_t g, uint64_t* h, uint64_t k)
+{
+        uint64_t t1 = *h + Sigma1(e) + Ch(e, f, g) + k;
+        uint64_t t2 = Sigma0(a) + Maj(a, b, c);
+        *d += t1;
+        *h = t1 + t2;
+}
+
+#define Rotr4(x, n) _mm256_or_si256(_mm256_srli_epi64((x), (n)), _mm256_slli_epi64((x), 64 - (n)))
+#define Rotr2(x, n) _mm_or_si128(_mm_srli_epi64((x), (n)), _mm_slli_epi64((x), 64 - (n)))
+
+static inline __attribute__((always_inline)) __m256i sigma0_4(__m256i x) { return _mm256_xor_si256(_mm256_xor_si256(Rotr4(x, 1), Rotr4(x, 8)), _mm256_srli_epi64(x, 7)); }
+static inline __attribute__((always_inline)) __m128i sigma1_2(__m128i x) { return _mm_xor_si128(_mm_xor_si128(Rotr2(x, 19), Rotr2(x, 61)), _mm_srli_epi64(x, 6)); }
+
+/** Concatenate x and y and extract the four words starting at word 1, i.e.
+ * the window of the message schedule one word further along. */
+static inline __attribute__((always_inline)) __m256i Next(__m256i x, __m256i y) { return _mm256_alignr_epi8(_mm256_permute2x128_si256(x, y, 0x21), x, 8); }
+
+/** Compute the next four words of the message schedule from the last sixteen,
+ * held in w0 (oldest) through w3, and store them with the round constants
+ * added. */
+static inline __attribute__((always_inline)) __m256i Schedule(uint64_t* wk, const uint64_t* k, __m256i w0, __m256i w1, __m256i w2, __m256i w3)
+{
+        __m256i v = _mm256_add_epi64(_mm256_add_epi64(w0, sigma0_4(Next(w0, w1))), Next(w2, w3));
+        /* w[t+2] and w[t+3] depend on w[t] and w[t+1] through sigma1, so that
+         * term is added one 128-bit half at a time. */
+        __m128i lo = _mm_add_epi64(_mm256_castsi256_si128(v), sigma1_2(_mm256_extracti128_si256(w3, 1)));
+        __m128i hi = _mm_add_epi64(_mm256_extracti128_si256(v, 1), sigma1_2(lo));
+        v = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+        _mm256_storeu_si256((__m256i*)wk, _mm256_add_epi64(v, _mm256_loadu_si256((const __m256i*)k)));
+        return v;
+}
+
+void transform_sha512_avx2(uint64_t* s, const unsigned char* chunk, size_t blocks)
+{
+        const __m256i bswap = _mm256_set_epi64x(
+                0x08090a0b0c0d0e0fll, 0x0001020304050607ll,
+                0x08090a0b0c0d0e0fll, 0x0001020304050607ll);
+        uint64_t wk[80];
+        while (blocks--) {
+                uint64_t a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+                __m256i w0, w1, w2, w3, w4;
+                int i;
+
+                w0 = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(chunk + 0)), bswap);
+                w1 = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(chunk + 32)), bswap);
+                w2 = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(chunk + 64)), bswap);
+                w3 = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(chunk + 96)), bswap);
+                _mm256_storeu_si256((__m256i*)(wk + 0), _mm256_add_epi64(w0, _mm256_loadu_si256((const __m256i*)(sha512_K + 0))));
+                _mm256_storeu_si256((__m256i*)(wk + 4), _mm256_add_epi64(w1, _mm256_loadu_si256((const __m256i*)(sha512_K + 4))));
+                _mm256_storeu_si256((__m256i*)(wk + 8), _mm256_add_epi64(w2, _mm256_loadu_si256((const __m256i*)(sha512_K + 8))));
+                _mm256_storeu_si256((__m256i*)(wk + 12), _mm256_add_epi64(w3, _mm256_loadu_si256((const __m256i*)(sha512_K + 12))));
+
+                /* The schedule runs sixteen words ahead of the rounds, so the
+                 * vector and scalar work can overlap. */
+                for (i = 0; i < 80; i += 8) {
+                        if (i < 64) {
+                                w4 = Schedule(wk + i + 16, sha512_K + i + 16, w0, w1, w2, w3);
+                                w0 = w1; w1 = w2; w2 = w3; w3 = w4;
+                        }
+                        Round(a, b, c, &d, e, f, g, &h, wk[i + 0]);
+                        Round(h, a, b, &c, d, e, f, &g, wk[i + 1]);
+                        Round(g, h, a, &b, c, d, e, &f, wk[i + 2]);
+                        Round(f, g, h, &a, b, c, d, &e, wk[i + 3]);
+                        if (i < 64) {
+                                w4 = Schedule(wk + i + 20, sha512_K + i + 20, w0, w1, w2, w3);
+                                w0 = w1; w1 = w2; w2 = w3; w3 = w4;
+                        }
+                        Round(e, f, g, &h, a, b, c, &d, wk[i + 4]);
+                        Round(d, e, f, &g, h, a, b, &c, wk[i + 5]);
+                        Round(c, d, e, &f, g, h, a, &b, wk[i + 6]);
+                        Round(b, c, d, &e, f, g, h, &a, wk[i + 7]);
+                }
+
+                s[0] += a;
+                s[1] += b;
+                s[2] += c;
+                s[3] += d;
+                s[4] += e;
+                s[5] += f;
+                s[6] += g;
+                s[7] += h;
+                chunk += 128;
+        }
+}
+
+/* Four independent streams, one per 64-bit lane.  The file is built with
+ * BMI2 enabled, so this kernel is only selected alongside the one above. */
+
+#define VEC __m256i
+#define NWAY_LANES 4
+#define NWAY_SUFFIX avx2
+#define NWAY_MULTI transform_sha512multi_avx2_4way
+#define K(x) _mm256_set1_epi64x((long long)(x))
+#define Add(x, y) _mm256_add_epi64((x), (y))
+#define Xor(x, y) _mm256_xor_si256((x), (y))
+#define Or(x, y) _mm256_or_si256((x), (y))
+#define And(x, y) _mm256_and_si256((x), (y))
+#define ShR(x, n) _mm256_srli_epi64((x), (n))
+#define ShL(x, n) _mm256_slli_epi64((x), (n))
+#define ReadN Read4
+#define LoadN Load4
+#define StoreN Store4
+
+/** Gather word n of each lane's block.  The blocks are unrelated objects, so
+ * rather than subtract their pointers the gather takes absolute addresses as
+ * indices from a zero base. */
+static inline __attribute__((always_inline)) __m256i Read4(const unsigned char* const in[4], int n)
+{
+        const __m256i bswap = _mm256_set_epi64x(
+                0x08090a0b0c0d0e0fll, 0x0001020304050607ll,
+                0x08090a0b0c0d0e0fll, 0x0001020304050607ll);
+        const __m256i addresses = _mm256_set_epi64x(
+                (long long)(uintptr_t)(in[3] + n), (long long)(uintptr_t)(in[2] + n),
+                (long long)(uintptr_t)(in[1] + n), (long long)(uintptr_t)(in[0] + n));
+        return _mm256_shuffle_epi8(_mm256_i64gather_epi64((const long long*)0, addresses, 1), bswap);
+}
+
+static inline __attribute__((always_inline)) __m256i Load4(const uint64_t* s, int j)
+{
+        return _mm256_i64gather_epi64((const long long*)(s + j), _mm256_set_epi64x(24, 16, 8, 0), 8);
+}
+
+static inline __attribute__((always_inline)) void Store4(uint64_t* s, int j, __m256i v)
+{
+        uint64_t tmp[4];
+        _mm256_storeu_si256((__m256i*)tmp, v);
+        s[j] = tmp[0];
+        s[8 + j] = tmp[1];
+        s[16 + j] = tmp[2];
+        s[24 + j] = tmp[3];
+}
+
+#include "sha512_nway.h"
+
+#else
+/* -Wempty-translation-unit
+ * ISO C requires a translation unit to contain at least one declaration
+ */
+typedef int make_iso_compilers_happy;
+#endif
+
+/* End of File
+ */
@@ -0,0 +1,26 @@
+/* Copyright (c) 2014-2018 The Bitcoin Core developers
+ * Copyright (c) 2022 Mark Friedenbach
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef SHA2__SHA512_INTERNAL_H
+#define SHA2__SHA512_INTERNAL_H
+
+#include <sha2/sha512.h>
+
+/** The SHA-512 round constants, shared by all kernels. */
+extern const uint64_t sha512_K[80];
+
+#if defined(__x86_64__) || defined(__amd64__)
+extern void transform_sha512_avx2(uint64_t* s, const unsigned char* chunk, size_t blocks);
+extern void transform_sha512multi_avx2_4way(uint64_t s[32], const unsigned char* const in[4]);
+extern void transform_sha512multi_avx512_8way(uint64_t s[64], const unsigned char* const in[8]);
+#endif
+
+#endif /* SHA2__SHA512_INTERNAL_H */
+
+/* End of File
+ */
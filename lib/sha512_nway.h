@@ -0,0 +1,177 @@
+/* Copyright (c) 2022 Mark Friedenbach
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/* Multi-lane SHA-512 kernels, the 64-bit counterpart of sha256_nway.h.  This
+ * file has no include guard: it is included once per instruction set, after
+ * defining
+ *
+ *   VEC          a vector of 64-bit lanes
+ *   NWAY_LANES   the number of lanes in VEC
+ *   NWAY_SUFFIX  a token that makes the helper function names unique
+ *   NWAY_MULTI   the name of the kernel to define
+ *   K(x)         a vector with every lane set to x
+ *   Add(x, y), Xor(x, y), Or(x, y), And(x, y)
+ *   ShR(x, n), ShL(x, n)  per-lane shifts by a constant
+ *   ReadN(in, n) load the big-endian words at in[0] + n, in[1] + n, ... into
+ *                the lanes
+ *   LoadN(s, j)  load the words s[j], s[8 + j], s[16 + j], ... into the lanes
+ *   StoreN(s, j, v)  store the lanes back to the same words
+ *
+ * and optionally Rotr(x, n), Xor3(x, y, z), Ch(x, y, z) and Maj(x, y, z).
+ *
+ * Lane i of NWAY_MULTI compresses the 128-byte block at in[i] into the state
+ * s + 8 * i.  Every lane has a state of its own, so lanes may be at different
+ * points of different messages.  All of the above except VEC, NWAY_LANES and
+ * NWAY_SUFFIX are undefined again at the end.
+ */
+
+#define NWAY_CAT2(a, b) a##_##b
+#define NWAY_CAT(a, b) NWAY_CAT2(a, b)
+#define NWAY_FN(name) NWAY_CAT(name, NWAY_SUFFIX)
+
+#define Inc4 NWAY_FN(Inc4_512)
+#define Sigma0 NWAY_FN(Sigma0_512)
+#define Sigma1 NWAY_FN(Sigma1_512)
+#define sigma0 NWAY_FN(sigma0_512)
+#define sigma1 NWAY_FN(sigma1_512)
+#define Round NWAY_FN(Round_512)
+
+#define Add4(x, y, z, w) Add(Add((x), (y)), Add((z), (w)))
+static inline __attribute__((always_inline)) VEC Inc4(VEC *x, VEC y, VEC z, VEC w) { *x = Add4(*x, y, z, w); return *x; }
+#if !defined(Xor3)
+#define Xor3(x, y, z) Xor(Xor((x), (y)), (z))
+#endif
+#if !defined(Rotr)
+#define Rotr(x, n) Or(ShR((x), (n)), ShL((x), 64 - (n)))
+#endif
+
+#if !defined(Ch)
+#define Ch NWAY_FN(Ch_512)
+static inline __attribute__((always_inline)) VEC Ch(VEC x, VEC y, VEC z) { return Xor(z, And(x, Xor(y, z))); }
+#endif
+#if !defined(Maj)
+#define Maj NWAY_FN(Maj_512)
+static inline __attribute__((always_inline)) VEC Maj(VEC x, VEC y, VEC z) { return Or(And(x, y), And(z, Or(x, y))); }
+#endif
+static inline __attribute__((always_inline)) VEC Sigma0(VEC x) { return Xor3(Rotr(x, 28), Rotr(x, 34), Rotr(x, 39)); }
+static inline __attribute__((always_inline)) VEC Sigma1(VEC x) { return Xor3(Rotr(x, 14), Rotr(x, 18), Rotr(x, 41)); }
+static inline __attribute__((always_inline)) VEC sigma0(VEC x) { return Xor3(Rotr(x, 1), Rotr(x, 8), ShR(x, 7)); }
+static inline __attribute__((always_inline)) VEC sigma1(VEC x) { return Xor3(Rotr(x, 19), Rotr(x, 61), ShR(x, 6)); }
+
+/** One round of SHA-512. */
+static inline __attribute__((always_inline)) void Round(VEC a, VEC b, VEC c, VEC *d, VEC e, VEC f, VEC g, VEC *h, VEC k)
+{
+        VEC t1 = Add4(*h, Sigma1(e), Ch(e, f, g), k);
+        VEC t2 = Add(Sigma0(a), Maj(a, b, c));
+        *d = Add(*d, t1);
+        *h = Add(t1, t2);
+}
+
+void NWAY_MULTI(uint64_t s[8 * NWAY_LANES], const unsigned char* const in[NWAY_LANES])
+{
+        VEC a = LoadN(s, 0);
+        VEC b = LoadN(s, 1);
+        VEC c = LoadN(s, 2);
+        VEC d = LoadN(s, 3);
+        VEC e = LoadN(s, 4);
+        VEC f = LoadN(s, 5);
+        VEC g = LoadN(s, 6);
+        VEC h = LoadN(s, 7);
+
+        VEC w0 = ReadN(in, 0),
+                w1 = ReadN(in, 8),
+                w2 = ReadN(in, 16),
+                w3 = ReadN(in, 24),
+                w4 = ReadN(in, 32),
+                w5 = ReadN(in, 40),
+                w6 = ReadN(in, 48),
+                w7 = ReadN(in, 56),
+                w8 = ReadN(in, 64),
+                w9 = ReadN(in, 72),
+                w10 = ReadN(in, 80),
+                w11 = ReadN(in, 88),
+                w12 = ReadN(in, 96),
+                w13 = ReadN(in, 104),
+                w14 = ReadN(in, 112),
+                w15 = ReadN(in, 120);
+        int i;
+
+        for (i = 0; i < 80; i += 16) {
+                if (i) {
+                        Inc4(&w0, sigma1(w14), w9, sigma0(w1));
+                        Inc4(&w1, sigma1(w15), w10, sigma0(w2));
+                        Inc4(&w2, sigma1(w0), w11, sigma0(w3));
+                        Inc4(&w3, sigma1(w1), w12, sigma0(w4));
+                        Inc4(&w4, sigma1(w2), w13, sigma0(w5));
+                        Inc4(&w5, sigma1(w3), w14, sigma0(w6));
+                        Inc4(&w6, sigma1(w4), w15, sigma0(w7));
+                        Inc4(&w7, sigma1(w5), w0, sigma0(w8));
+                        Inc4(&w8, sigma1(w6), w1, sigma0(w9));
+                        Inc4(&w9, sigma1(w7), w2, sigma0(w10));
+                        Inc4(&w10, sigma1(w8), w3, sigma0(w11));
+                        Inc4(&w11, sigma1(w9), w4, sigma0(w12));
+                        Inc4(&w12, sigma1(w10), w5, sigma0(w13));
+                        Inc4(&w13, sigma1(w11), w6, sigma0(w14));
+                        Inc4(&w14, sigma1(w12), w7, sigma0(w15));
+                        Inc4(&w15, sigma1(w13), w8, sigma0(w0));
+                }
+                Round(a, b, c, &d, e, f, g, &h, Add(K(sha512_K[i + 0]), w0));
+                Round(h, a, b, &c, d, e, f, &g, Add(K(sha512_K[i + 1]), w1));
+                Round(g, h, a, &b, c, d, e, &f, Add(K(sha512_K[i + 2]), w2));
+                Round(f, g, h, &a, b, c, d, &e, Add(K(sha512_K[i + 3]), w3));
+                Round(e, f, g, &h, a, b, c, &d, Add(K(sha512_K[i + 4]), w4));
+                Round(d, e, f, &g, h, a, b, &c, Add(K(sha512_K[i + 5]), w5));
+                Round(c, d, e, &f, g, h, a, &b, Add(K(sha512_K[i + 6]), w6));
+                Round(b, c, d, &e, f, g, h, &a, Add(K(sha512_K[i + 7]), w7));
+                Round(a, b, c, &d, e, f, g, &h, Add(K(sha512_K[i + 8]), w8));
+                Round(h, a, b, &c, d, e, f, &g, Add(K(sha512_K[i + 9]), w9));
+                Round(g, h, a, &b, c, d, e, &f, Add(K(sha512_K[i + 10]), w10));
+                Round(f, g, h, &a, b, c, d, &e, Add(K(sha512_K[i + 11]), w11));
+                Round(e, f, g, &h, a, b, c, &d, Add(K(sha512_K[i + 12]), w12));
+                Round(d, e, f, &g, h, a, b, &c, Add(K(sha512_K[i + 13]), w13));
+                Round(c, d, e, &f, g, h, a, &b, Add(K(sha512_K[i + 14]), w14));
+                Round(b, c, d, &e, f, g, h, &a, Add(K(sha512_K[i + 15]), w15));
+        }
+
+        StoreN(s, 0, Add(a, LoadN(s, 0)));
+        StoreN(s, 1, Add(b, LoadN(s, 1)));
+        StoreN(s, 2, Add(c, LoadN(s, 2)));
+        StoreN(s, 3, Add(d, LoadN(s, 3)));
+        StoreN(s, 4, Add(e, LoadN(s, 4)));
+        StoreN(s, 5, Add(f, LoadN(s, 5)));
+        StoreN(s, 6, Add(g, LoadN(s, 6)));
+        StoreN(s, 7, Add(h, LoadN(s, 7)));
+}
+
+#undef Inc4
+#undef Ch
+#undef Maj
+#undef Sigma0
+#undef Sigma1
+#undef sigma0
+#undef sigma1
+#undef Round
+#undef Rotr
+#undef Add4
+#undef Xor3
+#undef NWAY_FN
+#undef NWAY_CAT
+#undef NWAY_CAT2
+#undef NWAY_MULTI
+#undef K
+#undef Add
+#undef Xor
+#undef Or
+#undef And
+#undef ShR
+#undef ShL
+#undef ReadN
+#undef LoadN
+#undef StoreN
+
+/* End of File
+ */
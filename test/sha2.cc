@@ -7,7 +7,12 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <string>
+#include <thread>
+
 #include <sha2/sha256.h>
+#include <sha2/sha512.h>
 
 TEST(gtest, assert_eq)
 {
@@ -112,6 +117,620 @@ TEST(sha2, self_test)
                 sha256_double64(out, data_d64, 8);
                 ASSERT_EQ(memcmp(out, result_d64, 256), 0);
         }
+
+        /* Test sha256() against the streaming API, covering the one- and
+         * two-block fast paths and the fallback. */
+        for (int i = 0; i <= 640; ++i) {
+                struct sha256 out1, out2;
+                struct sha256_ctx ctx = SHA256_INIT;
+                sha256_update(&ctx, data + 1, i);
+                sha256_done(&out1, &ctx);
+                sha256(&out2, data + 1, i);
+                ASSERT_EQ(memcmp(&out1, &out2, 32), 0);
+        }
+
+        /* Test sha256d() against the transform_d64 results. */
+        for (int i = 0; i < 8; ++i) {
+                struct sha256 out;
+                sha256d(&out, data_d64 + 2 * i, 64);
+                ASSERT_EQ(memcmp(&out, result_d64 + 32 * i, 32), 0);
+        }
+
+        /* Test sha256d_done() against two rounds of sha256_done(). */
+        for (int i = 0; i <= 640; ++i) {
+                struct sha256 out1, out2;
+                struct sha256_ctx ctx = SHA256_INIT;
+                sha256_update(&ctx, data + 1, i);
+                sha256_done(&out1, &ctx);
+                sha256_init(&ctx);
+                sha256_update(&ctx, &out1, 32);
+                sha256_done(&out1, &ctx);
+                sha256_init(&ctx);
+                sha256_update(&ctx, data + 1, i);
+                sha256d_done(&out2, &ctx);
+                ASSERT_EQ(memcmp(&out1, &out2, 32), 0);
+                sha256d(&out2, data + 1, i);
+                ASSERT_EQ(memcmp(&out1, &out2, 32), 0);
+        }
+}
+
+TEST(sha2, vectors)
+{
+        /* FIPS 180-2 test vectors, both of which end in a block containing
+         * only padding. */
+        static const unsigned char empty[32] = {
+                0xe3, 0xb0, 0xc4, 0x42, 0x98, 0xfc, 0x1c, 0x14, 0x9a, 0xfb, 0xf4, 0xc8, 0x99, 0x6f, 0xb9, 0x24,
+                0x27, 0xae, 0x41, 0xe4, 0x64, 0x9b, 0x93, 0x4c, 0xa4, 0x95, 0x99, 0x1b, 0x78, 0x52, 0xb8, 0x55
+        };
+        static const char msg56[] = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+        static const unsigned char hash56[32] = {
+                0x24, 0x8d, 0x6a, 0x61, 0xd2, 0x06, 0x38, 0xb8, 0xe5, 0xc0, 0x26, 0x93, 0x0c, 0x3e, 0x60, 0x39,
+                0xa3, 0x3c, 0xe4, 0x59, 0x64, 0xff, 0x21, 0x67, 0xf6, 0xec, 0xed, 0xd4, 0x19, 0xdb, 0x06, 0xc1
+        };
+        struct sha256 out;
+        struct sha256_ctx ctx;
+
+        sha256_auto_detect();
+
+        sha256_init(&ctx);
+        sha256_done(&out, &ctx);
+        ASSERT_EQ(memcmp(&out, empty, 32), 0);
+
+        sha256_init(&ctx);
+        sha256_update(&ctx, msg56, 56);
+        sha256_done(&out, &ctx);
+        ASSERT_EQ(memcmp(&out, hash56, 32), 0);
+
+        /* Twice, as the padding schedule may have been cached. */
+        sha256_init(&ctx);
+        sha256_update(&ctx, msg56, 56);
+        sha256_done(&out, &ctx);
+        ASSERT_EQ(memcmp(&out, hash56, 32), 0);
+}
+
+TEST(sha2, select_backend)
+{
+        static const char msg56[] = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+        unsigned available = sha256_available_kernels();
+        struct sha256 in[32], expected_d64[16], expected_midstate[16], expected_h64[16], out[16];
+        uint32_t midstate[8];
+        unsigned char blocks[16 * 64];
+
+        ASSERT_EQ(sha256_selected_kernels() & ~available, 0u);
+        ASSERT_EQ(sha256_select_backend(0x80000000u), -1);
+        ASSERT_STREQ(sha256_kernel_name(SHA256_KERNEL_AVX2), "avx2");
+        ASSERT_EQ(sha256_kernel_lanes(SHA256_KERNEL_SHANI), 1u | 2u);
+        ASSERT_EQ(sha256_kernel_lanes(SHA256_KERNEL_VEC), 4u | 8u);
+        ASSERT_EQ(sha256_kernel_lanes(SHA256_KERNEL_AVX512), 16u);
+        ASSERT_EQ(sha256_kernel_name(0), nullptr);
+
+        for (int i = 0; i < 32; ++i) {
+                sha256(&in[i], msg56 + i, 24);
+        }
+        for (int i = 0; i < 16; ++i) {
+                sha256(&expected_h64[i], &in[2 * i], 64);
+        }
+        for (int i = 0; i < 16 * 64; ++i) {
+                blocks[i] = (unsigned char)msg56[i % 56];
+        }
+        {
+                struct sha256_ctx ctx = SHA256_INIT;
+                sha256_update(&ctx, msg56, 56);
+                memcpy(midstate, ctx.s, sizeof(midstate));
+        }
+
+        /* Reference results from the generic code, unless the library was
+         * built with a pinned backend. */
+        if (sha256_select_backend(SHA256_KERNEL_GENERIC)) {
+                ASSERT_EQ(sha256_select_backend(available), 0);
+                return;
+        }
+        ASSERT_TRUE(available & SHA256_KERNEL_GENERIC);
+        ASSERT_EQ(sha256_selected_kernels(), (unsigned)SHA256_KERNEL_GENERIC);
+        sha256_double64(expected_d64, in, 16);
+        sha256_midstate(expected_midstate, midstate, blocks, 16);
+
+        /* Every available kernel, alone, gives the same results. */
+        for (unsigned kernel = 1; kernel; kernel <<= 1) {
+                if (!(available & kernel)) {
+                        continue;
+                }
+                ASSERT_EQ(sha256_select_backend(kernel), 0) << sha256_kernel_name(kernel);
+                sha256_double64(out, in, 16);
+                ASSERT_EQ(memcmp(out, expected_d64, sizeof(out)), 0) << sha256_kernel_name(kernel);
+                sha256_midstate(out, midstate, blocks, 16);
+                ASSERT_EQ(memcmp(out, expected_midstate, sizeof(out)), 0) << sha256_kernel_name(kernel);
+                sha256_hash64(out, in, 16);
+                ASSERT_EQ(memcmp(out, expected_h64, sizeof(out)), 0) << sha256_kernel_name(kernel);
+        }
+
+        ASSERT_EQ(sha256_select_backend(0), 0);
+}
+
+TEST(sha2, calibrate)
+{
+        static const char path[] = "sha2-tune.tmp";
+        struct sha256 in[16], expected_d64[16], expected_midstate[15], out[16];
+        uint32_t midstate[8];
+        unsigned char blocks[15 * 64];
+        FILE* f;
+
+        for (int i = 0; i < 16; ++i) {
+                sha256(&in[i], &i, sizeof(i));
+        }
+        for (int i = 0; i < 15 * 64; ++i) {
+                blocks[i] = (unsigned char)(i * 7);
+        }
+        {
+                struct sha256_ctx ctx = SHA256_INIT;
+                sha256_update(&ctx, blocks, 64);
+                memcpy(midstate, ctx.s, sizeof(midstate));
+        }
+        sha256_double64(expected_d64, in, 8);
+        sha256_midstate(expected_midstate, midstate, blocks, 15);
+
+        /* A malformed cache is ignored and overwritten. */
+        f = fopen(path, "w");
+        ASSERT_NE(f, nullptr);
+        fputs("libsha2-tune garbage\n", f);
+        fclose(f);
+        int ret = sha256_calibrate(path);
+        if (ret == -1) {
+                /* Pinned backend */
+                remove(path);
+                return;
+        }
+        ASSERT_EQ(ret, 0);
+        ASSERT_EQ(sha256_selected_kernels() & ~sha256_available_kernels(), 0u);
+        sha256_double64(out, in, 8);
+        ASSERT_EQ(memcmp(out, expected_d64, 8 * sizeof(out[0])), 0);
+        sha256_midstate(out, midstate, blocks, 15);
+        ASSERT_EQ(memcmp(out, expected_midstate, sizeof(expected_midstate)), 0);
+
+        /* The second time, the cached results are used. */
+        std::string name = sha256_auto_detect();
+        ASSERT_EQ(sha256_calibrate(path), 1);
+        ASSERT_EQ(name, sha256_auto_detect());
+        sha256_double64(out, in, 8);
+        ASSERT_EQ(memcmp(out, expected_d64, 8 * sizeof(out[0])), 0);
+
+        remove(path);
+        ASSERT_EQ(sha256_calibrate(NULL), 0);
+        ASSERT_EQ(sha256_select_backend(0), 0);
+}
+
+TEST(sha2, stats)
+{
+        static const unsigned widths[4] = { 1, 2, 4, 8 };
+        struct sha256_stats before, after;
+        struct sha256 in[14], out[7];
+        uint32_t midstate[8] = { 0 };
+        unsigned char blocks[7 * 64] = { 0 };
+        struct sha256_ctx ctx = SHA256_INIT;
+        struct sha256_hmac_key key;
+        uint64_t lanes = 0, kernel_calls = 0;
+
+        memset(in, 0, sizeof(in));
+        if (sha256_stats_snapshot(&before)) {
+                /* Configured without --enable-stats */
+                for (size_t i = 0; i < sizeof(before) / sizeof(uint64_t); ++i) {
+                        ASSERT_EQ(((const uint64_t*)&before)[i], 0u);
+                }
+                return;
+        }
+
+        sha256_update(&ctx, blocks, 100);
+        sha256_done(&out[0], &ctx);
+        sha256d(&out[0], blocks, 10);
+        sha256_double64(out, in, 7);
+        sha256_midstate(out, midstate, blocks, 7);
+        /* HMAC shares the midstate kernels, but not their histogram. */
+        sha256_hmac_key_init(&key, blocks, 32);
+        sha256_hmac(&out[0], &key, blocks, 64);
+        /* A thread's counts survive it. */
+        std::thread([&] { sha256(&out[0], blocks, 32); }).join();
+
+        ASSERT_EQ(sha256_stats_snapshot(&after), 0);
+        ASSERT_EQ(after.api_calls[SHA256_API_UPDATE] - before.api_calls[SHA256_API_UPDATE], 1u);
+        ASSERT_EQ(after.api_bytes[SHA256_API_UPDATE] - before.api_bytes[SHA256_API_UPDATE], 100u);
+        ASSERT_EQ(after.api_calls[SHA256_API_DONE] - before.api_calls[SHA256_API_DONE], 1u);
+        ASSERT_EQ(after.api_bytes[SHA256_API_DOUBLE] - before.api_bytes[SHA256_API_DOUBLE], 10u);
+        ASSERT_EQ(after.api_bytes[SHA256_API_DOUBLE64] - before.api_bytes[SHA256_API_DOUBLE64], 7u * 64);
+        ASSERT_EQ(after.api_bytes[SHA256_API_MIDSTATE] - before.api_bytes[SHA256_API_MIDSTATE], 7u * 64);
+        ASSERT_EQ(after.api_calls[SHA256_API_ONESHOT] - before.api_calls[SHA256_API_ONESHOT], 1u);
+        ASSERT_EQ(after.api_bytes[SHA256_API_ONESHOT] - before.api_bytes[SHA256_API_ONESHOT], 32u);
+
+        /* Every lane is accounted for. */
+        for (int i = 0; i < 4; ++i) {
+                lanes += (after.double64_lanes[i] - before.double64_lanes[i]) * widths[i];
+        }
+        ASSERT_EQ(lanes, 7u);
+        lanes = 0;
+        for (int i = 0; i < 4; ++i) {
+                lanes += (after.midstate_lanes[i] - before.midstate_lanes[i]) * widths[i];
+        }
+        ASSERT_EQ(lanes, 7u);
+
+        /* Only selected kernels ran. */
+        for (unsigned bit = 0; bit < 8; ++bit) {
+                uint64_t calls = after.kernel_calls[bit] - before.kernel_calls[bit];
+                if (calls) {
+                        ASSERT_TRUE(sha256_selected_kernels() & (1u << bit)) << bit;
+                }
+                kernel_calls += calls;
+        }
+        ASSERT_GE(kernel_calls, 6u);
+}
+
+TEST(sha2, sha512)
+{
+        /* FIPS 180-2 test vectors */
+        static const unsigned char empty512[64] = {
+                0xcf, 0x83, 0xe1, 0x35, 0x7e, 0xef, 0xb8, 0xbd, 0xf1, 0x54, 0x28, 0x50, 0xd6, 0x6d, 0x80, 0x07,
+                0xd6, 0x20, 0xe4, 0x05, 0x0b, 0x57, 0x15, 0xdc, 0x83, 0xf4, 0xa9, 0x21, 0xd3, 0x6c, 0xe9, 0xce,
+                0x47, 0xd0, 0xd1, 0x3c, 0x5d, 0x85, 0xf2, 0xb0, 0xff, 0x83, 0x18, 0xd2, 0x87, 0x7e, 0xec, 0x2f,
+                0x63, 0xb9, 0x31, 0xbd, 0x47, 0x41, 0x7a, 0x81, 0xa5, 0x38, 0x32, 0x7a, 0xf9, 0x27, 0xda, 0x3e
+        };
+        static const unsigned char abc512[64] = {
+                0xdd, 0xaf, 0x35, 0xa1, 0x93, 0x61, 0x7a, 0xba, 0xcc, 0x41, 0x73, 0x49, 0xae, 0x20, 0x41, 0x31,
+                0x12, 0xe6, 0xfa, 0x4e, 0x89, 0xa9, 0x7e, 0xa2, 0x0a, 0x9e, 0xee, 0xe6, 0x4b, 0x55, 0xd3, 0x9a,
+                0x21, 0x92, 0x99, 0x2a, 0x27, 0x4f, 0xc1, 0xa8, 0x36, 0xba, 0x3c, 0x23, 0xa3, 0xfe, 0xeb, 0xbd,
+                0x45, 0x4d, 0x44, 0x23, 0x64, 0x3c, 0xe8, 0x0e, 0x2a, 0x9a, 0xc9, 0x4f, 0xa5, 0x4c, 0xa4, 0x9f
+        };
+        static const char msg112[] = "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmno"
+                                     "ijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu";
+        static const unsigned char hash512[64] = {
+                0x8e, 0x95, 0x9b, 0x75, 0xda, 0xe3, 0x13, 0xda, 0x8c, 0xf4, 0xf7, 0x28, 0x14, 0xfc, 0x14, 0x3f,
+                0x8f, 0x77, 0x79, 0xc6, 0xeb, 0x9f, 0x7f, 0xa1, 0x72, 0x99, 0xae, 0xad, 0xb6, 0x88, 0x90, 0x18,
+                0x50, 0x1d, 0x28, 0x9e, 0x49, 0x00, 0xf7, 0xe4, 0x33, 0x1b, 0x99, 0xde, 0xc4, 0xb5, 0x43, 0x3a,
+                0xc7, 0xd3, 0x29, 0xee, 0xb6, 0xdd, 0x26, 0x54, 0x5e, 0x96, 0xe5, 0x5b, 0x87, 0x4b, 0xe9, 0x09
+        };
+        static const unsigned char abc384[48] = {
+                0xcb, 0x00, 0x75, 0x3f, 0x45, 0xa3, 0x5e, 0x8b, 0xb5, 0xa0, 0x3d, 0x69, 0x9a, 0xc6, 0x50, 0x07,
+                0x27, 0x2c, 0x32, 0xab, 0x0e, 0xde, 0xd1, 0x63, 0x1a, 0x8b, 0x60, 0x5a, 0x43, 0xff, 0x5b, 0xed,
+                0x80, 0x86, 0x07, 0x2b, 0xa1, 0xe7, 0xcc, 0x23, 0x58, 0xba, 0xec, 0xa1, 0x34, 0xc8, 0x25, 0xa7
+        };
+        static const unsigned char hash384[48] = {
+                0x09, 0x33, 0x0c, 0x33, 0xf7, 0x11, 0x47, 0xe8, 0x3d, 0x19, 0x2f, 0xc7, 0x82, 0xcd, 0x1b, 0x47,
+                0x53, 0x11, 0x1b, 0x17, 0x3b, 0x3b, 0x05, 0xd2, 0x2f, 0xa0, 0x80, 0x86, 0xe3, 0xb0, 0xf7, 0x12,
+                0xfc, 0xc7, 0xc7, 0x1a, 0x55, 0x7e, 0x2d, 0xb9, 0x66, 0xc3, 0xe9, 0xfa, 0x91, 0x74, 0x60, 0x39
+        };
+        /* One million repetitions of 'a', hashed in uneven pieces. */
+        static const unsigned char million512[64] = {
+                0xe7, 0x18, 0x48, 0x3d, 0x0c, 0xe7, 0x69, 0x64, 0x4e, 0x2e, 0x42, 0xc7, 0xbc, 0x15, 0xb4, 0x63,
+                0x8e, 0x1f, 0x98, 0xb1, 0x3b, 0x20, 0x44, 0x28, 0x56, 0x32, 0xa8, 0x03, 0xaf, 0xa9, 0x73, 0xeb,
+                0xde, 0x0f, 0xf2, 0x44, 0x87, 0x7e, 0xa6, 0x0a, 0x4c, 0xb0, 0x43, 0x2c, 0xe5, 0x77, 0xc3, 0x1b,
+                0xeb, 0x00, 0x9c, 0x5c, 0x2c, 0x49, 0xaa, 0x2e, 0x4e, 0xad, 0xb2, 0x17, 0xad, 0x8c, 0xc0, 0x9b
+        };
+        static const unsigned char million384[48] = {
+                0x9d, 0x0e, 0x18, 0x09, 0x71, 0x64, 0x74, 0xcb, 0x08, 0x6e, 0x83, 0x4e, 0x31, 0x0a, 0x4a, 0x1c,
+                0xed, 0x14, 0x9e, 0x9c, 0x00, 0xf2, 0x48, 0x52, 0x79, 0x72, 0xce, 0xc5, 0x70, 0x4c, 0x2a, 0x5b,
+                0x07, 0xb8, 0xb3, 0xdc, 0x38, 0xec, 0xc4, 0xeb, 0xae, 0x97, 0xdd, 0xd8, 0x7f, 0x3d, 0x89, 0x85
+        };
+        static const struct sha512_ctx init512 = SHA512_INIT;
+        static const struct sha512_ctx init384 = SHA384_INIT;
+        unsigned char a[1000];
+        struct sha512 out512;
+        struct sha384 out384;
+        struct sha512_ctx ctx;
+
+        ASSERT_NE(sha512_auto_detect(), nullptr);
+
+        sha512_init(&ctx);
+        ASSERT_EQ(memcmp(&ctx, &init512, sizeof(ctx)), 0);
+        sha512_done(&out512, &ctx);
+        ASSERT_EQ(memcmp(&out512, empty512, 64), 0);
+        sha384_init(&ctx);
+        ASSERT_EQ(memcmp(&ctx, &init384, sizeof(ctx)), 0);
+
+        sha512(&out512, "abc", 3);
+        ASSERT_EQ(memcmp(&out512, abc512, 64), 0);
+        sha512(&out512, msg112, 112);
+        ASSERT_EQ(memcmp(&out512, hash512, 64), 0);
+        sha384(&out384, "abc", 3);
+        ASSERT_EQ(memcmp(&out384, abc384, 48), 0);
+        sha384(&out384, msg112, 112);
+        ASSERT_EQ(memcmp(&out384, hash384, 48), 0);
+
+        /* The padding of a 112-byte message spills into a second block. */
+        sha512_init(&ctx);
+        sha512_update(&ctx, msg112, 100);
+        sha512_update(&ctx, msg112 + 100, 12);
+        sha512_done(&out512, &ctx);
+        ASSERT_EQ(memcmp(&out512, hash512, 64), 0);
+
+        memset(a, 'a', sizeof(a));
+
+        /* sha512() against the streaming API, covering the one- and
+         * two-block fast paths and the fallback. */
+        for (size_t i = 0; i <= 640; ++i) {
+                struct sha512 out;
+                a[0] = (unsigned char)i;
+                sha512_init(&ctx);
+                sha512_update(&ctx, a, i);
+                sha512_done(&out512, &ctx);
+                sha512(&out, a, i);
+                ASSERT_EQ(memcmp(&out, &out512, 64), 0);
+        }
+        a[0] = 'a';
+
+        sha512_init(&ctx);
+        for (size_t i = 0, n = 1; i < 1000000; i += n, n = n % 997 + 1) {
+                sha512_update(&ctx, a, std::min(n, 1000000 - i));
+        }
+        sha512_done(&out512, &ctx);
+        ASSERT_EQ(memcmp(&out512, million512, 64), 0);
+        sha384_init(&ctx);
+        for (size_t i = 0; i < 1000; ++i) {
+                sha512_update(&ctx, a, 1000);
+        }
+        sha384_done(&out384, &ctx);
+        ASSERT_EQ(memcmp(&out384, million384, 48), 0);
+}
+
+TEST(sha2, sha512_batch)
+{
+        unsigned char data[1024];
+        const void* msg[39];
+        size_t len[39];
+        struct sha512 out512[39], expected512;
+        struct sha384 out384[39], expected384;
+
+        for (size_t i = 0; i < sizeof(data); ++i) {
+                data[i] = (unsigned char)(i * 31 + 7);
+        }
+        /* Lengths around the padding boundaries, in batches of every width
+         * down to the single-stream remainder. */
+        for (size_t n = 0; n <= 39; n += 13) {
+                for (size_t i = 0; i < n; ++i) {
+                        msg[i] = data + 3 * i;
+                        len[i] = (n * 17 + i * 29) % 300;
+                }
+                sha512_batch(out512, msg, len, n);
+                sha384_batch(out384, msg, len, n);
+                for (size_t i = 0; i < n; ++i) {
+                        sha512(&expected512, msg[i], len[i]);
+                        ASSERT_EQ(memcmp(&out512[i], &expected512, 64), 0) << n << " " << i;
+                        sha384(&expected384, msg[i], len[i]);
+                        ASSERT_EQ(memcmp(&out384[i], &expected384, 48), 0) << n << " " << i;
+                }
+        }
+        /* Equal lengths, as in BIP32 derivation. */
+        for (size_t i = 0; i < 8; ++i) {
+                msg[i] = data + 37 * i;
+                len[i] = 37;
+        }
+        sha512_batch(out512, msg, len, 8);
+        for (size_t i = 0; i < 8; ++i) {
+                sha512(&expected512, msg[i], len[i]);
+                ASSERT_EQ(memcmp(&out512[i], &expected512, 64), 0) << i;
+        }
+}
+
+TEST(sha2, truncated)
+{
+        /* FIPS 180-4 test vectors */
+        static const unsigned char empty224[28] = {
+                0xd1, 0x4a, 0x02, 0x8c, 0x2a, 0x3a, 0x2b, 0xc9, 0x47, 0x61, 0x02, 0xbb, 0x28, 0x82, 0x34, 0xc4,
+                0x15, 0xa2, 0xb0, 0x1f, 0x82, 0x8e, 0xa6, 0x2a, 0xc5, 0xb3, 0xe4, 0x2f
+        };
+        static const unsigned char abc224[28] = {
+                0x23, 0x09, 0x7d, 0x22, 0x34, 0x05, 0xd8, 0x22, 0x86, 0x42, 0xa4, 0x77, 0xbd, 0xa2, 0x55, 0xb3,
+                0x2a, 0xad, 0xbc, 0xe4, 0xbd, 0xa0, 0xb3, 0xf7, 0xe3, 0x6c, 0x9d, 0xa7
+        };
+        static const unsigned char hash224[28] = {
+                0x75, 0x38, 0x8b, 0x16, 0x51, 0x27, 0x76, 0xcc, 0x5d, 0xba, 0x5d, 0xa1, 0xfd, 0x89, 0x01, 0x50,
+                0xb0, 0xc6, 0x45, 0x5c, 0xb4, 0xf5, 0x8b, 0x19, 0x52, 0x52, 0x25, 0x25
+        };
+        static const unsigned char abc512_256[32] = {
+                0x53, 0x04, 0x8e, 0x26, 0x81, 0x94, 0x1e, 0xf9, 0x9b, 0x2e, 0x29, 0xb7, 0x6b, 0x4c, 0x7d, 0xab,
+                0xe4, 0xc2, 0xd0, 0xc6, 0x34, 0xfc, 0x6d, 0x46, 0xe0, 0xe2, 0xf1, 0x31, 0x07, 0xe7, 0xaf, 0x23
+        };
+        static const unsigned char hash512_256[32] = {
+                0x39, 0x28, 0xe1, 0x84, 0xfb, 0x86, 0x90, 0xf8, 0x40, 0xda, 0x39, 0x88, 0x12, 0x1d, 0x31, 0xbe,
+                0x65, 0xcb, 0x9d, 0x3e, 0xf8, 0x3e, 0xe6, 0x14, 0x6f, 0xea, 0xc8, 0x61, 0xe1, 0x9b, 0x56, 0x3a
+        };
+        static const unsigned char abc512_224[28] = {
+                0x46, 0x34, 0x27, 0x0f, 0x70, 0x7b, 0x6a, 0x54, 0xda, 0xae, 0x75, 0x30, 0x46, 0x08, 0x42, 0xe2,
+                0x0e, 0x37, 0xed, 0x26, 0x5c, 0xee, 0xe9, 0xa4, 0x3e, 0x89, 0x24, 0xaa
+        };
+        static const unsigned char hash512_224[28] = {
+                0x23, 0xfe, 0xc5, 0xbb, 0x94, 0xd6, 0x0b, 0x23, 0x30, 0x81, 0x92, 0x64, 0x0b, 0x0c, 0x45, 0x33,
+                0x35, 0xd6, 0x64, 0x73, 0x4f, 0xe4, 0x0e, 0x72, 0x68, 0x67, 0x4a, 0xf9
+        };
+        static const char msg56[] = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+        static const char msg112[] = "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmno"
+                                     "ijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu";
+        static const struct sha256_ctx init224 = SHA224_INIT;
+        static const struct sha512_ctx init512_256 = SHA512_256_INIT;
+        static const struct sha512_ctx init512_224 = SHA512_224_INIT;
+        unsigned char data[1024];
+        const void* msg[40];
+        size_t len[40];
+        struct sha224 out224[40], expected224;
+        struct sha512_256 out256[40], expected256;
+        struct sha512_224 out512_224[40], expected512_224;
+        struct sha256_ctx ctx;
+        struct sha512_ctx ctx512;
+
+        sha224_init(&ctx);
+        ASSERT_EQ(memcmp(ctx.s, init224.s, sizeof(ctx.s)), 0);
+        ASSERT_EQ(ctx.bytes, init224.bytes);
+        sha224_done(&expected224, &ctx);
+        ASSERT_EQ(memcmp(&expected224, empty224, 28), 0);
+        sha224(&expected224, "abc", 3);
+        ASSERT_EQ(memcmp(&expected224, abc224, 28), 0);
+        sha224(&expected224, msg56, 56);
+        ASSERT_EQ(memcmp(&expected224, hash224, 28), 0);
+
+        sha512_256_init(&ctx512);
+        ASSERT_EQ(memcmp(&ctx512, &init512_256, sizeof(ctx512)), 0);
+        sha512_update(&ctx512, "abc", 3);
+        sha512_256_done(&expected256, &ctx512);
+        ASSERT_EQ(memcmp(&expected256, abc512_256, 32), 0);
+        sha512_256(&expected256, msg112, 112);
+        ASSERT_EQ(memcmp(&expected256, hash512_256, 32), 0);
+        sha512_224_init(&ctx512);
+        ASSERT_EQ(memcmp(&ctx512, &init512_224, sizeof(ctx512)), 0);
+        sha512_update(&ctx512, "abc", 3);
+        sha512_224_done(&expected512_224, &ctx512);
+        ASSERT_EQ(memcmp(&expected512_224, abc512_224, 28), 0);
+        sha512_224(&expected512_224, msg112, 112);
+        ASSERT_EQ(memcmp(&expected512_224, hash512_224, 28), 0);
+
+        for (size_t i = 0; i < sizeof(data); ++i) {
+                data[i] = (unsigned char)(i * 31 + 7);
+        }
+        /* sha224() against the streaming API. */
+        for (size_t i = 0; i <= 200; ++i) {
+                sha224_init(&ctx);
+                sha256_update(&ctx, data, i);
+                sha224_done(&expected224, &ctx);
+                sha224(&out224[0], data, i);
+                ASSERT_EQ(memcmp(&out224[0], &expected224, 28), 0) << i;
+        }
+        /* Batches mixing runs of single-block messages, which share the
+         * multi-lane kernels, with longer ones. */
+        for (size_t n = 0; n <= 40; n += 10) {
+                for (size_t i = 0; i < n; ++i) {
+                        msg[i] = data + 5 * i;
+                        len[i] = i % 7 == 6 ? 56 + i * 9 : (n + i * 13) % 56;
+                }
+                sha224_batch(out224, msg, len, n);
+                sha512_256_batch(out256, msg, len, n);
+                sha512_224_batch(out512_224, msg, len, n);
+                for (size_t i = 0; i < n; ++i) {
+                        sha224(&expected224, msg[i], len[i]);
+                        ASSERT_EQ(memcmp(&out224[i], &expected224, 28), 0) << n << " " << i;
+                        sha512_256(&expected256, msg[i], len[i]);
+                        ASSERT_EQ(memcmp(&out256[i], &expected256, 32), 0) << n << " " << i;
+                        sha512_224(&expected512_224, msg[i], len[i]);
+                        ASSERT_EQ(memcmp(&out512_224[i], &expected512_224, 28), 0) << n << " " << i;
+                }
+        }
+}
+
+TEST(sha2, hmac)
+{
+        /* RFC 4231 test cases 1-4 and 6 */
+        static const struct {
+                std::string key;
+                std::string msg;
+                unsigned char mac[32];
+        } vectors[] = {
+                { std::string(20, '\x0b'),
+                  std::string("Hi There"),
+                  { 0xb0, 0x34, 0x4c, 0x61, 0xd8, 0xdb, 0x38, 0x53, 0x5c, 0xa8, 0xaf, 0xce, 0xaf, 0x0b, 0xf1, 0x2b,
+                    0x88, 0x1d, 0xc2, 0x00, 0xc9, 0x83, 0x3d, 0xa7, 0x26, 0xe9, 0x37, 0x6c, 0x2e, 0x32, 0xcf, 0xf7 } },
+                { std::string("Jefe"),
+                  std::string("what do ya want for nothing?"),
+                  { 0x5b, 0xdc, 0xc1, 0x46, 0xbf, 0x60, 0x75, 0x4e, 0x6a, 0x04, 0x24, 0x26, 0x08, 0x95, 0x75, 0xc7,
+                    0x5a, 0x00, 0x3f, 0x08, 0x9d, 0x27, 0x39, 0x83, 0x9d, 0xec, 0x58, 0xb9, 0x64, 0xec, 0x38, 0x43 } },
+                { std::string(20, '\xaa'),
+                  std::string(50, '\xdd'),
+                  { 0x77, 0x3e, 0xa9, 0x1e, 0x36, 0x80, 0x0e, 0x46, 0x85, 0x4d, 0xb8, 0xeb, 0xd0, 0x91, 0x81, 0xa7,
+                    0x29, 0x59, 0x09, 0x8b, 0x3e, 0xf8, 0xc1, 0x22, 0xd9, 0x63, 0x55, 0x14, 0xce, 0xd5, 0x65, 0xfe } },
+                { std::string("\x01\x02\x03\x04\x05\x06\x07\x08\x09\x0a\x0b\x0c\x0d\x0e\x0f\x10\x11\x12\x13\x14\x15\x16\x17\x18\x19", 25),
+                  std::string(50, '\xcd'),
+                  { 0x82, 0x55, 0x8a, 0x38, 0x9a, 0x44, 0x3c, 0x0e, 0xa4, 0xcc, 0x81, 0x98, 0x99, 0xf2, 0x08, 0x3a,
+                    0x85, 0xf0, 0xfa, 0xa3, 0xe5, 0x78, 0xf8, 0x07, 0x7a, 0x2e, 0x3f, 0xf4, 0x67, 0x29, 0x66, 0x5b } },
+                { std::string(131, '\xaa'),
+                  std::string("Test Using Larger Than Block-Size Key - Hash Key First"),
+                  { 0x60, 0xe4, 0x31, 0x59, 0x1e, 0xe0, 0xb6, 0x7f, 0x0d, 0x8a, 0x26, 0xaa, 0xcb, 0xf5, 0xb7, 0x7f,
+                    0x8e, 0x0b, 0xc6, 0x21, 0x37, 0x28, 0xc5, 0x14, 0x05, 0x46, 0x04, 0x0f, 0x0e, 0xe3, 0x7f, 0x54 } },
+        };
+        unsigned char data[256];
+        unsigned char block[64];
+        struct sha256_hmac_key key;
+        struct sha256 mac, inner;
+        struct sha256_ctx ctx;
+
+        for (const auto& v : vectors) {
+                sha256_hmac_key_init(&key, v.key.data(), v.key.size());
+                sha256_hmac(&mac, &key, v.msg.data(), v.msg.size());
+                ASSERT_EQ(memcmp(mac.u8, v.mac, 32), 0) << v.msg;
+        }
+
+        /* Against the definition, for messages filling zero to three
+         * blocks, and keys on either side of the block size. */
+        for (size_t i = 0; i < sizeof(data); ++i) {
+                data[i] = (unsigned char)(i * 31 + 7);
+        }
+        for (size_t keylen : { 0, 13, 64, 65 }) {
+                unsigned char pad[64] = { 0 };
+                if (keylen > 64) {
+                        sha256(&inner, data + 100, keylen);
+                        memcpy(pad, inner.u8, 32);
+                } else {
+                        memcpy(pad, data + 100, keylen);
+                }
+                sha256_hmac_key_init(&key, data + 100, keylen);
+                for (size_t len = 0; len <= 200; ++len) {
+                        for (size_t i = 0; i < 64; ++i) {
+                                block[i] = pad[i] ^ 0x36;
+                        }
+                        sha256_init(&ctx);
+                        sha256_update(&ctx, block, 64);
+                        sha256_update(&ctx, data, len);
+                        sha256_done(&inner, &ctx);
+                        for (size_t i = 0; i < 64; ++i) {
+                                block[i] = pad[i] ^ 0x5c;
+                        }
+                        sha256_init(&ctx);
+                        sha256_update(&ctx, block, 64);
+                        sha256_update(&ctx, inner.u8, 32);
+                        sha256_done(&inner, &ctx);
+                        sha256_hmac(&mac, &key, data, len);
+                        ASSERT_EQ(memcmp(&mac, &inner, 32), 0) << keylen << " " << len;
+                }
+        }
+
+        /* The outer midstate finishes the MAC through sha256_midstate(). */
+        sha256_hmac_key_init(&key, "key", 3);
+        ctx.bytes = 64;
+        memcpy(ctx.s, key.inner, sizeof(ctx.s));
+        sha256_update(&ctx, "message", 7);
+        sha256_done(&inner, &ctx);
+        memset(block, 0, sizeof(block));
+        memcpy(block, inner.u8, 32);
+        block[32] = 0x80;
+        block[62] = 0x03;
+        sha256_midstate(&mac, key.outer, block, 1);
+        sha256_hmac(&inner, &key, "message", 7);
+        ASSERT_EQ(memcmp(&mac, &inner, 32), 0);
+}
+
+TEST(sha2, hmac_batch)
+{
+        unsigned char data[1024];
+        struct sha256_hmac_key keys[3];
+        const struct sha256_hmac_key* key[40];
+        const void* msg[40];
+        size_t len[40];
+        struct sha256 out[40], expected;
+
+        for (size_t i = 0; i < sizeof(data); ++i) {
+                data[i] = (unsigned char)(i * 31 + 7);
+        }
+        for (size_t i = 0; i < 3; ++i) {
+                sha256_hmac_key_init(&keys[i], data + 500 + i, 16 + 40 * i);
+        }
+        /* One key, then a key per message; short messages with a few that
+         * take more inner blocks, in batches of every width. */
+        for (int same = 1; same >= 0; --same) {
+                for (size_t n = 0; n <= 40; n += 5) {
+                        for (size_t i = 0; i < n; ++i) {
+                                key[i] = &keys[same ? 0 : i % 3];
+                                msg[i] = data + 7 * i;
+                                len[i] = i % 9 == 8 ? 100 + 17 * i : (n * 3 + i * 11) % 56;
+                        }
+                        sha256_hmac_batch(out, key, msg, len, n);
+                        for (size_t i = 0; i < n; ++i) {
+                                sha256_hmac(&expected, key[i], msg[i], len[i]);
+                                ASSERT_EQ(memcmp(&out[i], &expected, 32), 0) << same << " " << n << " " << i;
+                        }
+                }
+        }
 }
 
 int main(int argc, char **argv)
@@ -121,5 +740,398 @@ int main(int argc, char **argv)
         return RUN_ALL_TESTS();
 }
 
+TEST(sha2, pbkdf2)
+{
+        /* RFC 7914 section 11, and the widely used vectors of RFC 6070
+         * recomputed for SHA-256. */
+        static const struct {
+                std::string password;
+                std::string salt;
+                uint64_t iterations;
+                std::string key;
+        } vectors[] = {
+                { "password", "salt", 1,
+                  "120fb6cffcf8b32c43e7225256c4f837a86548c92ccc35480805987cb70be17b" },
+                { "password", "salt", 2,
+                  "ae4d0c95af6b46d32d0adff928f06dd02a303f8ef3c251dfd6e2d85a95474c43" },
+                { "password", "salt", 4096,
+                  "c5e478d59288c841aa530db6845c4c8d962893a001ce4e11a4963873aa98134a" },
+                { "passwordPASSWORDpassword", "saltSALTsaltSALTsaltSALTsaltSALTsalt", 4096,
+                  "348c89dbcbd32b2f32d814b8116e84cf2b17347ebc1800181c4e2a1fb8dd53e1c635518c7dac47e9" },
+                { "passwd", "salt", 1,
+                  "55ac046e56e3089fec1691c22544b605f94185216dde0465e68b9d57c20dacbc"
+                  "49ca9cccf179b645991664b39d77ef317c71b845b1e30bd509112041d3a19783" },
+                { "Password", "NaCl", 80000,
+                  "4ddcd8f60b98be21830cee5ef22701f9641a4418d04c0414aeff08876b34ab56"
+                  "a1d425a1225833549adb841b51c9b3176a272bdebba1d078478f62b397f33c8d" },
+        };
+        unsigned char data[256];
+        unsigned char key[201], expected[200];
+        struct sha256_hmac_key hmac;
+        struct sha256 u, t;
+
+        for (const auto& v : vectors) {
+                std::string hex;
+                sha256_pbkdf2(key, v.key.size() / 2, v.password.data(), v.password.size(), v.salt.data(), v.salt.size(), v.iterations);
+                for (size_t i = 0; i < v.key.size() / 2; ++i) {
+                        static const char digits[] = "0123456789abcdef";
+                        hex += digits[key[i] >> 4];
+                        hex += digits[key[i] & 15];
+                }
+                ASSERT_EQ(hex, v.key) << v.password << " " << v.iterations;
+        }
+
+        /* Against the definition, for outputs of one to seven blocks, with
+         * and without a partial last block. */
+        for (size_t i = 0; i < sizeof(data); ++i) {
+                data[i] = (unsigned char)(i * 31 + 7);
+        }
+        sha256_hmac_key_init(&hmac, data, 20);
+        for (size_t outlen : { 1, 32, 33, 64, 100, 128, 200 }) {
+                for (uint64_t iterations : { 1, 2, 3, 17 }) {
+                        for (size_t b = 0; 32 * b < outlen; ++b) {
+                                memcpy(key, data + 40, 9);
+                                key[9] = (unsigned char)((b + 1) >> 24);
+                                key[10] = (unsigned char)((b + 1) >> 16);
+                                key[11] = (unsigned char)((b + 1) >> 8);
+                                key[12] = (unsigned char)(b + 1);
+                                sha256_hmac(&u, &hmac, key, 13);
+                                t = u;
+                                for (uint64_t c = 1; c < iterations; ++c) {
+                                        sha256_hmac(&u, &hmac, u.u8, 32);
+                                        for (size_t i = 0; i < 32; ++i) {
+                                                t.u8[i] ^= u.u8[i];
+                                        }
+                                }
+                                memcpy(expected + 32 * b, t.u8, std::min<size_t>(32, outlen - 32 * b));
+                        }
+                        memset(key, 0, sizeof(key));
+                        ASSERT_EQ(sha256_pbkdf2(key, outlen, data, 20, data + 40, 9, iterations), 0);
+                        ASSERT_EQ(memcmp(key, expected, outlen), 0) << outlen << " " << iterations;
+                        ASSERT_EQ(key[outlen], 0) << outlen << " " << iterations;
+                }
+        }
+
+        /* A zero count is refused without writing, even in release builds. */
+        memset(key, 0xa5, sizeof(key));
+        ASSERT_EQ(sha256_pbkdf2(key, 64, data, 20, data + 40, 9, 0), -1);
+        ASSERT_EQ(std::count(key, key + sizeof(key), 0xa5), (std::ptrdiff_t)sizeof(key));
+
+        /* So is a key of more than 2^32 - 1 blocks, whose index would wrap. */
+        if (sizeof(size_t) > 4) {
+                ASSERT_EQ(sha256_pbkdf2(key, (size_t)0xffffffff * 32 + 1, data, 20, data + 40, 9, 1), -1);
+                ASSERT_EQ(std::count(key, key + sizeof(key), 0xa5), (std::ptrdiff_t)sizeof(key));
+        }
+}
+
+TEST(sha2, pbkdf2_batch)
+{
+        unsigned char data[256];
+        unsigned char keys[40][72], expected[72];
+        unsigned char* out[40];
+        const void* password[40];
+        const void* salt[40];
+        size_t pwlen[40], saltlen[40];
+
+        for (size_t i = 0; i < sizeof(data); ++i) {
+                data[i] = (unsigned char)(i * 31 + 7);
+        }
+        /* Passwords on either side of the block size, and outputs of one to
+         * three blocks, so that blocks of neighbouring passwords share a
+         * kernel call. */
+        for (size_t outlen : { 20, 64, 72 }) {
+                for (size_t n = 0; n <= 40; n += 5) {
+                        for (size_t i = 0; i < n; ++i) {
+                                out[i] = keys[i];
+                                password[i] = data + i;
+                                pwlen[i] = (i * 23) % 90;
+                                salt[i] = data + 100 + 3 * i;
+                                saltlen[i] = (i * 7) % 70;
+                        }
+                        ASSERT_EQ(sha256_pbkdf2_batch(out, outlen, password, pwlen, salt, saltlen, n, 5), 0);
+                        for (size_t i = 0; i < n; ++i) {
+                                sha256_pbkdf2(expected, outlen, password[i], pwlen[i], salt[i], saltlen[i], 5);
+                                ASSERT_EQ(memcmp(keys[i], expected, outlen), 0) << outlen << " " << n << " " << i;
+                        }
+                }
+        }
+}
+
+TEST(sha2, sha512_pbkdf2)
+{
+        /* RFC 4231 test cases 2 and 6, then PBKDF2 with outputs of one and two
+         * blocks, and the first BIP39 test vector. */
+        static const struct {
+                std::string key;
+                std::string msg;
+                std::string mac;
+        } macs[] = {
+                { "Jefe", "what do ya want for nothing?",
+                  "164b7a7bfcf819e2e395fbe73b56e0a387bd64222e831fd610270cd7ea250554"
+                  "9758bf75c05a994a6d034f65f8f0e6fdcaeab1a34d4a6b4b636e070a38bce737" },
+                { std::string(131, '\xaa'), "Test Using Larger Than Block-Size Key - Hash Key First",
+                  "80b24263c7c1a3ebb71493c1dd7be8b49b46d1f41b4aeec1121b013783f8f352"
+                  "6b56d037e05f2598bd0fd2215d6a1e5295e64f73f63f0aec8b915a985d786598" },
+        };
+        static const struct {
+                std::string password;
+                std::string salt;
+                uint64_t iterations;
+                std::string key;
+        } vectors[] = {
+                { "password", "salt", 1,
+                  "867f70cf1ade02cff3752599a3a53dc4af34c7a669815ae5d513554e1c8cf252"
+                  "c02d470a285a0501bad999bfe943c08f050235d7d68b1da55e63f73b60a57fce" },
+                { "password", "salt", 2,
+                  "e1d9c16aa681708a45f5c7c4e215ceb66e011a2e9f0040713f18aefdb866d53c"
+                  "f76cab2868a39b9f7840edce4fef5a82be67335c77a6068e04112754f27ccf4e"
+                  "473e311ad827b68945f4e2dddb204c78e40e2495141e411cd272d020640d673c"
+                  "d34aa29f" },
+                { "passwordPASSWORDpassword", "saltSALTsaltSALTsaltSALTsaltSALTsalt", 4096,
+                  "8c0511f4c6e597c6ac6315d8f0362e225f3c501495ba23b868c005174dc4ee71"
+                  "115b59f9e60cd9532fa33e0f75aefe30225c583a186cd82bd4daea9724a3d3b8" },
+                { "abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon about",
+                  "mnemonicTREZOR", 2048,
+                  "c55257c360c07c72029aebc1b53c05ed0362ada38ead3e3e9efa3708e5349553"
+                  "1f09a6987599d18264c1e1c92f2cf141630c7a3c4ab7c81b2f001698e7463b04" },
+        };
+        static const char digits[] = "0123456789abcdef";
+        struct sha512_hmac_key hmac;
+        struct sha512 mac;
+        unsigned char data[256];
+        unsigned char keys[20][100], expected[100];
+        unsigned char* out[20];
+        const void* password[20];
+        const void* salt[20];
+        size_t pwlen[20], saltlen[20];
+
+        for (const auto& v : macs) {
+                std::string hex;
+                sha512_hmac_key_init(&hmac, v.key.data(), v.key.size());
+                sha512_hmac(&mac, &hmac, v.msg.data(), v.msg.size());
+                for (size_t i = 0; i < 64; ++i) {
+                        hex += digits[mac.u8[i] >> 4];
+                        hex += digits[mac.u8[i] & 15];
+                }
+                ASSERT_EQ(hex, v.mac) << v.msg;
+        }
+        for (const auto& v : vectors) {
+                std::string hex;
+                sha512_pbkdf2(keys[0], v.key.size() / 2, v.password.data(), v.password.size(), v.salt.data(), v.salt.size(), v.iterations);
+                for (size_t i = 0; i < v.key.size() / 2; ++i) {
+                        hex += digits[keys[0][i] >> 4];
+                        hex += digits[keys[0][i] & 15];
+                }
+                ASSERT_EQ(hex, v.key) << v.password << " " << v.iterations;
+        }
+
+        /* Batches of every width, with passwords on either side of the
+         * block size and outputs of one and two blocks. */
+        for (size_t i = 0; i < sizeof(data); ++i) {
+                data[i] = (unsigned char)(i * 31 + 7);
+        }
+        for (size_t outlen : { 64, 100 }) {
+                for (size_t n = 0; n <= 20; ++n) {
+                        for (size_t i = 0; i < n; ++i) {
+                                out[i] = keys[i];
+                                password[i] = data + i;
+                                pwlen[i] = (i * 41) % 160;
+                                salt[i] = data + 100 + 3 * i;
+                                saltlen[i] = (i * 7) % 130;
+                        }
+                        ASSERT_EQ(sha512_pbkdf2_batch(out, outlen, password, pwlen, salt, saltlen, n, 3), 0);
+                        for (size_t i = 0; i < n; ++i) {
+                                sha512_pbkdf2(expected, outlen, password[i], pwlen[i], salt[i], saltlen[i], 3);
+                                ASSERT_EQ(memcmp(keys[i], expected, outlen), 0) << outlen << " " << n << " " << i;
+                        }
+                }
+        }
+
+        /* A zero count is refused without writing, even in release builds. */
+        memset(keys, 0xa5, sizeof(keys));
+        for (size_t i = 0; i < 20; ++i) {
+                out[i] = keys[i];
+        }
+        ASSERT_EQ(sha512_pbkdf2_batch(out, 100, password, pwlen, salt, saltlen, 20, 0), -1);
+        ASSERT_EQ(sha512_pbkdf2(keys[0], 100, data, 20, data + 40, 9, 0), -1);
+        ASSERT_EQ(std::count(keys[0], keys[0] + sizeof(keys), 0xa5), (std::ptrdiff_t)sizeof(keys));
+
+        /* So is a key of more than 2^32 - 1 blocks, whose index would wrap. */
+        if (sizeof(size_t) > 4) {
+                ASSERT_EQ(sha512_pbkdf2_batch(out, (size_t)0xffffffff * 64 + 1, password, pwlen, salt, saltlen, 20, 1), -1);
+                ASSERT_EQ(sha512_pbkdf2(keys[0], (size_t)0xffffffff * 64 + 1, data, 20, data + 40, 9, 1), -1);
+                ASSERT_EQ(std::count(keys[0], keys[0] + sizeof(keys), 0xa5), (std::ptrdiff_t)sizeof(keys));
+        }
+}
+
+TEST(sha2, hkdf)
+{
+        /* RFC 5869 test cases 1-3 */
+        std::string ikm2, salt2, info2;
+        for (size_t i = 0; i < 80; ++i) {
+                ikm2 += (char)i;
+                salt2 += (char)(0x60 + i);
+                info2 += (char)(0xb0 + i);
+        }
+        const struct {
+                std::string ikm;
+                std::string salt;
+                std::string info;
+                std::string prk;
+                std::string okm;
+        } vectors[] = {
+                { std::string(22, '\x0b'),
+                  std::string("\x00\x01\x02\x03\x04\x05\x06\x07\x08\x09\x0a\x0b\x0c", 13),
+                  std::string("\xf0\xf1\xf2\xf3\xf4\xf5\xf6\xf7\xf8\xf9", 10),
+                  "077709362c2e32df0ddc3f0dc47bba6390b6c73bb50f9c3122ec844ad7c2b3e5",
+                  "3cb25f25faacd57a90434f64d0362f2a2d2d0a90cf1a5a4c5db02d56ecc4c5bf34007208d5b887185865" },
+                { ikm2, salt2, info2,
+                  "06a6b88c5853361a06104c9ceb35b45cef760014904671014a193f40c15fc244",
+                  "b11e398dc80327a1c8e7f78c596a49344f012eda2d4efad8a050cc4c19afa97c"
+                  "59045a99cac7827271cb41c65e590e09da3275600c2f09b8367793a9aca3db71"
+                  "cc30c58179ec3e87c14c01d5c1f3434f1d87" },
+                { std::string(22, '\x0b'), std::string(), std::string(),
+                  "19ef24a32c717b167f33a91d6f648bdf96596776afdb6377ac434c1c293ccb04",
+                  "8da4e775a563c18f715f802a063c5a31b8a11f5c5ee1879ec3454e5f3c738d2d9d201395faa4b61a96c8" },
+        };
+        static const char digits[] = "0123456789abcdef";
+        unsigned char data[256];
+        unsigned char okm[200], expected[200], msg[128];
+        struct sha256_hmac_key key;
+        struct sha256 prk, t;
+
+        for (const auto& v : vectors) {
+                std::string hex;
+                sha256_hkdf_extract(&prk, v.salt.data(), v.salt.size(), v.ikm.data(), v.ikm.size());
+                for (size_t i = 0; i < 32; ++i) {
+                        hex += digits[prk.u8[i] >> 4];
+                        hex += digits[prk.u8[i] & 15];
+                }
+                ASSERT_EQ(hex, v.prk);
+                hex.clear();
+                sha256_hmac_key_init(&key, prk.u8, 32);
+                ASSERT_EQ(sha256_hkdf_expand(okm, v.okm.size() / 2, &key, v.info.data(), v.info.size()), 0);
+                for (size_t i = 0; i < v.okm.size() / 2; ++i) {
+                        hex += digits[okm[i] >> 4];
+                        hex += digits[okm[i] & 15];
+                }
+                ASSERT_EQ(hex, v.okm);
+        }
+
+        /* Against the definition, with info on either side of the lengths
+         * that fit T(1) and the later blocks in one compression. */
+        for (size_t i = 0; i < sizeof(data); ++i) {
+                data[i] = (unsigned char)(i * 31 + 7);
+        }
+        sha256_hmac_key_init(&key, data, 32);
+        for (size_t infolen = 0; infolen <= 70; ++infolen) {
+                for (size_t outlen : { 1, 32, 33, 100, 200 }) {
+                        size_t len = 0;
+                        for (size_t i = 1; 32 * (i - 1) < outlen; ++i) {
+                                memcpy(msg + len, data + 50, infolen);
+                                msg[len + infolen] = (unsigned char)i;
+                                sha256_hmac(&t, &key, msg, len + infolen + 1);
+                                memcpy(expected + 32 * (i - 1), t.u8, std::min<size_t>(32, outlen - 32 * (i - 1)));
+                                memcpy(msg, t.u8, 32);
+                                len = 32;
+                        }
+                        ASSERT_EQ(sha256_hkdf_expand(okm, outlen, &key, data + 50, infolen), 0);
+                        ASSERT_EQ(memcmp(okm, expected, outlen), 0) << infolen << " " << outlen;
+                }
+        }
+
+        /* The longest output is 255 blocks; anything longer is refused
+         * without writing, even in release builds. */
+        static unsigned char big[255 * 32 + 1];
+        memset(big, 0xa5, sizeof(big));
+        ASSERT_EQ(sha256_hkdf_expand(big, 255 * 32, &key, data, 10), 0);
+        ASSERT_EQ(big[255 * 32], 0xa5);
+        memset(big, 0xa5, sizeof(big));
+        ASSERT_EQ(sha256_hkdf_expand(big, 255 * 32 + 1, &key, data, 10), -1);
+        ASSERT_EQ(std::count(big, big + sizeof(big), 0xa5), (std::ptrdiff_t)sizeof(big));
+}
+
+TEST(sha2, tagged)
+{
+        unsigned char data[1024];
+        unsigned char block[64];
+        struct sha256_tag tag;
+        struct sha256 hash, expected, out[40];
+        struct sha256_ctx ctx;
+        const void* msg[40];
+        size_t len[40];
+
+        for (size_t i = 0; i < sizeof(data); ++i) {
+                data[i] = (unsigned char)(i * 31 + 7);
+        }
+        /* Against the definition, for a short tag, the BIP340 challenge tag
+         * and a tag longer than a block. */
+        for (const std::string name : { std::string("a"), std::string("BIP0340/challenge"), std::string(100, 't') }) {
+                sha256(&hash, name.data(), name.size());
+                memcpy(block, hash.u8, 32);
+                memcpy(block + 32, hash.u8, 32);
+                sha256_tag_init(&tag, name.data(), name.size());
+                for (size_t l = 0; l <= 200; l += 7) {
+                        sha256_init(&ctx);
+                        sha256_update(&ctx, block, 64);
+                        sha256_update(&ctx, data, l);
+                        sha256_done(&expected, &ctx);
+                        sha256_tagged(&hash, &tag, data, l);
+                        ASSERT_EQ(memcmp(&hash, &expected, 32), 0) << name << " " << l;
+                }
+        }
+
+        /* Batches of every width, of 96-byte challenges and of mixed
+         * lengths. */
+        for (int challenge = 1; challenge >= 0; --challenge) {
+                for (size_t n = 0; n <= 40; ++n) {
+                        for (size_t i = 0; i < n; ++i) {
+                                msg[i] = data + 13 * i;
+                                len[i] = challenge ? 96 : (i * 37) % 150;
+                        }
+                        sha256_tagged_batch(out, &tag, msg, len, n);
+                        for (size_t i = 0; i < n; ++i) {
+                                sha256_tagged(&expected, &tag, msg[i], len[i]);
+                                ASSERT_EQ(memcmp(&out[i], &expected, 32), 0) << challenge << " " << n << " " << i;
+                        }
+                }
+        }
+}
+
+TEST(sha2, finalize_suffixes)
+{
+        unsigned char data[1024];
+        struct sha256_ctx prefix, ctx;
+        struct sha256 out[40], expected;
+        const void* suffix[40];
+        size_t len[40];
+
+        for (size_t i = 0; i < sizeof(data); ++i) {
+                data[i] = (unsigned char)(i * 31 + 7);
+        }
+        /* Prefixes leaving every amount of a block buffered, and suffixes
+         * that end in the same block, the next, or several later, in
+         * batches of every width. */
+        for (size_t plen : { 0, 1, 55, 56, 63, 64, 100, 130 }) {
+                for (size_t n = 0; n <= 40; n += 3) {
+                        sha256_init(&prefix);
+                        sha256_update(&prefix, data + 500, plen);
+                        for (size_t i = 0; i < n; ++i) {
+                                suffix[i] = data + 11 * i;
+                                len[i] = (plen * 7 + i * 29) % 200;
+                        }
+                        ctx = prefix;
+                        sha256_finalize_suffixes(out, &prefix, suffix, len, n);
+                        ASSERT_EQ(memcmp(&ctx, &prefix, sizeof(ctx)), 0);
+                        for (size_t i = 0; i < n; ++i) {
+                                ctx = prefix;
+                                sha256_update(&ctx, suffix[i], len[i]);
+                                sha256_done(&expected, &ctx);
+                                ASSERT_EQ(memcmp(&out[i], &expected, 32), 0) << plen << " " << n << " " << i;
+                        }
+                }
+        }
+}
+
 /* End of File
  */